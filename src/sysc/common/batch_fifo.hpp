@@ -0,0 +1,332 @@
+/*******************************************************************************
+ * Copyright (C) 2023 by Salvador Z                                            *
+ *                                                                             *
+ * This file is part of SYSTEM_MODELS                                          *
+ *                                                                             *
+ *   Permission is hereby granted, free of charge, to any person obtaining a   *
+ *   copy of this software and associated documentation files (the Software)   *
+ *   to deal in the Software without restriction including without limitation  *
+ *   the rights to use, copy, modify, merge, publish, distribute, sublicense,  *
+ *   and/or sell copies ot the Software, and to permit persons to whom the     *
+ *   Software is furnished to do so, subject to the following conditions:      *
+ *                                                                             *
+ *   The above copyright notice and this permission notice shall be included   *
+ *   in all copies or substantial portions of the Software.                    *
+ *                                                                             *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS   *
+ *   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARANTIES OF MERCHANTABILITY *
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL   *
+ *   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR      *
+ *   OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,     *
+ *   ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE        *
+ *   OR OTHER DEALINGS IN THE SOFTWARE.                                        *
+ ******************************************************************************/
+
+/**
+ * @file batch_fifo.hpp
+ * @author Salvador Z
+ * @version 1.0
+ * @brief File for the batch transfer fifo channel
+ *
+ * batch_fifo<T> is a primitive fifo channel with the sc_fifo semantics (values
+ * written in a delta cycle are readable in the next one, space freed by a read
+ * is writable in the next one, at most one data_written/data_read notification
+ * per delta cycle, one reader and one writer port) that also moves whole
+ * blocks of values with read_n()/write_n(). It implements sc_fifo_in_if and
+ * sc_fifo_out_if, so it binds to the existing sc_fifo ports; ports of
+ * batch_fifo_in_if/batch_fifo_out_if also get the block calls.
+ */
+
+#ifndef BATCH_FIFO_HPP_
+#define BATCH_FIFO_HPP_
+
+// Includes
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <string>
+#include <systemc.h>
+#include <type_traits>
+#include <typeinfo>
+#include <vector>
+
+#define BATCH_FIFO_DEFAULT_SIZE 16 // same default depth as sc_fifo
+
+/**
+ * @brief Class fifo_span
+ * Pointer and length of a block of values, std::span is C++20.
+ */
+template <typename T>
+class fifo_span {
+private:
+  T          *ptr;
+  std::size_t len;
+
+  // containers of T, or of the non const T for a span of const T
+  template <typename U>
+  using if_element =
+      typename std::enable_if<std::is_same<U, T>::value || std::is_same<const U, T>::value>::type;
+
+public:
+  fifo_span() : ptr(nullptr), len(0) {}
+  fifo_span(T *data, std::size_t count) : ptr(data), len(count) {}
+
+  template <std::size_t N>
+  fifo_span(T (&array)[N]) : ptr(array), len(N) {}
+
+  template <typename U, std::size_t N, typename = if_element<U> >
+  fifo_span(std::array<U, N> &array) : ptr(array.data()), len(N) {}
+
+  template <typename U, typename = if_element<U> >
+  fifo_span(std::vector<U> &vec) : ptr(vec.data()), len(vec.size()) {}
+
+  // a block of values to write can be a const vector
+  template <typename U, typename = typename std::enable_if<std::is_same<const U, T>::value>::type>
+  fifo_span(const std::vector<U> &vec) : ptr(vec.data()), len(vec.size()) {}
+
+  T *data() const {
+    return ptr;
+  }
+
+  std::size_t size() const {
+    return len;
+  }
+
+  bool empty() const {
+    return 0 == len;
+  }
+
+  fifo_span subspan(std::size_t offset) const {
+    return fifo_span(ptr + offset, len - offset);
+  }
+};
+
+/**
+ * @brief Class batch_fifo_in_if
+ * sc_fifo_in_if plus block reads.
+ */
+template <typename T>
+class batch_fifo_in_if : public sc_fifo_in_if<T> {
+public:
+  // read values.size() values, blocking until all of them were read
+  virtual void read_n(fifo_span<T> values) = 0;
+
+  // read up to values.size() values without blocking, returns the number read
+  virtual std::size_t try_read_n(fifo_span<T> values) = 0;
+
+protected:
+  batch_fifo_in_if() {}
+};
+
+/**
+ * @brief Class batch_fifo_out_if
+ * sc_fifo_out_if plus block writes.
+ */
+template <typename T>
+class batch_fifo_out_if : public sc_fifo_out_if<T> {
+public:
+  // write values.size() values, blocking until all of them were written
+  virtual void write_n(fifo_span<const T> values) = 0;
+
+  // write up to values.size() values without blocking, returns the number written
+  virtual std::size_t try_write_n(fifo_span<const T> values) = 0;
+
+protected:
+  batch_fifo_out_if() {}
+};
+
+/**
+ * @brief Class batch_fifo
+ * Circular buffer channel, one reader and one writer. A block is copied in at
+ * most two runs and requests a single update, so its cost does not grow with
+ * the number of calls.
+ */
+template <typename T>
+class batch_fifo : public batch_fifo_in_if<T>, public batch_fifo_out_if<T>, public sc_prim_channel {
+private:
+  std::vector<T> buf;
+  std::size_t    size;
+  std::size_t    ri;       // next value to read
+  std::size_t    wi;       // next free slot
+  std::size_t    used;     // values in the buffer, readable or written in this delta cycle
+  std::size_t    readable; // values in the buffer at the start of this delta cycle, read or not
+  std::size_t    num_read;
+  std::size_t    num_written;
+
+  sc_port_base *reader;
+  sc_port_base *writer;
+
+  sc_event read_event;
+  sc_event written_event;
+
+  // copy count values out of the buffer, in at most two runs
+  void take(T *dst, std::size_t count) {
+    std::size_t first = std::min(count, size - ri);
+
+    std::copy(buf.data() + ri, buf.data() + ri + first, dst);
+    std::copy(buf.data(), buf.data() + (count - first), dst + first);
+    ri = (ri + count) % size;
+    used -= count;
+    num_read += count;
+    request_update();
+  }
+
+  // copy count values into the buffer, in at most two runs
+  void put(const T *src, std::size_t count) {
+    std::size_t first = std::min(count, size - wi);
+
+    std::copy(src, src + first, buf.data() + wi);
+    std::copy(src + first, src + count, buf.data());
+    wi = (wi + count) % size;
+    used += count;
+    num_written += count;
+    request_update();
+  }
+
+protected:
+  // values written before this delta cycle and not read yet
+  std::size_t available() const {
+    return readable - num_read;
+  }
+
+  // slots free at the start of this delta cycle and not written yet, a read frees its slots in the next one
+  std::size_t free_slots() const {
+    return size - readable - num_written;
+  }
+
+  /**
+   * @brief make the values written and the slots read in this delta cycle available
+   * Notifies once per direction.
+   *
+   */
+  virtual void update() {
+    if (num_read > 0) read_event.notify(SC_ZERO_TIME);
+    if (num_written > 0) written_event.notify(SC_ZERO_TIME);
+
+    readable    = used;
+    num_read    = 0;
+    num_written = 0;
+  }
+
+public:
+  explicit batch_fifo(int depth = BATCH_FIFO_DEFAULT_SIZE)
+      : sc_prim_channel(sc_gen_unique_name("batch_fifo")), buf(depth > 0 ? depth : 1), size(buf.size()),
+        ri(0), wi(0), used(0), readable(0), num_read(0), num_written(0), reader(nullptr), writer(nullptr) {}
+
+  explicit batch_fifo(const char *name, int depth = BATCH_FIFO_DEFAULT_SIZE)
+      : sc_prim_channel(name), buf(depth > 0 ? depth : 1), size(buf.size()), ri(0), wi(0), used(0),
+        readable(0), num_read(0), num_written(0), reader(nullptr), writer(nullptr) {}
+
+  virtual const char *kind() const {
+    return "batch_fifo";
+  }
+
+  /**
+   * @brief one reader and one writer port, as sc_fifo
+   *
+   * The delta cycle counts above are only exact with a single process on each side.
+   */
+  virtual void register_port(sc_port_base &port, const char *if_typename) {
+    std::string nm(if_typename);
+    std::string channel(name());
+
+    if ((nm == typeid(sc_fifo_in_if<T>).name()) || (nm == typeid(sc_fifo_blocking_in_if<T>).name()) ||
+        (nm == typeid(batch_fifo_in_if<T>).name())) {
+      if (nullptr != reader) SC_REPORT_ERROR(kind(), ("more than one reader on " + channel).c_str());
+      reader = &port;
+    } else {
+      if (nullptr != writer) SC_REPORT_ERROR(kind(), ("more than one writer on " + channel).c_str());
+      writer = &port;
+    }
+  }
+
+  // sc_fifo_in_if
+
+  virtual bool nb_read(T &value) {
+    if (0 == available()) return false;
+    take(&value, 1);
+    return true;
+  }
+
+  virtual void read(T &value) {
+    while (0 == available()) sc_core::wait(written_event);
+    take(&value, 1);
+  }
+
+  virtual T read() {
+    T value;
+
+    read(value);
+    return value;
+  }
+
+  virtual int num_available() const {
+    return (int)available();
+  }
+
+  virtual const sc_event &data_written_event() const {
+    return written_event;
+  }
+
+  // sc_fifo_out_if
+
+  virtual bool nb_write(const T &value) {
+    if (0 == free_slots()) return false;
+    put(&value, 1);
+    return true;
+  }
+
+  virtual void write(const T &value) {
+    while (0 == free_slots()) sc_core::wait(read_event);
+    put(&value, 1);
+  }
+
+  virtual int num_free() const {
+    return (int)free_slots();
+  }
+
+  virtual const sc_event &data_read_event() const {
+    return read_event;
+  }
+
+  // block transfers
+
+  virtual std::size_t try_read_n(fifo_span<T> values) {
+    std::size_t count = std::min(values.size(), available());
+
+    if (count > 0) take(values.data(), count);
+    return count;
+  }
+
+  virtual void read_n(fifo_span<T> values) {
+    std::size_t done = try_read_n(values);
+
+    // a block larger than the fifo is read one fill at a time
+    while (done < values.size()) {
+      sc_core::wait(written_event);
+      done += try_read_n(values.subspan(done));
+    }
+  }
+
+  virtual std::size_t try_write_n(fifo_span<const T> values) {
+    std::size_t count = std::min(values.size(), free_slots());
+
+    if (count > 0) put(values.data(), count);
+    return count;
+  }
+
+  virtual void write_n(fifo_span<const T> values) {
+    std::size_t done = try_write_n(values);
+
+    while (done < values.size()) {
+      sc_core::wait(read_event);
+      done += try_write_n(values.subspan(done));
+    }
+  }
+
+  virtual void print(std::ostream &os = std::cout) const {
+    os << name() << ": " << used << " of " << size << " values" << std::endl;
+  }
+};
+
+#endif /* BATCH_FIFO_HPP_ */
@@ -0,0 +1,174 @@
+/*******************************************************************************
+ * Copyright (C) 2023 by Salvador Z                                            *
+ *                                                                             *
+ * This file is part of SYSTEM_MODELS                                          *
+ *                                                                             *
+ *   Permission is hereby granted, free of charge, to any person obtaining a   *
+ *   copy of this software and associated documentation files (the Software)   *
+ *   to deal in the Software without restriction including without limitation  *
+ *   the rights to use, copy, modify, merge, publish, distribute, sublicense,  *
+ *   and/or sell copies ot the Software, and to permit persons to whom the     *
+ *   Software is furnished to do so, subject to the following conditions:      *
+ *                                                                             *
+ *   The above copyright notice and this permission notice shall be included   *
+ *   in all copies or substantial portions of the Software.                    *
+ *                                                                             *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS   *
+ *   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARANTIES OF MERCHANTABILITY *
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL   *
+ *   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR      *
+ *   OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,     *
+ *   ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE        *
+ *   OR OTHER DEALINGS IN THE SOFTWARE.                                        *
+ ******************************************************************************/
+
+/**
+ * @file child_process.hpp
+ * @author Salvador Z
+ * @version 1.0
+ * @brief File for running a model binary in a child process and reading its summary
+ *
+ * The SystemC kernel can only be elaborated once per process, so the benchmarks and
+ * the sweep run every configuration in its own process. The child's stdout goes to a
+ * pipe, and the "summary: key=value ..." line it prints last is parsed into a map.
+ */
+
+#ifndef CHILD_PROCESS_HPP_
+#define CHILD_PROCESS_HPP_
+
+// Includes
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <string>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+#define CHILD_READ_SIZE 4096
+
+typedef std::map<std::string, double> summary_metrics;
+
+/**
+ * @brief a running child, its stdout on a pipe
+ *
+ */
+struct child_process {
+  pid_t pid;
+  int   fd; // read end of the child stdout
+};
+
+/**
+ * @brief start binary with args, its stdout on a pipe
+ *
+ * @return true when the process was started
+ */
+inline bool child_start(const std::string &binary, const std::vector<std::string> &args,
+                        child_process &child) {
+  int fds[2];
+
+  if (0 != pipe(fds)) return false;
+
+  child.pid = fork();
+  if (child.pid < 0) {
+    close(fds[0]);
+    close(fds[1]);
+    return false;
+  }
+
+  if (0 == child.pid) {
+    std::vector<char *> argv;
+
+    argv.push_back(const_cast<char *>(binary.c_str()));
+    for (const std::string &arg : args) argv.push_back(const_cast<char *>(arg.c_str()));
+    argv.push_back(nullptr);
+
+    close(fds[0]);
+    dup2(fds[1], STDOUT_FILENO);
+    close(fds[1]);
+    execv(binary.c_str(), argv.data());
+    _exit(127);
+  }
+
+  close(fds[1]);
+  child.fd = fds[0];
+  return true;
+}
+
+/**
+ * @brief close the pipe and reap the child, once its output was read
+ *
+ * @return true when the child exited with status 0
+ */
+inline bool child_finish(child_process &child) {
+  int status;
+
+  close(child.fd);
+  if (waitpid(child.pid, &status, 0) < 0) return false;
+  return WIFEXITED(status) && (0 == WEXITSTATUS(status));
+}
+
+/**
+ * @brief run binary with args to the end
+ *
+ * @param output everything the child wrote to stdout
+ * @return true when the child exited with status 0
+ */
+inline bool child_run(const std::string &binary, const std::vector<std::string> &args, std::string &output) {
+  child_process child;
+  char          buffer[CHILD_READ_SIZE];
+  ssize_t       bytes;
+
+  output.clear();
+  if (!child_start(binary, args, child)) return false;
+
+  while ((bytes = read(child.fd, buffer, sizeof(buffer))) != 0) {
+    if (bytes > 0) {
+      output.append(buffer, bytes);
+    } else if (EINTR != errno) {
+      break;
+    }
+  }
+  return child_finish(child);
+}
+
+/**
+ * @brief parse the key=value pairs of the last summary line
+ *
+ * @return true when the output has a summary line
+ */
+inline bool parse_summary(const std::string &output, summary_metrics &metrics) {
+  size_t      pos = output.rfind("summary:");
+  size_t      end;
+  std::string line;
+  char        key[64];
+  double      value;
+  int         used;
+
+  if (std::string::npos == pos) return false;
+
+  pos += strlen("summary:");
+  end  = output.find('\n', pos);
+  line = output.substr(pos, (std::string::npos == end) ? std::string::npos : end - pos);
+
+  for (const char *p = line.c_str(); 2 == sscanf(p, " %63[^=]=%lf%n", key, &value, &used); p += used) {
+    metrics[key] = value;
+  }
+  return !metrics.empty();
+}
+
+/**
+ * @brief run binary with args and parse its summary line
+ *
+ * @return true when the child exited with status 0 and printed a summary
+ */
+inline bool child_run_summary(const std::string &binary, const std::vector<std::string> &args,
+                              summary_metrics &metrics) {
+  std::string output;
+
+  metrics.clear();
+  return child_run(binary, args, output) && parse_summary(output, metrics);
+}
+
+#endif /* CHILD_PROCESS_HPP_ */
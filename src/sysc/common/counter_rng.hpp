@@ -0,0 +1,217 @@
+/*******************************************************************************
+ * Copyright (C) 2023 by Salvador Z                                            *
+ *                                                                             *
+ * This file is part of SYSTEM_MODELS                                          *
+ *                                                                             *
+ *   Permission is hereby granted, free of charge, to any person obtaining a   *
+ *   copy of this software and associated documentation files (the Software)   *
+ *   to deal in the Software without restriction including without limitation  *
+ *   the rights to use, copy, modify, merge, publish, distribute, sublicense,  *
+ *   and/or sell copies ot the Software, and to permit persons to whom the     *
+ *   Software is furnished to do so, subject to the following conditions:      *
+ *                                                                             *
+ *   The above copyright notice and this permission notice shall be included   *
+ *   in all copies or substantial portions of the Software.                    *
+ *                                                                             *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS   *
+ *   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARANTIES OF MERCHANTABILITY *
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL   *
+ *   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR      *
+ *   OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,     *
+ *   ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE        *
+ *   OR OTHER DEALINGS IN THE SOFTWARE.                                        *
+ ******************************************************************************/
+
+
+/**
+ * @file counter_rng.hpp
+ * @author Salvador Z
+ * @version 1.0
+ * @brief File for the counter based random number generator (Philox4x32-10)
+ *
+ * Every draw is a pure function of (seed, instance id, draw index), so each module
+ * instance owns an independent stream that does not depend on the construction or
+ * scheduling order of the other modules.
+ */
+
+#ifndef COUNTER_RNG_HPP_
+#define COUNTER_RNG_HPP_
+
+// Includes
+#include <cstddef>
+#include <cstdint>
+
+#define PHILOX_ROUNDS 10
+#define PHILOX_M0     0xD2511F53u
+#define PHILOX_M1     0xCD9E8D57u
+#define PHILOX_W0     0x9E3779B9u
+#define PHILOX_W1     0xBB67AE85u
+#define PHILOX_BATCH  8 // blocks computed side by side by fill()
+
+/**
+ * @brief Class counter_rng
+ * Philox4x32-10 keyed by (seed, instance id). The counter is the index of the
+ * 32 bit draw, each Philox block gives 4 draws.
+ */
+class counter_rng {
+private:
+  uint32_t key[2];
+  uint64_t counter;    // index of the next draw
+  uint64_t cached_blk; // block held in cache
+  uint32_t cache[4];
+
+  static inline void mulhilo(uint32_t a, uint32_t b, uint32_t &hi, uint32_t &lo) {
+    uint64_t product = (uint64_t)a * b;
+    hi               = (uint32_t)(product >> 32);
+    lo               = (uint32_t)product;
+  }
+
+public:
+  /**
+   * @brief Philox4x32-10 block function
+   *
+   * @param blk block index (counter words 0 and 1)
+   * @param k key
+   * @param out 4 random words
+   */
+  static inline void block(uint64_t blk, const uint32_t k[2], uint32_t out[4]) {
+    uint32_t c0 = (uint32_t)blk, c1 = (uint32_t)(blk >> 32), c2 = 0, c3 = 0;
+    uint32_t k0 = k[0], k1 = k[1];
+    uint32_t hi0, lo0, hi1, lo1;
+
+    for (int r = 0; r < PHILOX_ROUNDS; r++) {
+      mulhilo(PHILOX_M0, c0, hi0, lo0);
+      mulhilo(PHILOX_M1, c2, hi1, lo1);
+      c0 = hi1 ^ c1 ^ k0;
+      c1 = lo1;
+      c2 = hi0 ^ c3 ^ k1;
+      c3 = lo0;
+      k0 += PHILOX_W0;
+      k1 += PHILOX_W1;
+    }
+    out[0] = c0;
+    out[1] = c1;
+    out[2] = c2;
+    out[3] = c3;
+  }
+
+  /**
+   * @brief stable instance id from a name, for modules without a numeric id
+   *
+   * @param name instance name
+   * @return uint32_t FNV-1a hash of the name
+   */
+  static uint32_t instance_id(const char *name) {
+    uint32_t hash = 2166136261u;
+
+    while (*name) {
+      hash ^= (uint8_t)*name++;
+      hash *= 16777619u;
+    }
+    return hash;
+  }
+
+  counter_rng(uint32_t seed = 0, uint32_t id = 0) : counter(0), cached_blk(UINT64_MAX) {
+    key[0] = seed;
+    key[1] = id;
+  }
+
+  /**
+   * @brief next 32 bit draw
+   *
+   */
+  uint32_t next() {
+    uint64_t blk = counter >> 2;
+
+    if (blk != cached_blk) {
+      block(blk, key, cache);
+      cached_blk = blk;
+    }
+    return cache[counter++ & 3];
+  }
+
+  uint32_t operator()() {
+    return next();
+  }
+
+  /**
+   * @brief draw in [0, n)
+   *
+   */
+  uint32_t uniform(uint32_t n) {
+    return (uint32_t)(((uint64_t)next() * n) >> 32);
+  }
+
+  /**
+   * @brief non negative int draw, same range as rand() with a 31 bit RAND_MAX
+   *
+   */
+  int next_int() {
+    return (int)(next() >> 1);
+  }
+
+  /**
+   * @brief n consecutive draws, PHILOX_BATCH blocks are computed side by side in structure
+   * of arrays form so their independent rounds overlap in the pipeline (or vector lanes)
+   *
+   * @param out destination
+   * @param n number of draws
+   */
+  void fill(uint32_t *out, size_t n) {
+    uint32_t c0[PHILOX_BATCH], c1[PHILOX_BATCH], c2[PHILOX_BATCH], c3[PHILOX_BATCH];
+    uint64_t p0[PHILOX_BATCH], p1[PHILOX_BATCH];
+    size_t   i = 0;
+
+    // single draws up to a block boundary
+    while ((i < n) && (counter & 3)) out[i++] = next();
+
+    for (; i + 4 * PHILOX_BATCH <= n; i += 4 * PHILOX_BATCH) {
+      uint64_t blk = counter >> 2;
+      uint32_t k0 = key[0], k1 = key[1];
+
+      for (int b = 0; b < PHILOX_BATCH; b++) {
+        c0[b] = (uint32_t)(blk + b);
+        c1[b] = (uint32_t)((blk + b) >> 32);
+        c2[b] = 0;
+        c3[b] = 0;
+      }
+
+      for (int r = 0; r < PHILOX_ROUNDS; r++) {
+        // widening multiplies of the whole batch first, then the 32 bit mixing
+        for (int b = 0; b < PHILOX_BATCH; b++) {
+          p0[b] = (uint64_t)PHILOX_M0 * c0[b];
+          p1[b] = (uint64_t)PHILOX_M1 * c2[b];
+        }
+        for (int b = 0; b < PHILOX_BATCH; b++) {
+          c0[b] = (uint32_t)(p1[b] >> 32) ^ c1[b] ^ k0;
+          c2[b] = (uint32_t)(p0[b] >> 32) ^ c3[b] ^ k1;
+          c1[b] = (uint32_t)p1[b];
+          c3[b] = (uint32_t)p0[b];
+        }
+        k0 += PHILOX_W0;
+        k1 += PHILOX_W1;
+      }
+
+      for (int b = 0; b < PHILOX_BATCH; b++) {
+        out[i + 4 * b + 0] = c0[b];
+        out[i + 4 * b + 1] = c1[b];
+        out[i + 4 * b + 2] = c2[b];
+        out[i + 4 * b + 3] = c3[b];
+      }
+      counter += 4 * PHILOX_BATCH;
+    }
+
+    // remaining draws
+    while (i < n) out[i++] = next();
+  }
+
+  uint64_t get_counter() const {
+    return counter;
+  }
+
+  void set_counter(uint64_t draw) {
+    counter = draw;
+  }
+};
+
+#endif /* COUNTER_RNG_HPP_ */
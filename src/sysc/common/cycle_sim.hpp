@@ -0,0 +1,203 @@
+/*******************************************************************************
+ * Copyright (C) 2023 by Salvador Z                                            *
+ *                                                                             *
+ * This file is part of SYSTEM_MODELS                                          *
+ *                                                                             *
+ *   Permission is hereby granted, free of charge, to any person obtaining a   *
+ *   copy of this software and associated documentation files (the Software)   *
+ *   to deal in the Software without restriction including without limitation  *
+ *   the rights to use, copy, modify, merge, publish, distribute, sublicense,  *
+ *   and/or sell copies ot the Software, and to permit persons to whom the     *
+ *   Software is furnished to do so, subject to the following conditions:      *
+ *                                                                             *
+ *   The above copyright notice and this permission notice shall be included   *
+ *   in all copies or substantial portions of the Software.                    *
+ *                                                                             *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS   *
+ *   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARANTIES OF MERCHANTABILITY *
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL   *
+ *   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR      *
+ *   OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,     *
+ *   ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE        *
+ *   OR OTHER DEALINGS IN THE SOFTWARE.                                        *
+ ******************************************************************************/
+
+
+/**
+ * @file cycle_sim.hpp
+ * @author Salvador Z
+ * @version 1.0
+ * @brief File for the cycle-based execution of clocked SC_METHOD pipelines
+ *
+ * A model whose processes are all SC_METHODs on the rising edge of one clock,
+ * communicating through signals, needs none of the event machinery: every process
+ * runs once per cycle on the values of the previous cycle. cycle_sim runs such a
+ * model without the kernel:
+ *   - the signals between the processes are cycle_signal<T>, a double buffered
+ *     register bound to the same sc_in/sc_out ports as an sc_signal<T>
+ *   - the processes are added with add<&module::process>(module); at the first run
+ *     the cycle_signals bound to their ports are collected, once
+ *   - run(cycles) calls the processes in the order they were added, then makes every
+ *     signal take the value written in the cycle, with no event, delta cycle or
+ *     update request
+ * Every signal is a register, a process never sees a value written in the same cycle,
+ * so the call order cannot change the result and no scheduling is needed.
+ * Simulated time stays at the end of elaboration, get_time() is the time of the
+ * current rising edge; sim_log takes it with set_time_source(get_time_source()).
+ */
+
+#ifndef CYCLE_SIM_HPP_
+#define CYCLE_SIM_HPP_
+
+// Includes
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <systemc.h>
+#include <vector>
+
+/**
+ * @brief Class cycle_register
+ * Signal updated by cycle_sim at the end of every cycle.
+ */
+class cycle_register {
+public:
+  virtual ~cycle_register() {}
+
+  // the value written in the cycle becomes the value read
+  virtual void commit() = 0;
+};
+
+/**
+ * @brief Class cycle_signal
+ * Double buffered signal: read() returns the value of the previous cycle, write()
+ * sets the value of the next one. Without a write the value is kept. No event is
+ * ever notified, processes sensitive to it are not run by the kernel.
+ */
+template <typename T>
+class cycle_signal : public sc_prim_channel, public sc_signal_inout_if<T>, public cycle_register {
+private:
+  T        current;
+  T        next;
+  sc_event never; // value_changed_event()
+
+public:
+  explicit cycle_signal(const char *name, const T &value = T())
+      : sc_prim_channel(name), current(value), next(value) {}
+
+  virtual const char *kind() const {
+    return "cycle_signal";
+  }
+
+  virtual const T &read() const {
+    return current;
+  }
+
+  virtual const T &get_data_ref() const {
+    return current;
+  }
+
+  virtual void write(const T &value) {
+    next = value;
+  }
+
+  virtual bool event() const {
+    return false;
+  }
+
+  virtual const sc_event &value_changed_event() const {
+    return never;
+  }
+
+  virtual void commit() {
+    current = next;
+  }
+};
+
+/**
+ * @brief Class cycle_sim
+ * Processes of a clocked pipeline, called directly every cycle.
+ */
+class cycle_sim {
+private:
+  // a process of the schedule
+  struct stage {
+    sc_module *module;
+    void (*call)(sc_module *);
+  };
+
+  std::vector<stage>            stages;
+  std::vector<cycle_register *> registers;
+  uint64_t                      period; // resolution ticks
+  uint64_t                      time;   // of the current rising edge
+  uint64_t                      cycles;
+  bool                          bound; // registers collected
+
+  template <typename M, void (M::*PROCESS)()>
+  static void call(sc_module *module) {
+    (static_cast<M *>(module)->*PROCESS)();
+  }
+
+  // cycle_signals bound to the ports of a module, sc_in, sc_out or sc_inout
+  static void signals_of(sc_module *module, std::vector<cycle_register *> &regs) {
+    for (sc_object *child : module->get_child_objects()) {
+      sc_port_base   *port = dynamic_cast<sc_port_base *>(child);
+      cycle_register *reg  = port ? dynamic_cast<cycle_register *>(port->get_interface()) : nullptr;
+
+      if (nullptr != reg) regs.push_back(reg);
+    }
+  }
+
+public:
+  explicit cycle_sim(const sc_time &clock_period)
+      : period(clock_period.value()), time(sc_time_stamp().value()), cycles(0), bound(false) {}
+
+  // process PROCESS of module, run once per cycle
+  template <auto PROCESS, typename M>
+  void add(M &module) {
+    stages.push_back(stage{&module, &call<M, PROCESS>});
+    bound = false;
+  }
+
+  /**
+   * @brief collect the registers bound to the ports of the processes, each once
+   * Needs the ports bound, i.e. after the end of elaboration.
+   */
+  void bind() {
+    registers.clear();
+    for (const stage &s : stages) signals_of(s.module, registers);
+    std::sort(registers.begin(), registers.end());
+    registers.erase(std::unique(registers.begin(), registers.end()), registers.end());
+    bound = true;
+  }
+
+  // run the given number of clock cycles
+  void run(uint64_t count) {
+    if (!bound) bind();
+    for (uint64_t n = 0; n < count; n++) {
+      for (const stage &s : stages) s.call(s.module);
+      for (cycle_register *reg : registers) reg->commit();
+      time += period;
+    }
+    cycles += count;
+  }
+
+  void print_schedule() const {
+    printf("cycle_sim: %zu processes, %zu registers\n", stages.size(), registers.size());
+    for (const stage &s : stages) printf("  %s\n", s.module->name());
+  }
+
+  uint64_t get_cycles() const {
+    return cycles;
+  }
+
+  uint64_t get_time() const {
+    return time;
+  }
+
+  const uint64_t *get_time_source() const {
+    return &time;
+  }
+};
+
+#endif /* CYCLE_SIM_HPP_ */
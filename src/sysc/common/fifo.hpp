@@ -0,0 +1,378 @@
+/*******************************************************************************
+ * Copyright (C) 2023 by Salvador Z                                            *
+ *                                                                             *
+ * This file is part of SYSTEM_MODELS                                          *
+ *                                                                             *
+ *   Permission is hereby granted, free of charge, to any person obtaining a   *
+ *   copy of this software and associated documentation files (the Software)   *
+ *   to deal in the Software without restriction including without limitation  *
+ *   the rights to use, copy, modify, merge, publish, distribute, sublicense,  *
+ *   and/or sell copies ot the Software, and to permit persons to whom the     *
+ *   Software is furnished to do so, subject to the following conditions:      *
+ *                                                                             *
+ *   The above copyright notice and this permission notice shall be included   *
+ *   in all copies or substantial portions of the Software.                    *
+ *                                                                             *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS   *
+ *   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARANTIES OF MERCHANTABILITY *
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL   *
+ *   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR      *
+ *   OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,     *
+ *   ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE        *
+ *   OR OTHER DEALINGS IN THE SOFTWARE.                                        *
+ ******************************************************************************/
+
+
+/**
+ * @file fifo.hpp
+ * @author Salvador Z
+ * @version 1.0
+ * @brief File for the compile time sized fifo channel
+ *
+ * fifo<T, N> is the channel of the fifo example made generic: N values of any
+ * copyable or movable T, blocking read()/write() through read_if<T>/write_if<T>,
+ * plus try_read()/try_write(), peek() and occupancy queries. Unlike sc_fifo it
+ * is a hierarchical channel with immediate notification: a value written is
+ * readable at once and a blocked reader resumes in the same delta cycle.
+ *
+ * The ring index wraps with a mask when N is a power of two and with a compare
+ * otherwise, never with a division.
+ *
+ * stream_fifo<T, N> streams blocks of a trivially copyable T without copying them
+ * through the channel: the writer fills a view of the free part of the ring and
+ * commits it, the reader works on a view of the filled part and releases it.
+ */
+
+#ifndef FIFO_HPP_
+#define FIFO_HPP_
+
+// Includes
+#include "batch_fifo.hpp"
+#include <cstddef>
+#include <new>
+#include <systemc.h>
+#include <type_traits>
+#include <utility>
+
+/**
+ * @brief Class write_if
+ * Write side of fifo<T, N>. The values are moved in, the const T & calls copy first.
+ */
+template <typename T>
+class write_if : virtual public sc_interface {
+public:
+  // write a value, blocking while the fifo is full
+  virtual void write(T &&value) = 0;
+
+  // write a value if there is room, value is only moved from on success
+  virtual bool try_write(T &&value) = 0;
+
+  virtual int num_free() const = 0;
+
+  virtual void reset() = 0;
+
+  virtual const sc_event &data_read_event() const = 0;
+
+  void write(const T &value) {
+    write(T(value));
+  }
+
+  bool try_write(const T &value) {
+    T copy(value);
+
+    return try_write(std::move(copy));
+  }
+};
+
+/**
+ * @brief Class read_if
+ * Read side of fifo<T, N>.
+ */
+template <typename T>
+class read_if : virtual public sc_interface {
+public:
+  // read the oldest value, blocking while the fifo is empty
+  virtual void read(T &value) = 0;
+
+  // read the oldest value if there is one
+  virtual bool try_read(T &value) = 0;
+
+  // oldest value left in the fifo, nullptr when empty; valid until the next read or reset
+  virtual const T *peek() const = 0;
+
+  virtual int size() const = 0;
+
+  virtual const sc_event &data_written_event() const = 0;
+};
+
+/**
+ * @brief Class fifo
+ * Ring of N values, one reader and one writer process.
+ */
+template <typename T, std::size_t N>
+class fifo : public sc_channel, public write_if<T>, public read_if<T> {
+private:
+  static_assert(N >= 1, "fifo capacity must be at least 1");
+
+  static constexpr bool power_of_two = (0 == (N & (N - 1)));
+
+  alignas(T) unsigned char storage[N * sizeof(T)]; // constructed from head to head + count
+
+  std::size_t head; // oldest value
+  std::size_t count;
+  sc_event    written_event, read_event;
+
+  // index i, i < 2N, into the ring
+  static std::size_t wrap(std::size_t i) {
+    if (power_of_two) return i & (N - 1);
+    return (i >= N) ? i - N : i;
+  }
+
+  T *slot(std::size_t i) {
+    return reinterpret_cast<T *>(storage) + i;
+  }
+
+  const T *slot(std::size_t i) const {
+    return reinterpret_cast<const T *>(storage) + i;
+  }
+
+  void push(T &&value) {
+    new (slot(wrap(head + count))) T(std::move(value));
+    ++count;
+    written_event.notify();
+  }
+
+  void pop(T &value) {
+    T *oldest = slot(head);
+
+    value = std::move(*oldest);
+    oldest->~T();
+    head = wrap(head + 1);
+    --count;
+    read_event.notify();
+  }
+
+public:
+  using write_if<T>::write;
+  using write_if<T>::try_write;
+
+  explicit fifo(sc_module_name name) : sc_channel(name), head(0), count(0) {}
+
+  ~fifo() {
+    reset();
+  }
+
+  virtual const char *kind() const {
+    return "fifo";
+  }
+
+  static constexpr std::size_t capacity() {
+    return N;
+  }
+
+  // write_if
+
+  virtual void write(T &&value) {
+    while (N == count) wait(read_event);
+    push(std::move(value));
+  }
+
+  virtual bool try_write(T &&value) {
+    if (N == count) return false;
+    push(std::move(value));
+    return true;
+  }
+
+  virtual int num_free() const {
+    return (int)(N - count);
+  }
+
+  virtual void reset() {
+    for (; count > 0; --count) {
+      slot(head)->~T();
+      head = wrap(head + 1);
+    }
+    head = 0;
+  }
+
+  virtual const sc_event &data_read_event() const {
+    return read_event;
+  }
+
+  // read_if
+
+  virtual void read(T &value) {
+    while (0 == count) wait(written_event);
+    pop(value);
+  }
+
+  virtual bool try_read(T &value) {
+    if (0 == count) return false;
+    pop(value);
+    return true;
+  }
+
+  virtual const T *peek() const {
+    return (0 == count) ? nullptr : slot(head);
+  }
+
+  virtual int size() const {
+    return (int)count;
+  }
+
+  virtual const sc_event &data_written_event() const {
+    return written_event;
+  }
+
+  bool empty() const {
+    return 0 == count;
+  }
+
+  bool full() const {
+    return N == count;
+  }
+};
+
+/**
+ * @brief Class stream_write_if
+ * Write side of stream_fifo<T, N>: views of the free part of the ring.
+ */
+template <typename T>
+class stream_write_if : virtual public sc_interface {
+public:
+  // free values contiguous in the ring, blocking while the fifo is full
+  virtual fifo_span<T> acquire_write() = 0;
+
+  // same without blocking, empty when the fifo is full
+  virtual fifo_span<T> try_acquire_write() = 0;
+
+  // publish the first count values of the last view, count <= its size
+  virtual void commit_write(std::size_t count) = 0;
+
+  virtual int num_free() const = 0;
+
+  virtual const sc_event &data_read_event() const = 0;
+};
+
+/**
+ * @brief Class stream_read_if
+ * Read side of stream_fifo<T, N>: views of the filled part of the ring.
+ */
+template <typename T>
+class stream_read_if : virtual public sc_interface {
+public:
+  // oldest values contiguous in the ring, blocking while the fifo is empty
+  virtual fifo_span<const T> acquire_read() = 0;
+
+  // same without blocking, empty when the fifo is empty
+  virtual fifo_span<const T> try_acquire_read() = 0;
+
+  // give the first count values of the last view back to the writer, count <= its size
+  virtual void release_read(std::size_t count) = 0;
+
+  virtual int size() const = 0;
+
+  virtual const sc_event &data_written_event() const = 0;
+};
+
+/**
+ * @brief Class stream_fifo
+ * Ring of N values, N a power of two, one reader and one writer process. A view
+ * ends at the end of the ring, so a block that wraps takes two views. Values are
+ * only copied by the writer, into its view.
+ */
+template <typename T, std::size_t N>
+class stream_fifo : public sc_channel, public stream_write_if<T>, public stream_read_if<T> {
+private:
+  static_assert(std::is_trivially_copyable<T>::value, "stream_fifo values must be trivially copyable");
+  static_assert((N >= 1) && (0 == (N & (N - 1))), "stream_fifo size must be a power of two");
+
+  T           ring[N];
+  std::size_t head;       // free running, oldest value at head & (N - 1)
+  std::size_t tail;       // free running, next free slot at tail & (N - 1)
+  std::size_t write_view; // values of the last write view not committed yet
+  std::size_t read_view;  // values of the last read view not released yet
+  sc_event    written_event, read_event;
+
+  fifo_span<T> free_view() {
+    std::size_t at = tail & (N - 1);
+
+    write_view = std::min(N - (tail - head), N - at);
+    return fifo_span<T>(ring + at, write_view);
+  }
+
+  fifo_span<const T> filled_view() {
+    std::size_t at = head & (N - 1);
+
+    read_view = std::min(tail - head, N - at);
+    return fifo_span<const T>(ring + at, read_view);
+  }
+
+public:
+  explicit stream_fifo(sc_module_name name)
+      : sc_channel(name), head(0), tail(0), write_view(0), read_view(0) {}
+
+  virtual const char *kind() const {
+    return "stream_fifo";
+  }
+
+  static constexpr std::size_t capacity() {
+    return N;
+  }
+
+  // stream_write_if
+
+  virtual fifo_span<T> acquire_write() {
+    while (N == tail - head) wait(read_event);
+    return free_view();
+  }
+
+  virtual fifo_span<T> try_acquire_write() {
+    return free_view();
+  }
+
+  virtual void commit_write(std::size_t count) {
+    sc_assert(count <= write_view);
+    if (0 == count) return;
+    write_view -= count;
+    tail += count;
+    written_event.notify();
+  }
+
+  virtual int num_free() const {
+    return (int)(N - (tail - head));
+  }
+
+  virtual const sc_event &data_read_event() const {
+    return read_event;
+  }
+
+  // stream_read_if
+
+  virtual fifo_span<const T> acquire_read() {
+    while (tail == head) wait(written_event);
+    return filled_view();
+  }
+
+  virtual fifo_span<const T> try_acquire_read() {
+    return filled_view();
+  }
+
+  virtual void release_read(std::size_t count) {
+    sc_assert(count <= read_view);
+    if (0 == count) return;
+    read_view -= count;
+    head += count;
+    read_event.notify();
+  }
+
+  virtual int size() const {
+    return (int)(tail - head);
+  }
+
+  virtual const sc_event &data_written_event() const {
+    return written_event;
+  }
+};
+
+#endif /* FIFO_HPP_ */
@@ -0,0 +1,430 @@
+/*******************************************************************************
+ * Copyright (C) 2023 by Salvador Z                                            *
+ *                                                                             *
+ * This file is part of SYSTEM_MODELS                                          *
+ *                                                                             *
+ *   Permission is hereby granted, free of charge, to any person obtaining a   *
+ *   copy of this software and associated documentation files (the Software)   *
+ *   to deal in the Software without restriction including without limitation  *
+ *   the rights to use, copy, modify, merge, publish, distribute, sublicense,  *
+ *   and/or sell copies ot the Software, and to permit persons to whom the     *
+ *   Software is furnished to do so, subject to the following conditions:      *
+ *                                                                             *
+ *   The above copyright notice and this permission notice shall be included   *
+ *   in all copies or substantial portions of the Software.                    *
+ *                                                                             *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS   *
+ *   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARANTIES OF MERCHANTABILITY *
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL   *
+ *   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR      *
+ *   OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,     *
+ *   ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE        *
+ *   OR OTHER DEALINGS IN THE SOFTWARE.                                        *
+ ******************************************************************************/
+
+
+/**
+ * @file fifo_monitor.hpp
+ * @author Salvador Z
+ * @version 1.0
+ * @brief File for the opt-in fifo occupancy and stall instrumentation
+ *
+ * Build with -DFIFO_MONITOR=1 and monitored_fifo<T, BASE> records, for a fifo of
+ * the sc_fifo family (sc_fifo, profile_fifo, ready_fifo, batch_fifo) or a fifo<T, N>:
+ *   - the simulated time spent at every occupancy, from empty to full
+ *   - the peak occupancy
+ *   - the time writers are stalled on a full fifo and readers on an empty one, from
+ *     a blocking call or a failed nb_write()/nb_read() (try_write()/try_read()) to
+ *     the next call that goes through
+ * FIFO_MONITOR_REPORT(base) writes base.json and prints the fifos that stalled their
+ * writers the longest. With FIFO_MONITOR 0 (default) monitored_fifo<T, BASE> is BASE.
+ */
+
+#ifndef FIFO_MONITOR_HPP_
+#define FIFO_MONITOR_HPP_
+
+// Includes
+#include "fifo.hpp"
+#include <systemc.h>
+
+#ifndef FIFO_MONITOR
+#define FIFO_MONITOR 0
+#endif
+
+#define FIFO_MONITOR_REPORT_TOP 10 // fifos printed at the end of the run
+
+#if FIFO_MONITOR
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Class fifo_monitor
+ * Occupancy and stall record of one fifo, registered with the fifo_monitor_registry.
+ * Times are in resolution ticks.
+ */
+class fifo_monitor {
+private:
+  std::string           name;
+  std::vector<uint64_t> time_at; // time spent at each occupancy, 0 to depth
+  int                   occupancy;
+  int                   peak;
+  uint64_t              since;   // time of the last occupancy change
+
+  bool     writer_stalled;
+  uint64_t writer_since;
+  uint64_t writer_time;
+  uint64_t writer_stalls;
+
+  bool     reader_stalled;
+  uint64_t reader_since;
+  uint64_t reader_time;
+  uint64_t reader_stalls;
+
+  static uint64_t now() {
+    return sc_time_stamp().value();
+  }
+
+public:
+  fifo_monitor(const char *fifo_name, int depth);
+  ~fifo_monitor();
+
+  fifo_monitor(const fifo_monitor &)            = delete;
+  fifo_monitor &operator=(const fifo_monitor &) = delete;
+
+  void set_occupancy(int count) {
+    uint64_t t = now();
+
+    if (count >= (int)time_at.size()) time_at.resize(count + 1, 0); // a batch_fifo counts pending writes
+    time_at[occupancy] += t - since;
+    since     = t;
+    occupancy = count;
+    peak      = std::max(peak, count);
+  }
+
+  // a write found the fifo full
+  void writer_blocked() {
+    if (writer_stalled) return;
+    writer_stalled = true;
+    writer_since   = now();
+    ++writer_stalls;
+  }
+
+  // a write went through
+  void writer_resumed() {
+    if (!writer_stalled) return;
+    writer_stalled = false;
+    writer_time += now() - writer_since;
+  }
+
+  void reader_blocked() {
+    if (reader_stalled) return;
+    reader_stalled = true;
+    reader_since   = now();
+    ++reader_stalls;
+  }
+
+  void reader_resumed() {
+    if (!reader_stalled) return;
+    reader_stalled = false;
+    reader_time += now() - reader_since;
+  }
+
+  // bring the occupancy time and the open stalls up to the current time
+  void close() {
+    set_occupancy(occupancy);
+    if (writer_stalled) {
+      writer_time += now() - writer_since;
+      writer_since = now();
+    }
+    if (reader_stalled) {
+      reader_time += now() - reader_since;
+      reader_since = now();
+    }
+  }
+
+  /**
+   * @brief smallest occupancy the fifo stayed at or under for the given share of the time
+   *
+   * @param share 0 to 1
+   */
+  int occupancy_quantile(double share) const {
+    uint64_t total = 0, sum = 0;
+
+    for (uint64_t t : time_at) total += t;
+    for (size_t i = 0; i < time_at.size(); i++) {
+      sum += time_at[i];
+      if (sum >= share * total) return (int)i;
+    }
+    return (int)time_at.size() - 1;
+  }
+
+  double mean_occupancy() const {
+    uint64_t total = 0;
+    double   sum   = 0.0;
+
+    for (size_t i = 0; i < time_at.size(); i++) {
+      total += time_at[i];
+      sum += (double)i * time_at[i];
+    }
+    return total ? sum / total : 0.0;
+  }
+
+  const std::string &get_name() const {
+    return name;
+  }
+
+  const std::vector<uint64_t> &get_time_at() const {
+    return time_at;
+  }
+
+  int get_depth() const {
+    return (int)time_at.size() - 1;
+  }
+
+  int get_peak() const {
+    return peak;
+  }
+
+  uint64_t get_writer_time() const {
+    return writer_time;
+  }
+
+  uint64_t get_writer_stalls() const {
+    return writer_stalls;
+  }
+
+  uint64_t get_reader_time() const {
+    return reader_time;
+  }
+
+  uint64_t get_reader_stalls() const {
+    return reader_stalls;
+  }
+};
+
+/**
+ * @brief Class fifo_monitor_registry
+ * The live fifo monitors, one registry per program.
+ */
+class fifo_monitor_registry {
+private:
+  std::vector<fifo_monitor *> monitors;
+
+  fifo_monitor_registry() {}
+
+public:
+  static fifo_monitor_registry &instance() {
+    static fifo_monitor_registry registry;
+    return registry;
+  }
+
+  void add(fifo_monitor *monitor) {
+    monitors.push_back(monitor);
+  }
+
+  void remove(fifo_monitor *monitor) {
+    monitors.erase(std::remove(monitors.begin(), monitors.end(), monitor), monitors.end());
+  }
+
+  /**
+   * @brief write base.json and print the fifos that stalled their writers the longest
+   * The json has, per fifo, the seconds spent at each occupancy from empty to full.
+   *
+   * @param base path of the report file without extension
+   */
+  void report(const char *base) {
+    const double tick_s = sc_get_time_resolution().to_seconds();
+    std::string  path   = std::string(base) + ".json";
+    FILE        *out    = fopen(path.c_str(), "w");
+    size_t       i;
+
+    for (fifo_monitor *monitor : monitors) monitor->close();
+
+    if (nullptr != out) {
+      fprintf(out, "{\n  \"sim_time_s\": %.9f,\n  \"fifos\": [", sc_time_stamp().to_seconds());
+      for (i = 0; i < monitors.size(); i++) {
+        const fifo_monitor &m = *monitors[i];
+
+        fprintf(out, "%s\n    {\"name\": \"%s\", \"depth\": %d, \"peak\": %d, \"mean\": %.3f, \"p99\": %d, ",
+                i ? "," : "", m.get_name().c_str(), m.get_depth(), m.get_peak(), m.mean_occupancy(),
+                m.occupancy_quantile(0.99));
+        fprintf(out, "\"writer_stalled_s\": %.9f, \"writer_stalls\": %llu, ", m.get_writer_time() * tick_s,
+                (unsigned long long)m.get_writer_stalls());
+        fprintf(out, "\"reader_stalled_s\": %.9f, \"reader_stalls\": %llu, \"occupancy_s\": [",
+                m.get_reader_time() * tick_s, (unsigned long long)m.get_reader_stalls());
+        for (size_t k = 0; k < m.get_time_at().size(); k++) {
+          fprintf(out, "%s%.9g", k ? ", " : "", m.get_time_at()[k] * tick_s);
+        }
+        fprintf(out, "]}");
+      }
+      fprintf(out, "\n  ]\n}\n");
+      fclose(out);
+    } else {
+      perror(path.c_str());
+    }
+
+    // most stalled writers first
+    std::vector<const fifo_monitor *> sorted(monitors.begin(), monitors.end());
+    std::sort(sorted.begin(), sorted.end(), [](const fifo_monitor *a, const fifo_monitor *b) {
+      return (a->get_writer_time() != b->get_writer_time()) ? (a->get_writer_time() > b->get_writer_time())
+                                                            : (a->get_peak() > b->get_peak());
+    });
+
+    printf("\nfifo_monitor: %zu fifos, report in %s.json\n", monitors.size(), base);
+    printf("  %-40s %6s %6s %8s %6s %8s %8s %14s %14s\n", "fifo", "depth", "peak", "mean", "p99", "empty %",
+           "full %", "writer stall s", "reader stall s");
+    for (i = 0; (i < sorted.size()) && (i < (size_t)FIFO_MONITOR_REPORT_TOP); i++) {
+      const fifo_monitor          &m     = *sorted[i];
+      const std::vector<uint64_t> &t     = m.get_time_at();
+      uint64_t                     total = 0;
+
+      for (uint64_t ticks : t) total += ticks;
+      if (0 == total) total = 1;
+      printf("  %-40s %6d %6d %8.2f %6d %8.2f %8.2f %14.6f %14.6f\n", m.get_name().c_str(), m.get_depth(),
+             m.get_peak(), m.mean_occupancy(), m.occupancy_quantile(0.99), 100.0 * t.front() / total,
+             100.0 * t.back() / total, m.get_writer_time() * tick_s, m.get_reader_time() * tick_s);
+    }
+  }
+};
+
+inline fifo_monitor::fifo_monitor(const char *fifo_name, int depth)
+    : name(fifo_name), time_at(std::max(depth, 0) + 1, 0), occupancy(0), peak(0), since(0),
+      writer_stalled(false), writer_since(0), writer_time(0), writer_stalls(0), reader_stalled(false),
+      reader_since(0), reader_time(0), reader_stalls(0) {
+  fifo_monitor_registry::instance().add(this);
+}
+
+inline fifo_monitor::~fifo_monitor() {
+  fifo_monitor_registry::instance().remove(this);
+}
+
+/**
+ * @brief Class monitored_fifo
+ * A fifo of the sc_fifo family with its occupancy sampled in the update phase, when
+ * the values written in the delta cycle become readable, and its stalls recorded
+ * around the read and write calls.
+ */
+template <typename T, typename BASE = sc_fifo<T> >
+class monitored_fifo : public BASE {
+private:
+  fifo_monitor monitor;
+
+public:
+  explicit monitored_fifo(const char *name, int size = 16) : BASE(name, size), monitor(this->name(), size) {}
+
+  virtual void write(const T &value) {
+    if (0 == this->num_free()) monitor.writer_blocked();
+    BASE::write(value);
+    monitor.writer_resumed();
+  }
+
+  virtual bool nb_write(const T &value) {
+    if (!BASE::nb_write(value)) {
+      monitor.writer_blocked();
+      return false;
+    }
+    monitor.writer_resumed();
+    return true;
+  }
+
+  virtual void read(T &value) {
+    if (0 == this->num_available()) monitor.reader_blocked();
+    BASE::read(value);
+    monitor.reader_resumed();
+  }
+
+  virtual T read() {
+    T value;
+
+    read(value);
+    return value;
+  }
+
+  virtual bool nb_read(T &value) {
+    if (!BASE::nb_read(value)) {
+      monitor.reader_blocked();
+      return false;
+    }
+    monitor.reader_resumed();
+    return true;
+  }
+
+protected:
+  virtual void update() {
+    BASE::update();
+    monitor.set_occupancy(this->num_available());
+  }
+};
+
+/**
+ * @brief Class monitored_fifo
+ * fifo<T, N> notifies immediately, its occupancy is sampled on every read and write.
+ */
+template <typename T, std::size_t N>
+class monitored_fifo<T, fifo<T, N> > : public fifo<T, N> {
+private:
+  fifo_monitor monitor;
+
+public:
+  using fifo<T, N>::write;
+  using fifo<T, N>::try_write;
+
+  explicit monitored_fifo(sc_module_name name) : fifo<T, N>(name), monitor(this->name(), (int)N) {}
+
+  virtual void write(T &&value) {
+    if (this->full()) monitor.writer_blocked();
+    fifo<T, N>::write(std::move(value));
+    monitor.writer_resumed();
+    monitor.set_occupancy(this->size());
+  }
+
+  virtual bool try_write(T &&value) {
+    if (!fifo<T, N>::try_write(std::move(value))) {
+      monitor.writer_blocked();
+      return false;
+    }
+    monitor.writer_resumed();
+    monitor.set_occupancy(this->size());
+    return true;
+  }
+
+  virtual void read(T &value) {
+    if (this->empty()) monitor.reader_blocked();
+    fifo<T, N>::read(value);
+    monitor.reader_resumed();
+    monitor.set_occupancy(this->size());
+  }
+
+  virtual bool try_read(T &value) {
+    if (!fifo<T, N>::try_read(value)) {
+      monitor.reader_blocked();
+      return false;
+    }
+    monitor.reader_resumed();
+    monitor.set_occupancy(this->size());
+    return true;
+  }
+
+  virtual void reset() {
+    fifo<T, N>::reset();
+    monitor.set_occupancy(0);
+  }
+};
+
+#define FIFO_MONITOR_REPORT(base) fifo_monitor_registry::instance().report(base)
+
+#else
+
+// compiled out
+template <typename T, typename BASE = sc_fifo<T> >
+using monitored_fifo = BASE;
+
+#define FIFO_MONITOR_REPORT(base) ((void)0)
+
+#endif /* FIFO_MONITOR */
+
+#endif /* FIFO_MONITOR_HPP_ */
@@ -0,0 +1,207 @@
+/*******************************************************************************
+ * Copyright (C) 2023 by Salvador Z                                            *
+ *                                                                             *
+ * This file is part of SYSTEM_MODELS                                          *
+ *                                                                             *
+ *   Permission is hereby granted, free of charge, to any person obtaining a   *
+ *   copy of this software and associated documentation files (the Software)   *
+ *   to deal in the Software without restriction including without limitation  *
+ *   the rights to use, copy, modify, merge, publish, distribute, sublicense,  *
+ *   and/or sell copies ot the Software, and to permit persons to whom the     *
+ *   Software is furnished to do so, subject to the following conditions:      *
+ *                                                                             *
+ *   The above copyright notice and this permission notice shall be included   *
+ *   in all copies or substantial portions of the Software.                    *
+ *                                                                             *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS   *
+ *   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARANTIES OF MERCHANTABILITY *
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL   *
+ *   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR      *
+ *   OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,     *
+ *   ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE        *
+ *   OR OTHER DEALINGS IN THE SOFTWARE.                                        *
+ ******************************************************************************/
+
+
+/**
+ * @file hdr_histogram.hpp
+ * @author Salvador Z
+ * @version 1.0
+ * @brief File for the fixed memory, log bucketed latency histogram
+ *
+ * Values are non negative integers (time resolution ticks). Every power of two
+ * range is split in HDR_SUB_BUCKETS linear buckets, so a recorded value is
+ * known within 1 / HDR_SUB_BUCKETS of itself over the whole 64 bit range.
+ */
+
+#ifndef HDR_HISTOGRAM_HPP_
+#define HDR_HISTOGRAM_HPP_
+
+// Includes
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#define HDR_SUB_BUCKET_BITS 6 // 64 sub buckets, 1.6% relative precision
+#define HDR_SUB_BUCKETS     (1 << HDR_SUB_BUCKET_BITS)
+#define HDR_BUCKETS         ((64 - HDR_SUB_BUCKET_BITS + 1) * HDR_SUB_BUCKETS)
+#define HDR_LINE_TAG        "histogram:" // start of the lines written by print_line()
+
+/**
+ * @brief Class hdr_histogram
+ * record() is a count increment at an index computed from the leading zeros of the
+ * value, nothing is allocated. The class is trivially copyable so it can go to a
+ * checkpoint as is, and histograms of different runs add up with merge().
+ */
+class hdr_histogram {
+private:
+  uint64_t counts[HDR_BUCKETS];
+  uint64_t total;
+  uint64_t min_value;
+  uint64_t max_value;
+  double   sum; // for the mean, a 64 bit sum of ps values overflows
+
+  static int index_of(uint64_t value) {
+    int shift;
+
+    if (value < HDR_SUB_BUCKETS) return (int)value;
+    shift = 63 - __builtin_clzll(value) - HDR_SUB_BUCKET_BITS;
+    return ((shift + 1) << HDR_SUB_BUCKET_BITS) + (int)((value >> shift) - HDR_SUB_BUCKETS);
+  }
+
+  // largest value counted in the bucket
+  static uint64_t highest_of(int index) {
+    int      shift;
+    uint64_t sub;
+
+    if (index < HDR_SUB_BUCKETS) return (uint64_t)index;
+    shift = (index >> HDR_SUB_BUCKET_BITS) - 1;
+    sub   = (uint64_t)(index & (HDR_SUB_BUCKETS - 1)) + HDR_SUB_BUCKETS;
+    return ((sub + 1) << shift) - 1;
+  }
+
+public:
+  hdr_histogram() {
+    reset();
+  }
+
+  void reset() {
+    memset(counts, 0, sizeof(counts));
+    total     = 0;
+    min_value = UINT64_MAX;
+    max_value = 0;
+    sum       = 0.0;
+  }
+
+  void record(uint64_t value) {
+    ++counts[index_of(value)];
+    ++total;
+    if (value < min_value) min_value = value;
+    if (value > max_value) max_value = value;
+    sum += (double)value;
+  }
+
+  void merge(const hdr_histogram &other) {
+    for (int i = 0; i < HDR_BUCKETS; i++) counts[i] += other.counts[i];
+    total += other.total;
+    if (other.min_value < min_value) min_value = other.min_value;
+    if (other.max_value > max_value) max_value = other.max_value;
+    sum += other.sum;
+  }
+
+  uint64_t get_count() const {
+    return total;
+  }
+
+  uint64_t get_min() const {
+    return total ? min_value : 0;
+  }
+
+  uint64_t get_max() const {
+    return max_value;
+  }
+
+  double get_mean() const {
+    return total ? sum / total : 0.0;
+  }
+
+  /**
+   * @brief smallest value with at least pct percent of the values at or under it,
+   * rounded up to the end of its bucket
+   *
+   * @param pct percentile in [0, 100]
+   */
+  uint64_t percentile(double pct) const {
+    uint64_t rank = (uint64_t)(pct / 100.0 * total + 0.5);
+    uint64_t seen = 0;
+
+    if (rank < 1) rank = 1;
+    for (int i = 0; i < HDR_BUCKETS; i++) {
+      seen += counts[i];
+      if (seen >= rank) return (highest_of(i) < max_value) ? highest_of(i) : max_value;
+    }
+    return max_value;
+  }
+
+  /**
+   * @brief print count, mean, p50, p99, p999 and max
+   *
+   * @param name histogram name
+   * @param unit_s one value in seconds
+   */
+  void print(const char *name, double unit_s) const {
+    const double ms = unit_s * 1e3;
+
+    printf("  %-16s = %llu, mean %.3f ms, p50 %.3f ms, p99 %.3f ms, p999 %.3f ms, max %.3f ms\n", name,
+           (unsigned long long)total, get_mean() * ms, percentile(50.0) * ms, percentile(99.0) * ms,
+           percentile(99.9) * ms, max_value * ms);
+  }
+
+  /**
+   * @brief write the non empty buckets on one line, read back by parse_line()
+   *
+   * @param name histogram name, no blanks
+   * @param unit_fs one value in femtoseconds
+   */
+  void print_line(const char *name, uint64_t unit_fs) const {
+    printf("%s %s unit_fs=%llu min=%llu max=%llu sum=%.17g", HDR_LINE_TAG, name, (unsigned long long)unit_fs,
+           (unsigned long long)get_min(), (unsigned long long)max_value, sum);
+    for (int i = 0; i < HDR_BUCKETS; i++) {
+      if (counts[i]) printf(" %d:%llu", i, (unsigned long long)counts[i]);
+    }
+    printf("\n");
+  }
+
+  /**
+   * @brief add the values of a line written by print_line()
+   *
+   * @param line text after the name
+   * @param unit_fs set to the unit of the line
+   * @return false when the line is malformed
+   */
+  bool parse_line(const char *line, uint64_t &unit_fs) {
+    unsigned long long unit, min, max, count;
+    double             line_sum;
+    int                index, used;
+
+    if (4 != sscanf(line, " unit_fs=%llu min=%llu max=%llu sum=%lf%n", &unit, &min, &max, &line_sum, &used)) {
+      return false;
+    }
+    unit_fs = unit;
+
+    hdr_histogram other;
+    for (line += used; 2 == sscanf(line, " %d:%llu%n", &index, &count, &used); line += used) {
+      if ((index < 0) || (index >= HDR_BUCKETS)) return false;
+      other.counts[index] += count;
+      other.total += count;
+    }
+    other.min_value = other.total ? min : UINT64_MAX;
+    other.max_value = max;
+    other.sum       = line_sum;
+    merge(other);
+    return true;
+  }
+};
+
+#endif /* HDR_HISTOGRAM_HPP_ */
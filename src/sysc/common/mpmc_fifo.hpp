@@ -0,0 +1,292 @@
+/*******************************************************************************
+ * Copyright (C) 2023 by Salvador Z                                            *
+ *                                                                             *
+ * This file is part of SYSTEM_MODELS                                          *
+ *                                                                             *
+ *   Permission is hereby granted, free of charge, to any person obtaining a   *
+ *   copy of this software and associated documentation files (the Software)   *
+ *   to deal in the Software without restriction including without limitation  *
+ *   the rights to use, copy, modify, merge, publish, distribute, sublicense,  *
+ *   and/or sell copies ot the Software, and to permit persons to whom the     *
+ *   Software is furnished to do so, subject to the following conditions:      *
+ *                                                                             *
+ *   The above copyright notice and this permission notice shall be included   *
+ *   in all copies or substantial portions of the Software.                    *
+ *                                                                             *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS   *
+ *   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARANTIES OF MERCHANTABILITY *
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL   *
+ *   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR      *
+ *   OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,     *
+ *   ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE        *
+ *   OR OTHER DEALINGS IN THE SOFTWARE.                                        *
+ ******************************************************************************/
+
+
+/**
+ * @file mpmc_fifo.hpp
+ * @author Salvador Z
+ * @version 1.0
+ * @brief File for the multiple producer, multiple consumer fifo channel
+ *
+ * mpmc_fifo<T, N> has the read_if<T>/write_if<T> of fifo<T, N> for any number of
+ * reader and writer processes. fifo<T, N> wakes every blocked process on each
+ * transfer and all but one go back to sleep; here a blocked process waits on its
+ * own event, in a queue per side, and a transfer wakes exactly one:
+ *   - a write with readers queued hands the value to the oldest reader
+ *   - a read of a full fifo with writers queued moves the oldest writer's value in
+ * The woken process finds its transfer done and never retries, so the waiters are
+ * served in the order they blocked and a late try_read()/try_write() cannot take
+ * the value or the slot of a queued one.
+ */
+
+#ifndef MPMC_FIFO_HPP_
+#define MPMC_FIFO_HPP_
+
+// Includes
+#include "fifo.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <new>
+#include <systemc.h>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Class mpmc_fifo
+ * Ring of N values, any number of reader and writer processes.
+ */
+template <typename T, std::size_t N>
+class mpmc_fifo : public sc_channel, public write_if<T>, public read_if<T> {
+private:
+  static_assert(N >= 1, "mpmc_fifo capacity must be at least 1");
+
+  static constexpr bool power_of_two = (0 == (N & (N - 1)));
+
+  // a blocked process, kept in the pool between calls
+  struct waiter {
+    T       *value; // reader: destination, writer: value to move in
+    bool     done;  // transfer made by the other side
+    sc_event event;
+    waiter  *next;
+  };
+
+  // waiters in the order they blocked
+  struct waiter_queue {
+    waiter *first = nullptr;
+    waiter *last  = nullptr;
+
+    bool empty() const {
+      return nullptr == first;
+    }
+
+    void push(waiter *w) {
+      w->next = nullptr;
+      if (nullptr == last) {
+        first = w;
+      } else {
+        last->next = w;
+      }
+      last = w;
+    }
+
+    waiter *pop() {
+      waiter *w = first;
+
+      first = w->next;
+      if (nullptr == first) last = nullptr;
+      return w;
+    }
+  };
+
+  alignas(T) unsigned char storage[N * sizeof(T)]; // constructed from head to head + count
+
+  std::size_t head; // oldest value
+  std::size_t count;
+  sc_event    written_event, read_event; // for the try_read()/try_write() users
+
+  waiter_queue          readers; // only while the ring is empty
+  waiter_queue          writers; // only while the ring is full
+  std::deque<waiter>    pool;    // one per process ever blocked at the same time
+  std::vector<waiter *> spare;
+  uint64_t              wakeups;
+
+  static std::size_t wrap(std::size_t i) {
+    if (power_of_two) return i & (N - 1);
+    return (i >= N) ? i - N : i;
+  }
+
+  T *slot(std::size_t i) {
+    return reinterpret_cast<T *>(storage) + i;
+  }
+
+  const T *slot(std::size_t i) const {
+    return reinterpret_cast<const T *>(storage) + i;
+  }
+
+  void push(T &&value) {
+    new (slot(wrap(head + count))) T(std::move(value));
+    ++count;
+    written_event.notify();
+  }
+
+  void pop(T &value) {
+    T *oldest = slot(head);
+
+    value = std::move(*oldest);
+    oldest->~T();
+    head = wrap(head + 1);
+    --count;
+    read_event.notify();
+  }
+
+  waiter *get_waiter(T *value) {
+    waiter *w;
+
+    if (spare.empty()) {
+      pool.emplace_back();
+      w = &pool.back();
+    } else {
+      w = spare.back();
+      spare.pop_back();
+    }
+    w->value = value;
+    w->done  = false;
+    return w;
+  }
+
+  // block the calling process until the other side has made its transfer
+  void block(waiter_queue &queue, T *value) {
+    waiter *w = get_waiter(value);
+
+    queue.push(w);
+    while (!w->done) wait(w->event);
+    spare.push_back(w);
+  }
+
+  void wake(waiter *w) {
+    w->done = true;
+    ++wakeups;
+    w->event.notify();
+  }
+
+  // the ring is empty, give the value to the oldest reader
+  void hand_off(T &&value) {
+    waiter *w = readers.pop();
+
+    *w->value = std::move(value);
+    written_event.notify();
+    read_event.notify();
+    wake(w);
+  }
+
+  // a slot was freed, move the oldest writer's value in
+  void admit_writer() {
+    if (writers.empty()) return;
+
+    waiter *w = writers.pop();
+
+    push(std::move(*w->value));
+    wake(w);
+  }
+
+public:
+  using write_if<T>::write;
+  using write_if<T>::try_write;
+
+  explicit mpmc_fifo(sc_module_name name) : sc_channel(name), head(0), count(0), wakeups(0) {}
+
+  ~mpmc_fifo() {
+    for (; count > 0; --count) {
+      slot(head)->~T();
+      head = wrap(head + 1);
+    }
+  }
+
+  virtual const char *kind() const {
+    return "mpmc_fifo";
+  }
+
+  static constexpr std::size_t capacity() {
+    return N;
+  }
+
+  // processes woken, one per transfer made for a blocked process
+  uint64_t get_wakeups() const {
+    return wakeups;
+  }
+
+  // write_if
+
+  virtual void write(T &&value) {
+    if (!readers.empty()) {
+      hand_off(std::move(value));
+    } else if (count < N) {
+      push(std::move(value));
+    } else {
+      block(writers, &value); // value stays alive on the caller's stack until moved in
+    }
+  }
+
+  virtual bool try_write(T &&value) {
+    if (!readers.empty()) {
+      hand_off(std::move(value));
+    } else if (count < N) {
+      push(std::move(value));
+    } else {
+      return false;
+    }
+    return true;
+  }
+
+  virtual int num_free() const {
+    return (int)(N - count);
+  }
+
+  // drop the values, queued writers move in as far as there is room
+  virtual void reset() {
+    for (; count > 0; --count) {
+      slot(head)->~T();
+      head = wrap(head + 1);
+    }
+    head = 0;
+    while ((count < N) && !writers.empty()) admit_writer();
+  }
+
+  virtual const sc_event &data_read_event() const {
+    return read_event;
+  }
+
+  // read_if
+
+  virtual void read(T &value) {
+    if (count > 0) {
+      pop(value);
+      admit_writer();
+    } else {
+      block(readers, &value);
+    }
+  }
+
+  virtual bool try_read(T &value) {
+    if (0 == count) return false;
+    pop(value);
+    admit_writer();
+    return true;
+  }
+
+  virtual const T *peek() const {
+    return (0 == count) ? nullptr : slot(head);
+  }
+
+  virtual int size() const {
+    return (int)count;
+  }
+
+  virtual const sc_event &data_written_event() const {
+    return written_event;
+  }
+};
+
+#endif /* MPMC_FIFO_HPP_ */
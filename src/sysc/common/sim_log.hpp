@@ -0,0 +1,488 @@
+/*******************************************************************************
+ * Copyright (C) 2023 by Salvador Z                                            *
+ *                                                                             *
+ * This file is part of SYSTEM_MODELS                                          *
+ *                                                                             *
+ *   Permission is hereby granted, free of charge, to any person obtaining a   *
+ *   copy of this software and associated documentation files (the Software)   *
+ *   to deal in the Software without restriction including without limitation  *
+ *   the rights to use, copy, modify, merge, publish, distribute, sublicense,  *
+ *   and/or sell copies ot the Software, and to permit persons to whom the     *
+ *   Software is furnished to do so, subject to the following conditions:      *
+ *                                                                             *
+ *   The above copyright notice and this permission notice shall be included   *
+ *   in all copies or substantial portions of the Software.                    *
+ *                                                                             *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS   *
+ *   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARANTIES OF MERCHANTABILITY *
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL   *
+ *   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR      *
+ *   OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,     *
+ *   ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE        *
+ *   OR OTHER DEALINGS IN THE SOFTWARE.                                        *
+ ******************************************************************************/
+
+
+/**
+ * @file sim_log.hpp
+ * @author Salvador Z
+ * @version 1.0
+ * @brief File for the asynchronous logger of the models
+ *
+ * SIM_LOG(source, level, format, ...) copies the format pointer, the arguments and
+ * the simulated time into a record of a lock-free ring and returns; a writer thread
+ * formats the records and writes them to stdout in large blocks. A line looks like
+ *
+ *   [     1.250000000 s] top.scanner_inst info: turning on
+ *
+ * The format must be a string literal, it is read by the writer later on. %s
+ * arguments are copied into the record (SIM_LOG_TEXT_SIZE bytes for all of them),
+ * the other conversions take numbers and '*' widths are not supported.
+ *
+ * Every module logs through its own sim_log_source, whose level comes from the
+ * longest set_level() prefix of its name. Levels above SIM_LOG_COMPILE_LEVEL are
+ * removed at compile time, e.g. -DSIM_LOG_COMPILE_LEVEL=SIM_LOG_WARN. Records are
+ * pushed by the SystemC kernel thread only, the ring has a single producer.
+ */
+
+#ifndef SIM_LOG_HPP_
+#define SIM_LOG_HPP_
+
+// Includes
+#include "spsc_ring.hpp"
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <string>
+#include <systemc.h>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// levels, the lower the more severe
+#define SIM_LOG_ERROR 0
+#define SIM_LOG_WARN  1
+#define SIM_LOG_INFO  2
+#define SIM_LOG_DEBUG 3
+#define SIM_LOG_TRACE 4
+#define SIM_LOG_OFF   -1 // source level, nothing logged
+
+#ifndef SIM_LOG_COMPILE_LEVEL
+#define SIM_LOG_COMPILE_LEVEL SIM_LOG_TRACE // every level compiled in
+#endif
+
+#define SIM_LOG_DEFAULT_LEVEL SIM_LOG_INFO
+#define SIM_LOG_RING_SIZE     4096  // records, a power of two
+#define SIM_LOG_MAX_ARGS      6     // arguments of a record
+#define SIM_LOG_TEXT_SIZE     96    // bytes of the copied %s arguments of a record
+#define SIM_LOG_BUFFER_SIZE   65536 // bytes formatted before a write
+#define SIM_LOG_IDLE_US       200   // writer sleep on an empty ring
+
+static const char *const sim_log_level_names[] = {"error", "warn", "info", "debug", "trace"};
+
+// level must be a constant, the levels above SIM_LOG_COMPILE_LEVEL leave no code
+#define SIM_LOG(source, level, ...)                                             \
+  do {                                                                          \
+    if constexpr ((level) <= SIM_LOG_COMPILE_LEVEL) {                           \
+      if ((source).enabled(level)) (source).log((level), __VA_ARGS__);          \
+    }                                                                           \
+  } while (0)
+
+/**
+ * @brief one argument of a record
+ *
+ */
+struct sim_log_arg {
+  enum { SIGNED, UNSIGNED, REAL, TEXT } type;
+  int size; // bytes of the logged value, %u/%x/%o print a signed one at its own width
+
+  union {
+    long long          i;
+    unsigned long long u;
+    double             d;
+    size_t             text; // offset in sim_log_record::text
+  };
+};
+
+/**
+ * @brief one log entry, formatted by the writer thread
+ *
+ */
+struct sim_log_record {
+  const char *format;
+  const char *source; // name of the sim_log_source, owned by the logger
+  uint64_t    time;   // simulated time, resolution ticks
+  int         level;
+  int         count;  // arguments
+  sim_log_arg args[SIM_LOG_MAX_ARGS];
+  char        text[SIM_LOG_TEXT_SIZE];
+};
+
+class sim_log;
+
+/**
+ * @brief Class sim_log_source
+ * Named origin of log records, usually one per module. Owned by the logger, so its
+ * name outlives the module for the writer thread.
+ */
+class sim_log_source {
+private:
+  friend class sim_log;
+
+  std::string name;
+  int         level;
+  sim_log    *logger;
+
+  // arguments into the record, one overload per argument kind
+  template <typename T>
+  static void put(sim_log_record &record, size_t &used, const T &value) {
+    sim_log_arg &arg = record.args[record.count++];
+
+    arg.size = (int)sizeof(T);
+    if (std::is_floating_point<T>::value) {
+      arg.type = sim_log_arg::REAL;
+      arg.d    = (double)value;
+    } else if (std::is_signed<T>::value) {
+      arg.type = sim_log_arg::SIGNED;
+      arg.i    = (long long)value;
+    } else {
+      arg.type = sim_log_arg::UNSIGNED;
+      arg.u    = (unsigned long long)value;
+    }
+    (void)used;
+  }
+
+  static void put(sim_log_record &record, size_t &used, const char *value) {
+    sim_log_arg &arg = record.args[record.count++];
+    const char  *text = value ? value : "(null)";
+    size_t       len  = strlen(text);
+
+    // truncated to the room left, an argument without room points at the final '\0'
+    if (used >= SIM_LOG_TEXT_SIZE) {
+      arg.type = sim_log_arg::TEXT;
+      arg.text = SIM_LOG_TEXT_SIZE - 1;
+      return;
+    }
+    if (used + len + 1 > SIM_LOG_TEXT_SIZE) len = SIM_LOG_TEXT_SIZE - used - 1;
+    arg.type = sim_log_arg::TEXT;
+    arg.text = used;
+    memcpy(record.text + used, text, len);
+    record.text[used + len] = '\0';
+    used += len + 1;
+  }
+
+  static void put(sim_log_record &record, size_t &used, char *value) {
+    put(record, used, (const char *)value);
+  }
+
+  static void put(sim_log_record &record, size_t &used, const std::string &value) {
+    put(record, used, value.c_str());
+  }
+
+public:
+  sim_log_source(const std::string &source_name, int source_level, sim_log *owner)
+      : name(source_name), level(source_level), logger(owner) {}
+
+  bool enabled(int record_level) const {
+    return record_level <= level;
+  }
+
+  const char *get_name() const {
+    return name.c_str();
+  }
+
+  int get_level() const {
+    return level;
+  }
+
+  template <typename... Args>
+  void log(int record_level, const char *format, const Args &...args);
+};
+
+/**
+ * @brief Class sim_log
+ * The logger: ring, writer thread and sources. One instance per process.
+ */
+class sim_log {
+private:
+  struct level_rule {
+    std::string prefix;
+    int         level;
+  };
+
+  spsc_ring<sim_log_record, SIM_LOG_RING_SIZE> ring;
+  std::deque<sim_log_source>                   sources; // stable addresses
+  std::vector<level_rule>                      rules;
+  int                                          default_level;
+  FILE                                        *output;
+  double                                       tick_s;      // simulated time resolution
+  const uint64_t                              *time_source; // simulated time, nullptr for sc_time_stamp()
+  std::thread                                  writer;
+  std::atomic<bool>                            stopping;
+  std::atomic<uint64_t>                        written; // records formatted and written out
+  uint64_t                                     pushed;  // kernel thread only
+  uint64_t                                     full_waits;
+  std::vector<char>                            buffer;
+  size_t                                       buffered;
+
+  int level_of(const std::string &name) const {
+    int    level = default_level;
+    size_t best  = 0;
+
+    for (const level_rule &rule : rules) {
+      if ((0 == name.compare(0, rule.prefix.size(), rule.prefix)) && (rule.prefix.size() >= best)) {
+        best  = rule.prefix.size();
+        level = rule.level;
+      }
+    }
+    return level;
+  }
+
+  void write_out() {
+    if (0 != buffered) fwrite(buffer.data(), 1, buffered, output);
+    fflush(output);
+    buffered = 0;
+  }
+
+  // append to the buffer, snprintf style
+  template <typename... Args>
+  void append(const char *format, Args... args) {
+    int len = snprintf(&buffer[buffered], buffer.size() - buffered, format, args...);
+
+    if (len > 0) buffered += std::min((size_t)len, buffer.size() - buffered - 1);
+  }
+
+  /**
+   * @brief format one record into the buffer, one conversion at a time with its own argument
+   *
+   */
+  void format(const sim_log_record &record) {
+    const char *p = record.format;
+    char        spec[32];
+    int         next = 0;
+
+    if (buffer.size() - buffered < 1024) write_out();
+
+    append("[%16.9f s] %s %s: ", record.time * tick_s, record.source, sim_log_level_names[record.level]);
+
+    while (*p && (buffered + 256 < buffer.size())) {
+      if ('%' != *p) {
+        buffer[buffered++] = *p++;
+        continue;
+      }
+      if ('%' == p[1]) {
+        buffer[buffered++] = '%';
+        p += 2;
+        continue;
+      }
+
+      // flags, width and precision are kept, the length modifiers are replaced
+      size_t len = 0;
+
+      spec[len++] = *p++;
+      while (*p && strchr("-+ #0123456789.", *p) && (len < sizeof(spec) - 4)) spec[len++] = *p++;
+      while (*p && strchr("hlLqjzt", *p)) p++;
+      if (!*p) break;
+
+      const char         conversion = *p++;
+      const sim_log_arg *arg        = (next < record.count) ? &record.args[next++] : nullptr;
+
+      if (nullptr == arg) {
+        append("(missing)");
+      } else if ('c' == conversion) {
+        spec[len++] = 'c';
+        spec[len]   = '\0';
+        append(spec, (sim_log_arg::REAL == arg->type) ? (int)arg->d : (int)arg->i);
+      } else if (strchr("diouxX", conversion)) {
+        long long value = (sim_log_arg::REAL == arg->type) ? (long long)arg->d : arg->i;
+
+        // -1 as an int is ffffffff with %x, as printf prints it, not the 64 bit sign extension
+        if (strchr("ouxX", conversion) && (sim_log_arg::SIGNED == arg->type) &&
+            (arg->size < (int)sizeof(long long))) {
+          value = (long long)((unsigned long long)value & ((1ULL << (8 * arg->size)) - 1));
+        }
+        spec[len++] = 'l';
+        spec[len++] = 'l';
+        spec[len++] = conversion;
+        spec[len]   = '\0';
+        append(spec, value);
+      } else if (strchr("feEgGaA", conversion)) {
+        double value = (sim_log_arg::REAL == arg->type)     ? arg->d
+                       : (sim_log_arg::SIGNED == arg->type) ? (double)arg->i
+                                                             : (double)arg->u;
+
+        spec[len++] = conversion;
+        spec[len]   = '\0';
+        append(spec, value);
+      } else if ('s' == conversion) {
+        spec[len++] = 's';
+        spec[len]   = '\0';
+        append(spec, (sim_log_arg::TEXT == arg->type) ? record.text + arg->text : "(not text)");
+      } else {
+        append("(bad conversion)");
+      }
+    }
+    if ((0 == buffered) || ('\n' != buffer[buffered - 1])) buffer[buffered++] = '\n';
+  }
+
+  void run() {
+    sim_log_record record;
+    uint64_t       popped = 0;
+
+    while (true) {
+      if (ring.try_pop(record)) {
+        format(record);
+        ++popped;
+        continue;
+      }
+      write_out();
+      written.store(popped, std::memory_order_release);
+      if (stopping.load(std::memory_order_acquire) && ring.empty()) return;
+      std::this_thread::sleep_for(std::chrono::microseconds(SIM_LOG_IDLE_US));
+    }
+  }
+
+  void start() {
+    tick_s = sc_get_time_resolution().to_seconds();
+    writer = std::thread(&sim_log::run, this);
+  }
+
+public:
+  sim_log()
+      : default_level(SIM_LOG_DEFAULT_LEVEL), output(stdout), tick_s(0.0), time_source(nullptr),
+        stopping(false), written(0), pushed(0), full_waits(0), buffer(SIM_LOG_BUFFER_SIZE), buffered(0) {}
+
+  ~sim_log() {
+    stop();
+  }
+
+  static sim_log &instance() {
+    static sim_log logger;
+    return logger;
+  }
+
+  /**
+   * @brief source of the given name, created on first use
+   *
+   */
+  sim_log_source &source(const char *name) {
+    for (sim_log_source &src : sources) {
+      if (src.name == name) return src;
+    }
+    sources.emplace_back(name, level_of(name), this);
+    return sources.back();
+  }
+
+  // level of the sources starting with prefix, the longest prefix wins
+  void set_level(const char *prefix, int level) {
+    rules.push_back({prefix, level});
+    for (sim_log_source &src : sources) src.level = level_of(src.name);
+  }
+
+  // time of the records read from *ticks (resolution ticks) rather than sc_time_stamp(), for a
+  // model run outside the kernel such as a cycle_sim; nullptr goes back to sc_time_stamp()
+  void set_time_source(const uint64_t *ticks) {
+    time_source = ticks;
+  }
+
+  uint64_t now() const {
+    return (nullptr != time_source) ? *time_source : sc_time_stamp().value();
+  }
+
+  // level of the sources without a matching prefix
+  void set_default_level(int level) {
+    default_level = level;
+    for (sim_log_source &src : sources) src.level = level_of(src.name);
+  }
+
+  /**
+   * @brief parse "prefix=level", with level a name (error, warn, info, debug, trace, off) or a number
+   *
+   * @return false when the text is not valid
+   */
+  bool set_level(const char *text) {
+    const char *equal = strchr(text, '=');
+    int         level;
+
+    if ((nullptr == equal) || !parse_level(equal + 1, level)) return false;
+    set_level(std::string(text, equal - text).c_str(), level);
+    return true;
+  }
+
+  static bool parse_level(const char *text, int &level) {
+    char *end;
+
+    if (0 == strcmp(text, "off")) {
+      level = SIM_LOG_OFF;
+      return true;
+    }
+    for (int i = SIM_LOG_ERROR; i <= SIM_LOG_TRACE; i++) {
+      if (0 == strcmp(text, sim_log_level_names[i])) {
+        level = i;
+        return true;
+      }
+    }
+    level = (int)strtol(text, &end, 10);
+    return ('\0' != *text) && ('\0' == *end) && (level >= SIM_LOG_OFF) && (level <= SIM_LOG_TRACE);
+  }
+
+  /**
+   * @brief hand a record to the writer thread, waits for room when the ring is full
+   *
+   */
+  void push(const sim_log_record &record) {
+    if (!writer.joinable()) start();
+    if (!ring.try_push(record)) {
+      ++full_waits;
+      while (!ring.try_push(record)) std::this_thread::yield();
+    }
+    ++pushed;
+  }
+
+  /**
+   * @brief wait for the records pushed so far to be written out, before printing to stdout directly
+   *
+   */
+  void flush() {
+    while (writer.joinable() && (written.load(std::memory_order_acquire) < pushed)) {
+      std::this_thread::yield();
+    }
+    fflush(output);
+  }
+
+  // flush and join the writer thread, once
+  void stop() {
+    if (!writer.joinable()) return;
+    stopping.store(true, std::memory_order_release);
+    writer.join();
+    fflush(output);
+  }
+
+  uint64_t get_records() const {
+    return pushed;
+  }
+
+  uint64_t get_full_waits() const {
+    return full_waits;
+  }
+};
+
+template <typename... Args>
+void sim_log_source::log(int record_level, const char *format, const Args &...args) {
+  static_assert(sizeof...(Args) <= SIM_LOG_MAX_ARGS, "too many arguments for a log record");
+  sim_log_record record;
+  size_t         used = 0;
+
+  record.format = format;
+  record.source = name.c_str();
+  record.time   = logger->now();
+  record.level  = record_level;
+  record.count  = 0;
+  (void)used;
+  (put(record, used, args), ...);
+  logger->push(record);
+}
+
+#endif /* SIM_LOG_HPP_ */
@@ -0,0 +1,319 @@
+/*******************************************************************************
+ * Copyright (C) 2023 by Salvador Z                                            *
+ *                                                                             *
+ * This file is part of SYSTEM_MODELS                                          *
+ *                                                                             *
+ *   Permission is hereby granted, free of charge, to any person obtaining a   *
+ *   copy of this software and associated documentation files (the Software)   *
+ *   to deal in the Software without restriction including without limitation  *
+ *   the rights to use, copy, modify, merge, publish, distribute, sublicense,  *
+ *   and/or sell copies ot the Software, and to permit persons to whom the     *
+ *   Software is furnished to do so, subject to the following conditions:      *
+ *                                                                             *
+ *   The above copyright notice and this permission notice shall be included   *
+ *   in all copies or substantial portions of the Software.                    *
+ *                                                                             *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS   *
+ *   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARANTIES OF MERCHANTABILITY *
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL   *
+ *   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR      *
+ *   OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,     *
+ *   ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE        *
+ *   OR OTHER DEALINGS IN THE SOFTWARE.                                        *
+ ******************************************************************************/
+
+/**
+ * @file sim_profile.hpp
+ * @author Salvador Z
+ * @version 1.0
+ * @brief File for the opt-in process and channel profiler of the models
+ *
+ * Build with -DSIM_PROFILE=1 to count process activations and fifo traffic, or with
+ * -DSIM_PROFILE=2 to also time every activation. With SIM_PROFILE 0 (default) the
+ * macros expand to nothing and profile_fifo is sc_fifo, so there is no cost at all.
+ */
+
+#ifndef SIM_PROFILE_HPP_
+#define SIM_PROFILE_HPP_
+
+// Includes
+#include <systemc.h>
+
+#ifndef SIM_PROFILE
+#define SIM_PROFILE 0
+#endif
+
+#define SIM_PROFILE_OFF      0 // nothing compiled in
+#define SIM_PROFILE_COUNTERS 1 // activation, delta and timed hit counters, fifo traffic
+#define SIM_PROFILE_TIMING   2 // counters plus the wall time of every activation
+
+#define SIM_PROFILE_REPORT_TOP 10 // processes printed at the end of the run
+
+#if SIM_PROFILE
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+/**
+ * @brief counters of one process
+ *
+ */
+struct sim_profile_process {
+  std::string name;        // hierarchical process name
+  uint64_t    activations; // times the process ran
+  uint64_t    timed_hits;  // first activation at a new simulated time
+  uint64_t    delta_hits;  // activation at the same simulated time as the previous one
+  uint64_t    last_time;   // simulated time of the last activation, resolution ticks
+  uint64_t    wall_ns;     // SIM_PROFILE_TIMING only
+};
+
+/**
+ * @brief counters of one fifo
+ *
+ */
+struct sim_profile_channel {
+  std::string name;    // hierarchical channel name
+  uint64_t    updates; // update phases with fifo traffic, one data_written/data_read notification each
+  uint64_t    reads;
+  uint64_t    writes;
+};
+
+/**
+ * @brief Class sim_profile
+ * Registry of the profiled processes and channels, one per program.
+ */
+class sim_profile {
+private:
+  std::vector<sim_profile_process> processes;
+  std::vector<sim_profile_channel> channels;
+  bool                             enabled;
+
+  sim_profile() : enabled(true) {}
+
+  static void json_string(FILE *out, const std::string &str) {
+    fputc('"', out);
+    for (char c : str) {
+      if (('"' == c) || ('\\' == c)) fputc('\\', out);
+      fputc(c, out);
+    }
+    fputc('"', out);
+  }
+
+public:
+  static sim_profile &instance() {
+    static sim_profile profile;
+    return profile;
+  }
+
+  int add_process(const char *name) {
+    sim_profile_process process = {name, 0, 0, 0, ~(uint64_t)0, 0};
+
+    processes.push_back(process);
+    return (int)processes.size() - 1;
+  }
+
+  int add_channel(const char *name) {
+    sim_profile_channel channel = {name, 0, 0, 0};
+
+    channels.push_back(channel);
+    return (int)channels.size() - 1;
+  }
+
+  /**
+   * @brief turn the activation counting on or off, e.g. off for a run calling the
+   * processes outside the kernel (cycle_sim), where there is no current process
+   *
+   */
+  void set_enabled(bool on) { enabled = on; }
+  bool is_enabled() const { return enabled; }
+
+  sim_profile_process &get_process(int index) { return processes[index]; }
+  sim_profile_channel &get_channel(int index) { return channels[index]; }
+
+  /**
+   * @brief write base.json and base.folded and print the busiest processes
+   * The folded file has one "module;...;process value" line per process, the value
+   * is the wall time in ns (the activations without SIM_PROFILE_TIMING), ready for
+   * flamegraph.pl.
+   *
+   * @param base path of the report files without extension
+   */
+  void report(const char *base) {
+    std::string path;
+    FILE       *out;
+    size_t      i;
+
+    path = std::string(base) + ".json";
+    out  = fopen(path.c_str(), "w");
+    if (nullptr != out) {
+      fprintf(out, "{\n  \"sim_time_s\": %.9f,\n  \"delta_cycles\": %llu,\n  \"timing\": %s,\n",
+              sc_time_stamp().to_seconds(), (unsigned long long)sc_delta_count(),
+              (SIM_PROFILE >= SIM_PROFILE_TIMING) ? "true" : "false");
+
+      fprintf(out, "  \"processes\": [");
+      for (i = 0; i < processes.size(); i++) {
+        fprintf(out, "%s\n    {\"name\": ", i ? "," : "");
+        json_string(out, processes[i].name);
+        fprintf(out,
+                ", \"activations\": %llu, \"timed_hits\": %llu, \"delta_hits\": %llu, \"wall_ns\": %llu}",
+                (unsigned long long)processes[i].activations, (unsigned long long)processes[i].timed_hits,
+                (unsigned long long)processes[i].delta_hits, (unsigned long long)processes[i].wall_ns);
+      }
+      fprintf(out, "\n  ],\n  \"channels\": [");
+      for (i = 0; i < channels.size(); i++) {
+        fprintf(out, "%s\n    {\"name\": ", i ? "," : "");
+        json_string(out, channels[i].name);
+        fprintf(out, ", \"updates\": %llu, \"reads\": %llu, \"writes\": %llu}",
+                (unsigned long long)channels[i].updates, (unsigned long long)channels[i].reads,
+                (unsigned long long)channels[i].writes);
+      }
+      fprintf(out, "\n  ]\n}\n");
+      fclose(out);
+    } else {
+      perror(path.c_str());
+    }
+
+    path = std::string(base) + ".folded";
+    out  = fopen(path.c_str(), "w");
+    if (nullptr != out) {
+      for (const sim_profile_process &process : processes) {
+        std::string stack = process.name;
+
+        std::replace(stack.begin(), stack.end(), '.', ';');
+        fprintf(out, "%s %llu\n", stack.c_str(),
+                (unsigned long long)((SIM_PROFILE >= SIM_PROFILE_TIMING) ? process.wall_ns
+                                                                          : process.activations));
+      }
+      fclose(out);
+    } else {
+      perror(path.c_str());
+    }
+
+    // busiest processes first
+    std::vector<const sim_profile_process *> sorted;
+    for (const sim_profile_process &process : processes) sorted.push_back(&process);
+    std::sort(sorted.begin(), sorted.end(), [](const sim_profile_process *a, const sim_profile_process *b) {
+      return (a->wall_ns != b->wall_ns) ? (a->wall_ns > b->wall_ns) : (a->activations > b->activations);
+    });
+
+    printf("\nsim_profile: %zu processes, %zu channels, %llu delta cycles, report in %s.json/.folded\n",
+           processes.size(), channels.size(), (unsigned long long)sc_delta_count(), base);
+    printf("  %-48s %14s %14s %14s %12s\n", "process", "activations", "timed hits", "delta hits",
+           "wall [ms]");
+    for (i = 0; (i < sorted.size()) && (i < (size_t)SIM_PROFILE_REPORT_TOP); i++) {
+      printf("  %-48s %14llu %14llu %14llu %12.3f\n", sorted[i]->name.c_str(),
+             (unsigned long long)sorted[i]->activations, (unsigned long long)sorted[i]->timed_hits,
+             (unsigned long long)sorted[i]->delta_hits, sorted[i]->wall_ns * 1e-6);
+    }
+  }
+};
+
+/**
+ * @brief process slot, registered on the first activation
+ *
+ */
+struct sim_profile_slot {
+  int index;
+  sim_profile_slot() : index(-1) {}
+};
+
+/**
+ * @brief Class sim_profile_scope
+ * Counts one activation of the current process, and with SIM_PROFILE_TIMING the wall
+ * time until the scope ends. A blocking call inside the scope (e.g. a write to a full
+ * fifo) is counted to it.
+ */
+class sim_profile_scope {
+private:
+  int index;
+#if SIM_PROFILE >= SIM_PROFILE_TIMING
+  std::chrono::steady_clock::time_point start;
+#endif
+
+public:
+  explicit sim_profile_scope(sim_profile_slot &slot) {
+    if (!sim_profile::instance().is_enabled()) {
+      index = -1;
+      return;
+    }
+    if (slot.index < 0) {
+      slot.index = sim_profile::instance().add_process(sc_get_current_process_handle().name());
+    }
+    index = slot.index;
+
+    sim_profile_process &process = sim_profile::instance().get_process(index);
+    uint64_t             now     = sc_time_stamp().value();
+
+    ++process.activations;
+    if (now != process.last_time) {
+      ++process.timed_hits;
+      process.last_time = now;
+    } else {
+      ++process.delta_hits;
+    }
+#if SIM_PROFILE >= SIM_PROFILE_TIMING
+    start = std::chrono::steady_clock::now();
+#endif
+  }
+
+#if SIM_PROFILE >= SIM_PROFILE_TIMING
+  ~sim_profile_scope() {
+    if (index < 0) return;
+
+    std::chrono::steady_clock::duration wall = std::chrono::steady_clock::now() - start;
+
+    sim_profile::instance().get_process(index).wall_ns +=
+        std::chrono::duration_cast<std::chrono::nanoseconds>(wall).count();
+  }
+#endif
+};
+
+/**
+ * @brief Class profile_fifo
+ * sc_fifo counting its traffic in the update phase.
+ */
+template <typename T>
+class profile_fifo : public sc_fifo<T> {
+private:
+  int index;
+
+public:
+  explicit profile_fifo(const char *name, int size = 16)
+      : sc_fifo<T>(name, size), index(sim_profile::instance().add_channel(this->name())) {}
+
+protected:
+  virtual void update() {
+    if ((this->m_num_read > 0) || (this->m_num_written > 0)) {
+      sim_profile_channel &channel = sim_profile::instance().get_channel(index);
+
+      ++channel.updates;
+      channel.reads += this->m_num_read;
+      channel.writes += this->m_num_written;
+    }
+    sc_fifo<T>::update();
+  }
+};
+
+#define PROFILE_SLOT(slot)       sim_profile_slot slot
+#define PROFILE_ACTIVATION(slot) sim_profile_scope slot##_scope(slot)
+#define PROFILE_ENABLE(on)       sim_profile::instance().set_enabled(on)
+#define PROFILE_REPORT(base)     sim_profile::instance().report(base)
+
+#else
+
+// compiled out
+template <typename T>
+using profile_fifo = sc_fifo<T>;
+
+#define PROFILE_SLOT(slot)       static_assert(true, "")
+#define PROFILE_ACTIVATION(slot) ((void)0)
+#define PROFILE_ENABLE(on)       ((void)0)
+#define PROFILE_REPORT(base)     ((void)0)
+
+#endif /* SIM_PROFILE */
+
+#endif /* SIM_PROFILE_HPP_ */
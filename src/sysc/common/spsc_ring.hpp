@@ -0,0 +1,103 @@
+/*******************************************************************************
+ * Copyright (C) 2023 by Salvador Z                                            *
+ *                                                                             *
+ * This file is part of SYSTEM_MODELS                                          *
+ *                                                                             *
+ *   Permission is hereby granted, free of charge, to any person obtaining a   *
+ *   copy of this software and associated documentation files (the Software)   *
+ *   to deal in the Software without restriction including without limitation  *
+ *   the rights to use, copy, modify, merge, publish, distribute, sublicense,  *
+ *   and/or sell copies ot the Software, and to permit persons to whom the     *
+ *   Software is furnished to do so, subject to the following conditions:      *
+ *                                                                             *
+ *   The above copyright notice and this permission notice shall be included   *
+ *   in all copies or substantial portions of the Software.                    *
+ *                                                                             *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS   *
+ *   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARANTIES OF MERCHANTABILITY *
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL   *
+ *   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR      *
+ *   OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,     *
+ *   ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE        *
+ *   OR OTHER DEALINGS IN THE SOFTWARE.                                        *
+ ******************************************************************************/
+
+/**
+ * @file spsc_ring.hpp
+ * @author Salvador Z
+ * @version 1.0
+ * @brief File for the lock-free single producer single consumer ring buffer
+ *
+ * Used to pass values between the SystemC kernel thread and an OS thread. The
+ * producer only writes the tail and the consumer only writes the head, each
+ * index on its own cache line.
+ */
+
+#ifndef SPSC_RING_HPP_
+#define SPSC_RING_HPP_
+
+// Includes
+#include <atomic>
+#include <cstddef>
+
+#define SPSC_RING_CACHE_LINE 64
+
+/**
+ * @brief Class spsc_ring
+ * Bounded ring of N values, N a power of two. try_push() is called by one
+ * thread and try_pop() by one other thread.
+ */
+template <typename T, std::size_t N>
+class spsc_ring {
+private:
+  static_assert((N >= 2) && (0 == (N & (N - 1))), "spsc_ring size must be a power of two");
+
+  alignas(SPSC_RING_CACHE_LINE) std::atomic<std::size_t> head; // next value to pop, consumer
+  alignas(SPSC_RING_CACHE_LINE) std::atomic<std::size_t> tail; // next slot to push, producer
+  alignas(SPSC_RING_CACHE_LINE) T slots[N];
+
+public:
+  spsc_ring() : head(0), tail(0) {}
+
+  spsc_ring(const spsc_ring &)            = delete;
+  spsc_ring &operator=(const spsc_ring &) = delete;
+
+  /**
+   * @brief producer side, append a value
+   *
+   * @return false when the ring is full
+   */
+  bool try_push(const T &value) {
+    std::size_t t = tail.load(std::memory_order_relaxed);
+
+    if (t - head.load(std::memory_order_acquire) == N) return false;
+    slots[t & (N - 1)] = value;
+    tail.store(t + 1, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * @brief consumer side, take the oldest value
+   *
+   * @return false when the ring is empty
+   */
+  bool try_pop(T &value) {
+    std::size_t h = head.load(std::memory_order_relaxed);
+
+    if (h == tail.load(std::memory_order_acquire)) return false;
+    value = slots[h & (N - 1)];
+    head.store(h + 1, std::memory_order_release);
+    return true;
+  }
+
+  // either side, a snapshot
+  bool empty() const {
+    return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+  }
+
+  static constexpr std::size_t capacity() {
+    return N;
+  }
+};
+
+#endif /* SPSC_RING_HPP_ */
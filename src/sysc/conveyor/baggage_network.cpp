@@ -0,0 +1,129 @@
+/*******************************************************************************
+ * Copyright (C) 2023 by Salvador Z                                            *
+ *                                                                             *
+ * This file is part of SYSTEM_MODELS                                          *
+ *                                                                             *
+ *   Permission is hereby granted, free of charge, to any person obtaining a   *
+ *   copy of this software and associated documentation files (the Software)   *
+ *   to deal in the Software without restriction including without limitation  *
+ *   the rights to use, copy, modify, merge, publish, distribute, sublicense,  *
+ *   and/or sell copies ot the Software, and to permit persons to whom the     *
+ *   Software is furnished to do so, subject to the following conditions:      *
+ *                                                                             *
+ *   The above copyright notice and this permission notice shall be included   *
+ *   in all copies or substantial portions of the Software.                    *
+ *                                                                             *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS   *
+ *   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARANTIES OF MERCHANTABILITY *
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL   *
+ *   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR      *
+ *   OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,     *
+ *   ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE        *
+ *   OR OTHER DEALINGS IN THE SOFTWARE.                                        *
+ ******************************************************************************/
+
+
+/**
+ * @file baggage_network.cpp
+ * @author Salvador Z
+ * @version 1.0
+ * @brief Simulation of a baggage handling network read from a description file
+ *
+ * usage: baggage_network [description] [--generate scanners lines] [--seed n] [--time s]
+ *                        [--write file] [-v level]
+ *
+ * The network is read from the description file (see network_description.hpp) or
+ * generated, --write saves the generated description. The run ends with a one line
+ * summary for network_bench.
+ */
+
+// Includes
+#include "fifo_monitor.hpp"
+#include "network.hpp"
+#include "network_description.hpp"
+#include "sim_log.hpp"
+#include <chrono>
+#include <sys/resource.h>
+#include <systemc.h>
+
+#define NETWORK_SIM_TIME_S 100 // default, see --time
+
+int sc_main(int argc, char *argv[]) {
+  network_description                   desc;
+  const char                           *path       = nullptr;
+  const char                           *write_path = nullptr;
+  int                                   scanners   = 0;
+  int                                   lines      = 0;
+  int                                   seed       = 5;
+  int                                   verbosity  = VERBOSITY_NONE;
+  double                                sim_time_s = NETWORK_SIM_TIME_S;
+  std::chrono::steady_clock::time_point wall_start;
+  std::chrono::duration<double>         elaboration_time, wall_time;
+  struct rusage                         usage;
+
+  // -----------------------------------
+  // input validation
+  // -----------------------------------
+  for (int i = 1; i < argc; ++i) {
+    if ((0 == strcmp(argv[i], "--generate")) && (i + 2 < argc)) {
+      scanners = atoi(argv[++i]);
+      lines    = atoi(argv[++i]);
+    } else if ((0 == strcmp(argv[i], "--seed")) && (i + 1 < argc)) {
+      seed = atoi(argv[++i]);
+    } else if ((0 == strcmp(argv[i], "--time")) && (i + 1 < argc)) {
+      sim_time_s = atof(argv[++i]);
+    } else if ((0 == strcmp(argv[i], "--write")) && (i + 1 < argc)) {
+      write_path = argv[++i];
+    } else if ((0 == strcmp(argv[i], "-v")) && (i + 1 < argc)) {
+      verbosity = atoi(argv[++i]);
+    } else if ((nullptr == path) && ('-' != argv[i][0])) {
+      path = argv[i];
+    } else {
+      fprintf(stderr, "usage: %s [description] [--generate scanners lines] [--seed n] [--time s] "
+                      "[--write file] [-v level]\n",
+              argv[0]);
+      return 1;
+    }
+  }
+
+  if ((nullptr == path) == (scanners <= 0)) {
+    fprintf(stderr, "give a description file or --generate with at least one scanner\n");
+    return 1;
+  }
+  if (nullptr != path) {
+    if (!desc.read(path)) return 1;
+  } else {
+    if (lines < 1) lines = 1;
+    if (!desc.generate(scanners, lines) || !desc.check("generated")) return 1;
+  }
+  if ((nullptr != write_path) && !desc.write(write_path)) return 1;
+
+  // -----------------------------------
+  // elaboration and simulation
+  // -----------------------------------
+  wall_start = std::chrono::steady_clock::now();
+  sim_log::instance().set_default_level(std::min(SIM_LOG_WARN + std::max(verbosity, 0), SIM_LOG_TRACE));
+  baggage_network network("network", desc, seed);
+  packet_pool<scanner_sts_packet>::instance().reserve(network.links.size() * NETWORK_LINK_DEPTH);
+  elaboration_time = std::chrono::steady_clock::now() - wall_start;
+
+  wall_start = std::chrono::steady_clock::now();
+  sc_start(sc_time(sim_time_s, SC_SEC));
+  wall_time = std::chrono::steady_clock::now() - wall_start;
+
+  sim_log::instance().flush();
+  network.print_stats(verbosity);
+  printf("\n");
+  packet_pool<scanner_sts_packet>::instance().print_stats("scanner_sts_packet");
+  FIFO_MONITOR_REPORT("network_fifos");
+
+  // one line, key=value summary of the run for network_bench
+  getrusage(RUSAGE_SELF, &usage);
+  printf("\nsummary: nodes=%zu links=%zu scanners=%zu lines=%zu sim_time_s=%f elaboration_s=%f "
+         "wall_time_s=%f bags_scanned=%ld bags_delivered=%ld bags_per_wall_s=%f max_rss_kb=%ld seed=%d\n",
+         desc.get_nodes().size(), desc.get_links().size(), network.scanners.size(), network.makeups.size(),
+         sc_time_stamp().to_seconds(), elaboration_time.count(), wall_time.count(),
+         network.get_bags_scanned(), network.get_bags_delivered(),
+         network.get_bags_delivered() / std::max(wall_time.count(), 1e-9), usage.ru_maxrss, seed);
+  return 0;
+}
@@ -0,0 +1,210 @@
+/*******************************************************************************
+ * Copyright (C) 2023 by Salvador Z                                            *
+ *                                                                             *
+ * This file is part of SYSTEM_MODELS                                          *
+ *                                                                             *
+ *   Permission is hereby granted, free of charge, to any person obtaining a   *
+ *   copy of this software and associated documentation files (the Software)   *
+ *   to deal in the Software without restriction including without limitation  *
+ *   the rights to use, copy, modify, merge, publish, distribute, sublicense,  *
+ *   and/or sell copies ot the Software, and to permit persons to whom the     *
+ *   Software is furnished to do so, subject to the following conditions:      *
+ *                                                                             *
+ *   The above copyright notice and this permission notice shall be included   *
+ *   in all copies or substantial portions of the Software.                    *
+ *                                                                             *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS   *
+ *   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARANTIES OF MERCHANTABILITY *
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL   *
+ *   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR      *
+ *   OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,     *
+ *   ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE        *
+ *   OR OTHER DEALINGS IN THE SOFTWARE.                                        *
+ ******************************************************************************/
+
+/**
+ * @file checkpoint.hpp
+ * @author Salvador Z
+ * @version 1.0
+ * @brief File for the binary checkpoint writer and reader of the conveyor model
+ *
+ * File layout: checkpoint_header, the conveyor_params of the line, then the state of
+ * every module and fifo in the order top::save() writes it. Values are written in
+ * host byte order, a checkpoint is restored on the same kind of machine it was
+ * written on.
+ */
+
+#ifndef CHECKPOINT_HPP_
+#define CHECKPOINT_HPP_
+
+// Includes
+#include <cstdint>
+#include <cstdio>
+#include <systemc.h>
+#include <type_traits>
+#include <vector>
+
+#define CHECKPOINT_MAGIC   "CNVCKPT"
+#define CHECKPOINT_VERSION 7
+
+struct checkpoint_header {
+  char     magic[8];
+  uint32_t version;
+  int32_t  seed;
+  uint64_t sim_time;           // simulated time of the checkpoint, resolution ticks
+  uint64_t time_resolution_fs; // one tick in femtoseconds
+  int32_t  num_segments;
+  int32_t  control_mode;
+  int32_t  process_style;
+  int32_t  quantum_ms;
+  int32_t  report_every;
+  int32_t  delivery_mm; // belt from the scanner to the delivery, keeps the header a multiple of 8 bytes
+};
+
+static_assert(sizeof(checkpoint_header) % 8 == 0, "checkpoint header must keep 8 byte alignment");
+
+/**
+ * @brief Class checkpoint_writer
+ * Sequential binary writer, the first error sticks and is reported by ok().
+ */
+class checkpoint_writer {
+private:
+  FILE *file;
+  bool  good;
+
+public:
+  checkpoint_writer() : file(nullptr), good(false) {}
+  ~checkpoint_writer() {
+    close();
+  }
+
+  bool open(const char *path) {
+    file = fopen(path, "wb");
+    good = (nullptr != file);
+    return good;
+  }
+
+  /**
+   * @brief flush and close the file
+   *
+   * @return true when everything was written
+   */
+  bool close() {
+    if (nullptr != file) {
+      if (0 != fclose(file)) good = false;
+      file = nullptr;
+    }
+    return good;
+  }
+
+  bool ok() const {
+    return good;
+  }
+
+  template <typename T>
+  void put(const T &value) {
+    static_assert(std::is_trivially_copyable<T>::value, "only plain values go to a checkpoint");
+    if (good && (1 != fwrite(&value, sizeof(T), 1, file))) good = false;
+  }
+
+  void put(const sc_time &time) {
+    put<uint64_t>(time.value());
+  }
+
+  template <typename T>
+  void put_vector(const std::vector<T> &values) {
+    put<uint64_t>(values.size());
+    if (good && !values.empty() && (values.size() != fwrite(values.data(), sizeof(T), values.size(), file))) {
+      good = false;
+    }
+  }
+};
+
+/**
+ * @brief Class checkpoint_reader
+ * Sequential binary reader, the first error (short file, size mismatch) sticks and
+ * is reported by ok().
+ */
+class checkpoint_reader {
+private:
+  FILE *file;
+  bool  good;
+
+public:
+  checkpoint_reader() : file(nullptr), good(false) {}
+  ~checkpoint_reader() {
+    close();
+  }
+
+  bool open(const char *path) {
+    file = fopen(path, "rb");
+    good = (nullptr != file);
+    return good;
+  }
+
+  void close() {
+    if (nullptr != file) {
+      fclose(file);
+      file = nullptr;
+    }
+  }
+
+  bool ok() const {
+    return good;
+  }
+
+  // the checkpoint does not match the model
+  void fail() {
+    good = false;
+  }
+
+  template <typename T>
+  void get(T &value) {
+    static_assert(std::is_trivially_copyable<T>::value, "only plain values come from a checkpoint");
+    if (good && (1 != fread(&value, sizeof(T), 1, file))) good = false;
+  }
+
+  void get(sc_time &time) {
+    uint64_t value = 0;
+
+    get(value);
+    time = sc_time::from_value(value);
+  }
+
+  /**
+   * @brief read a vector written by put_vector()
+   *
+   * @param values already sized to the expected length, a different length fails
+   */
+  template <typename T>
+  void get_vector(std::vector<T> &values) {
+    uint64_t size = 0;
+
+    get(size);
+    if (good && (size != values.size())) good = false;
+    if (good && !values.empty() && (values.size() != fread(values.data(), sizeof(T), values.size(), file))) {
+      good = false;
+    }
+  }
+};
+
+/**
+ * @brief Class fifo_contents
+ * Non destructive copy of the values waiting in an sc_fifo while the simulation is
+ * paused (no read or write pending an update). Reads the ring buffer through the
+ * protected members of sc_fifo, as laid out since SystemC 2.1.
+ */
+template <typename T>
+class fifo_contents : public sc_fifo<T> {
+public:
+  static void get(const sc_fifo<T> &fifo, std::vector<T> &values) {
+    const int size = fifo.*(&fifo_contents::m_size);
+    const int ri   = fifo.*(&fifo_contents::m_ri);
+    T *const  buf  = fifo.*(&fifo_contents::m_buf);
+
+    values.clear();
+    for (int i = 0; i < fifo.num_available(); i++) values.push_back(buf[(ri + i) % size]);
+  }
+};
+
+#endif /* CHECKPOINT_HPP_ */
@@ -23,35 +23,216 @@
  ******************************************************************************/
 
 #include "conveyor.hpp"
-#include "HashMap.hpp"
+#include "checkpoint.hpp"
+#include "conveyor_config.hpp"
+#include "cosim_bridge.hpp"
+#include "counter_rng.hpp"
+#include "fifo_monitor.hpp"
+#include "hdr_histogram.hpp"
+#include "health_monitor.hpp"
+#include "packet_pool.hpp"
+#include "ready_fifo.hpp"
+#include "sim_log.hpp"
+#include "sim_profile.hpp"
+#include "telemetry.hpp"
+#include "wire_format.hpp"
+#include <chrono>
+#include <limits>
+#include <memory>
+#include <sys/resource.h>
 #include <systemc.h>
 
+static int verbosity = VERBOSITY_INFO; // VERBOSITY_NONE, VERBOSITY_INFO or VERBOSITY_PACKETS
+
+static const char *control_mode_name(int mode) {
+  switch (mode) {
+  case CONTROL_MODE_EVENT:
+    return "event";
+  case CONTROL_MODE_COSIM:
+    return "cosim";
+  default:
+    return "polling";
+  }
+}
+
+// -----------------------------------
+// packet fields in a checkpoint
+// -----------------------------------
+static void save_packet(checkpoint_writer &ckpt, const scanner_sts_packet &pkt) {
+  ckpt.put(pkt.get_timestamp());
+  ckpt.put(pkt.get_bag_id());
+}
+
+static void restore_packet(checkpoint_reader &ckpt, scanner_sts_packet &pkt) {
+  sc_time timestamp;
+  int     bag;
+
+  ckpt.get(timestamp);
+  ckpt.get(bag);
+  pkt.set_timestamp(timestamp);
+  pkt.set_bag_id(bag);
+}
+
+static void save_packet(checkpoint_writer &ckpt, const conveyor_sts_packet &pkt) {
+  ckpt.put(pkt.get_timestamp());
+  ckpt.put(pkt.get_id());
+  ckpt.put(pkt.get_current_cnt());
+  ckpt.put(pkt.get_temperature());
+  ckpt.put(pkt.get_vibration());
+}
+
+static void restore_packet(checkpoint_reader &ckpt, conveyor_sts_packet &pkt) {
+  sc_time      timestamp;
+  int          id, temp, vibr;
+  unsigned int cnt;
+
+  ckpt.get(timestamp);
+  ckpt.get(id);
+  ckpt.get(cnt);
+  ckpt.get(temp);
+  ckpt.get(vibr);
+  pkt.set_timestamp(timestamp);
+  pkt.set_id(id);
+  pkt.set_current_cnt(cnt);
+  pkt.set_temperature(temp);
+  pkt.set_vibration(vibr);
+}
+
+static void save_packet(checkpoint_writer &ckpt, const control_packet &pkt) {
+  ckpt.put(pkt.get_timestamp());
+  ckpt.put(pkt.get_msg());
+  ckpt.put(pkt.get_data());
+}
+
+static void restore_packet(checkpoint_reader &ckpt, control_packet &pkt) {
+  sc_time timestamp;
+  int     msg, data;
+
+  ckpt.get(timestamp);
+  ckpt.get(msg);
+  ckpt.get(data);
+  pkt.set_timestamp(timestamp);
+  pkt.set_msg(msg);
+  pkt.set_data(data);
+}
+
+/**
+ * @brief write the packets waiting in a fifo, the simulation must be paused
+ *
+ */
+template <typename T>
+static void save_fifo(checkpoint_writer &ckpt, const sc_fifo<packet_msg<T> > &fifo) {
+  std::vector<packet_msg<T> > values;
+
+  fifo_contents<packet_msg<T> >::get(fifo, values);
+  ckpt.put((uint32_t)values.size());
+  for (const packet_msg<T> &msg : values) save_packet(ckpt, packet_of<T>(msg));
+}
+
+/**
+ * @brief write the saved packets back into an empty fifo, before sc_start()
+ *
+ */
+template <typename T>
+static void restore_fifo(checkpoint_reader &ckpt, sc_fifo<packet_msg<T> > &fifo) {
+  uint32_t count = 0;
+
+  ckpt.get(count);
+  for (uint32_t i = 0; ckpt.ok() && (i < count); i++) {
+    packet_ptr<T> pkt;
+
+    restore_packet(ckpt, *pkt);
+    if (!fifo.nb_write(pkt.send())) ckpt.fail(); // more packets than the fifo depth
+  }
+}
+
 /**
  * @brief Scanner module
  * This module simulates a human scanning bags and placing them onto the
  * conveyor belt. It sends a scanner status packet to the control system using a fifo
  * @param Input control_packet from control system
  * @param Output scanner_sts_packet to control system
+ * @param Config configuration policy, see conveyor_config.hpp
  *
  */
+template <typename Config>
 class scanner : public sc_module {
 private:
-  int                 bag_id;
-  int                 running;
-  int                 var_delay;
-  int                 samples_available;
-  control_packet     *control_pkt_ptr;
-  scanner_sts_packet *scanner_pkt_ptr;
+  int                        bag_id;
+  int                        running;
+  int                        var_delay;
+  int                        samples_available;
+  packet_msg<control_packet> control_msg;
+  counter_rng                rng; // keyed by the seed and the instance name
+  Config                     config;
+  sim_log_source            &log;
+
+  // PROCESS_STYLE_METHOD state, see scanner_method()
+  bool                           started;
+  packet_msg<scanner_sts_packet> pending_msg; // scan waiting for room in the fifo
+  bool                           pending;
+  sc_time                        wake_time;   // end of the current delay
+  bool                           restoring;   // restored from a checkpoint, not resumed yet
+  sc_time                        resume_time; // time of the checkpoint
+
+  PROFILE_SLOT(profile_slot);
+
+  /**
+   * @brief read and apply the oldest received control packet
+   *
+   */
+  void read_control() {
+
+    samples_available = in->num_available();
+
+    if (samples_available != 0) {
+      in->read(control_msg);
+      packet_ptr<control_packet> control_pkt(control_msg);
+
+      if (control_pkt->get_msg() == CONTROL_PKT_MSG_TURN_ON) {
+        running = CONTROL_PKT_MSG_TURN_ON;
+      } else if (control_pkt->get_msg() == CONTROL_PKT_MSG_TURN_OFF) {
+        running = CONTROL_PKT_MSG_TURN_OFF;
+      }
+      SIM_LOG(log, SIM_LOG_INFO, "control_pkt received: msg %d data %d sent at %.9f s, turning %s",
+              control_pkt->get_msg(), control_pkt->get_data(), control_pkt->get_timestamp().to_seconds(),
+              (CONTROL_PKT_MSG_TURN_ON == running) ? "on" : "off");
+    } // control_pkt goes back to its pool
+  }
+
+  /**
+   * @brief scan the next bag
+   *
+   * @return the status packet, ready to be written to the fifo
+   */
+  packet_msg<scanner_sts_packet> next_scan() {
+    packet_ptr<scanner_sts_packet> scanner_pkt;
+
+    scanner_pkt->set_timestamp(sc_time_stamp());
+    // generate a bag_ID, and set it in the packet
+    scanner_pkt->set_bag_id(++bag_id);
+    if (0 > bag_id) {
+      bag_id = 0;
+    }
+    return scanner_pkt.send();
+  }
 
 public:
-  sc_port<sc_fifo_out_if<scanner_sts_packet *> > out;
-  sc_port<sc_fifo_in_if<control_packet *> >      in;
+  sc_port<sc_fifo_out_if<packet_msg<scanner_sts_packet> > > out;
+  sc_port<sc_fifo_in_if<packet_msg<control_packet> > >      in;
 
   SC_HAS_PROCESS(scanner);
 
-  scanner(sc_module_name name) : sc_module(name) {
+  scanner(sc_module_name name, int seed, int process_style = PROCESS_STYLE_THREAD,
+          const Config &cfg = Config())
+      : sc_module(name), rng(seed, counter_rng::instance_id(this->name())), config(cfg),
+        log(sim_log::instance().source(this->name())), started(false), pending(false), restoring(false) {
     // process declaration
-    SC_THREAD(scanner_thread);
+    if (PROCESS_STYLE_METHOD == process_style) {
+      SC_METHOD(scanner_method);
+    } else {
+      SC_THREAD(scanner_thread);
+    }
 
     bag_id  = 0;
     running = 0; // off initially
@@ -68,46 +249,110 @@ public:
       /* This simulates the amount of time between bags scans
        * and placing onto the conveyor belt.
        */
-      var_delay = (rand() % BARCODE_SCANNER_REPORT_RATE_VARIANCE_SECS) + 1;
+      var_delay = rng.uniform(config.scanner_delay_variance_s()) + 1;
       wait(var_delay, SC_SEC);
+      PROFILE_ACTIVATION(profile_slot);
 
       /**
        * Check for received control packets
        */
-      samples_available = in->num_available();
-
-      if (samples_available != 0) {
-        in->read(control_pkt_ptr);
+      read_control();
 
-        if (control_pkt_ptr->get_msg() == CONTROL_PKT_MSG_TURN_ON) {
-          running = CONTROL_PKT_MSG_TURN_ON;
-
-          printf("\nInfo: scanner_inst control_pkt received: \n");
-          printf("Info: Turning On \n");
-        } else if (control_pkt_ptr->get_msg() == CONTROL_PKT_MSG_TURN_OFF) {
-          running = CONTROL_PKT_MSG_TURN_OFF;
+      if (CONTROL_PKT_MSG_TURN_ON == running) {
+        out->write(next_scan());
+      }
+    } // end while
+  }   // end scanner_thread
 
-          printf("\nInfo: scanner_inst control_pkt received: \n");
-          printf("Info: Turning Off \n");
-        }
-        control_pkt_ptr->print();
+  /**
+   * @brief scanner_thread as a stackless SC_METHOD
+   * Runs once at initialization to draw the first delay, then once per scan.
+   * A scan that does not fit in the fifo stays pending until data_read_event().
+   *
+   * @return void
+   */
+  void scanner_method() {
+    PROFILE_ACTIVATION(profile_slot);
+    sc_time delay;
+
+    if (restoring) {
+      // sleep through the time before the checkpoint, then through the rest of the delay
+      if (sc_time_stamp() < resume_time) {
+        next_trigger(resume_time - sc_time_stamp());
+        return;
+      }
+      restoring = false;
+      if (!pending && (wake_time > sc_time_stamp())) {
+        next_trigger(wake_time - sc_time_stamp());
+        return;
+      }
+    }
 
-        delete control_pkt_ptr; // free memo
+    if (pending) {
+      if (!out->nb_write(pending_msg)) {
+        next_trigger(out->data_read_event());
+        return;
       }
+      pending = false;
+    } else if (started) {
+      read_control();
 
       if (CONTROL_PKT_MSG_TURN_ON == running) {
-        scanner_pkt_ptr = new scanner_sts_packet();
-
-        scanner_pkt_ptr->set_timestamp(sc_time_stamp());
-        // generate a bag_ID, and set it in the packet
-        scanner_pkt_ptr->set_bag_id(++bag_id);
-        if (0 > bag_id) {
-          bag_id = 0;
+        pending_msg = next_scan();
+        if (!out->nb_write(pending_msg)) {
+          pending = true;
+          next_trigger(out->data_read_event());
+          return;
         }
-        out->write(scanner_pkt_ptr);
       }
-    } // end while
-  }   // end scanner_thread
+    }
+    started = true;
+
+    var_delay = rng.uniform(config.scanner_delay_variance_s()) + 1;
+    delay     = sc_time(var_delay, SC_SEC);
+    wake_time = sc_time_stamp() + delay;
+    next_trigger(delay);
+  } // end scanner_method
+
+  /**
+   * @brief write the scanner state to a checkpoint, PROCESS_STYLE_METHOD only
+   *
+   */
+  void save(checkpoint_writer &ckpt) const {
+    ckpt.put(bag_id);
+    ckpt.put(running);
+    ckpt.put(rng.get_counter());
+    ckpt.put(started);
+    ckpt.put(wake_time);
+    ckpt.put(pending);
+    if (pending) save_packet(ckpt, packet_of<scanner_sts_packet>(pending_msg));
+  }
+
+  /**
+   * @brief read the state written by save(), before sc_start()
+   *
+   * @param checkpoint_time the method sleeps until then
+   */
+  void restore(checkpoint_reader &ckpt, const sc_time &checkpoint_time) {
+    uint64_t counter = 0;
+
+    ckpt.get(bag_id);
+    ckpt.get(running);
+    ckpt.get(counter);
+    ckpt.get(started);
+    ckpt.get(wake_time);
+    ckpt.get(pending);
+    if (pending) {
+      packet_ptr<scanner_sts_packet> scanner_pkt;
+
+      restore_packet(ckpt, *scanner_pkt);
+      pending_msg = scanner_pkt.send();
+    }
+    rng.set_counter(counter);
+
+    restoring   = true;
+    resume_time = checkpoint_time;
+  }
 };
 
 /**
@@ -121,7 +366,9 @@ public:
  * temperature sensor and a vibration sensor in order to monitor the "health" of the encoder.
  * @param Input control_packet from control system
  * @param Output conveyor_sts_packet to control system
+ * @param Config configuration policy, see conveyor_config.hpp
  */
+template <typename Config>
 class conveyor : public sc_module {
 private:
   int temp;
@@ -132,116 +379,566 @@ private:
   int tmp_var;
   int samples_available;
 
-  control_packet      *ctrl_pkt_ptr;
-  conveyor_sts_packet *conveyor_pkt_ptr;
+  // temperature and vibration samples drawn CONVEYOR_SAMPLE_BATCH at a time
+  counter_rng rng; // keyed by the seed and the segment ID
+  Config      config;
+  int         temp_samples[CONVEYOR_SAMPLE_BATCH];
+  int         vibr_samples[CONVEYOR_SAMPLE_BATCH];
+  int         sample_index;
+  uint64_t    batch_counter; // rng counter the samples were drawn from
+
+  sim_log_source &log;
+
+  // temporal decoupling, SC_ZERO_TIME when every report is a wakeup
+  sc_time quantum;
+  sc_time next_report; // local time of the next report
+  sc_time horizon;     // end of the current quantum
+  long    wakeup_count;
+
+  // lazy encoder, the count is a function of the ticks elapsed since the last state change
+  int      report_every;     // ticks per report, 1 reports every tick, 0 only state changes
+  sc_time  tick_origin;      // time of the first tick
+  uint64_t count_ticks;      // ticks elapsed when count was last brought up to date
+  uint64_t last_report_tick; // tick of the last periodic report
+
+  // PROCESS_STYLE_METHOD state, see conveyor_method()
+  enum method_state { STATE_START, STATE_REPORT, STATE_SYNC, STATE_RUN_AHEAD, STATE_LAZY } state;
+  packet_msg<conveyor_sts_packet> pending_msg; // report waiting for room in the fifo
+  bool                            pending;
+  sc_time                         wake_time;   // end of the current wait
+  bool                            restoring;   // restored from a checkpoint, not resumed yet
+  sc_time                         resume_time; // time of the checkpoint
+
+  PROFILE_SLOT(profile_slot);
+
+  packet_msg<control_packet> ctrl_msg;
+
+  /**
+   * @brief draw the next block of temperature and vibration samples
+   *
+   */
+  void draw_samples() {
+    uint32_t  raw_temp[CONVEYOR_SAMPLE_BATCH];
+    uint32_t  raw_vibr[CONVEYOR_SAMPLE_BATCH];
+    int       t, v;
+    const int temp_mean  = config.temperature_mean();
+    const int temp_range = config.temperature_variance() / 2;
+    const int vibr_mean  = config.vibration_mean();
+    const int vibr_range = config.vibration_variance() / 2;
+
+    batch_counter = rng.get_counter();
+    rng.fill(raw_temp, CONVEYOR_SAMPLE_BATCH);
+    rng.fill(raw_vibr, CONVEYOR_SAMPLE_BATCH);
+
+    for (int i = 0; i < CONVEYOR_SAMPLE_BATCH; i++) {
+      t = (int)(raw_temp[i] >> 1);
+      v = (int)(raw_vibr[i] >> 1);
+
+      temp_samples[i] = (t & 0x00000001) ? temp_mean + (t % temp_range) : temp_mean - (t % temp_range);
+      vibr_samples[i] = (v & 0x00000001) ? vibr_mean + (v % vibr_range) : vibr_mean - (v % vibr_range);
+    }
+    sample_index = 0;
+  }
 
 public:
-  sc_port<sc_fifo_out_if<conveyor_sts_packet *> > out;
-  sc_port<sc_fifo_in_if<control_packet *> >       in;
+  sc_port<sc_fifo_out_if<packet_msg<conveyor_sts_packet> > > out;
+  sc_port<sc_fifo_in_if<packet_msg<control_packet> > >       in;
 
   SC_HAS_PROCESS(conveyor);
 
-  conveyor(sc_module_name name, int id) : sc_module(name), my_id(id) {
-
-    SC_THREAD(conveyor_thread);
+  conveyor(sc_module_name name, int id, int seed, int quantum_ms = CONVEYOR_QUANTUM_MS,
+           int process_style = PROCESS_STYLE_THREAD, int reports = CONVEYOR_REPORT_EVERY,
+           const Config &cfg = Config())
+      : sc_module(name), my_id(id), rng(seed, id), config(cfg), log(sim_log::instance().source(this->name())),
+        quantum(quantum_ms, SC_MS), wakeup_count(0), report_every(reports), count_ticks(0),
+        last_report_tick(0), state(STATE_START), pending(false), restoring(false) {
+
+    if (PROCESS_STYLE_METHOD == process_style) {
+      SC_METHOD(conveyor_method);
+    } else {
+      SC_THREAD(conveyor_thread);
+    }
 
     running = CONTROL_PKT_MSG_TURN_OFF;
 
-    count = rand();
+    count = rng.next_int();
     temp  = 0;
     vibr  = 0;
+
+    sample_index  = CONVEYOR_SAMPLE_BATCH; // drawn on first use
+    batch_counter = 0;
   }
 
-  void conveyor_thread() {
+  /**
+   * @brief read and apply the received control packets
+   *
+   * @param drain_all read every queued packet instead of only the oldest one
+   */
+  void read_control(bool drain_all) {
 
-    // get each instance off of time=0 by some random amount
-    tmp_var = (rand() % 20) + 1; // 1 to 20 ms
-    wait(tmp_var, SC_MS);
+    samples_available = in->num_available();
+    if (!drain_all && samples_available > 1) samples_available = 1;
+
+    while (samples_available-- > 0) {
+
+      in->read(ctrl_msg);
+      packet_ptr<control_packet> ctrl_pkt(ctrl_msg);
+
+      // perform required processsing
+      if (ctrl_pkt->get_msg() == CONTROL_PKT_MSG_TURN_ON) {
+        running = CONTROL_PKT_MSG_TURN_ON;
+      }
+
+      // perform required processsing
+      if (ctrl_pkt->get_msg() == CONTROL_PKT_MSG_TURN_OFF) {
+        running = CONTROL_PKT_MSG_TURN_OFF;
+      }
+
+      SIM_LOG(log, SIM_LOG_INFO, "control_pkt received: msg %d data %d sent at %.9f s, turning %s",
+              ctrl_pkt->get_msg(), ctrl_pkt->get_data(), ctrl_pkt->get_timestamp().to_seconds(),
+              (CONTROL_PKT_MSG_TURN_ON == running) ? "on" : "off");
+    } // ctrl_pkt goes back to its pool
+  }
+
+  /**
+   * @brief advance the encoder count and samples by one report
+   *
+   * @param timestamp time of the report, ahead of sc_time_stamp() when decoupled
+   * @return the status packet, ready to be written to the fifo
+   */
+  packet_msg<conveyor_sts_packet> next_status(const sc_time &timestamp) {
+
+    // update the variables for the fields in the packet
+
+    // encoder count
+    count = (int)((uint32_t)count + (uint32_t)config.encoder_count_increment());
+
+    return make_status(timestamp);
+  }
+
+  /**
+   * @brief status packet with the current encoder count and the next samples
+   *
+   * @param timestamp time of the report
+   */
+  packet_msg<conveyor_sts_packet> make_status(const sc_time &timestamp) {
+
+    // temperature and vibration
+    if (CONVEYOR_SAMPLE_BATCH == sample_index) draw_samples();
+    temp = temp_samples[sample_index];
+    vibr = vibr_samples[sample_index];
+    ++sample_index;
+
+    // create a packet
+    packet_ptr<conveyor_sts_packet> conveyor_pkt;
+
+    // fill out the packet
+    conveyor_pkt->set_id(my_id);
+    conveyor_pkt->set_vibration(vibr);
+    conveyor_pkt->set_temperature(temp);
+    conveyor_pkt->set_current_cnt(count);
+    conveyor_pkt->set_timestamp(timestamp);
+
+    return conveyor_pkt.send();
+  }
+
+  /**
+   * @brief write the pending report without blocking
+   * When the fifo is full the method is re-armed on its data_read_event().
+   *
+   * @return true when the report was written
+   */
+  bool flush_pending() {
+    if (!out->nb_write(pending_msg)) {
+      next_trigger(out->data_read_event());
+      return false;
+    }
+    pending = false;
+    return true;
+  }
+
+  /**
+   * @brief one wakeup per report, control packets checked at every report
+   *
+   */
+  void timed_loop() {
 
     while (true) {
-      wait(CONVEYOR_REPORT_RATE_MS, SC_MS);
+      wait(config.report_rate_ms(), SC_MS);
+      PROFILE_ACTIVATION(profile_slot);
+      ++wakeup_count;
 
-      // --------------------------------
-      // Check for received control packets
-      // --------------------------------
+      read_control(false);
 
-      samples_available = in->num_available();
-      if (samples_available != 0) {
+      if (running) out->write(next_status(sc_time_stamp())); // send it
+    } // end while
+  }
 
-        in->read(ctrl_pkt_ptr);
+  /**
+   * @brief loosely-timed loop, runs ahead of the kernel by up to one quantum
+   * The reports of a whole quantum are sent at once with their own timestamps,
+   * then the thread syncs at the end of the quantum or as soon as a control
+   * packet arrives. A control packet takes effect on the first report that has
+   * not been sent yet, so it can lag by up to one quantum.
+   *
+   */
+  void decoupled_loop() {
+    sc_time period(config.report_rate_ms(), SC_MS);
 
-        // perform required processsing
-        if (ctrl_pkt_ptr->get_msg() == CONTROL_PKT_MSG_TURN_ON) {
-          running = CONTROL_PKT_MSG_TURN_ON;
+    next_report = sc_time_stamp() + period;
 
-          printf("\nInfo: conveyor_inst: control_pkt received: \n");
-          printf("Info: Turning On \n");
+    while (true) {
+      // the profiled activation ends before the wait
+      {
+        // sync point, the kernel time is the local time
+        PROFILE_ACTIVATION(profile_slot);
+        ++wakeup_count;
+        read_control(true);
+
+        // run ahead up to the end of the quantum
+        horizon = sc_time_stamp() + quantum;
+        while (next_report < horizon) {
+          if (running) out->write(next_status(next_report)); // send it
+          next_report += period;
         }
+      }
 
-        // perform required processsing
-        if (ctrl_pkt_ptr->get_msg() == CONTROL_PKT_MSG_TURN_OFF) {
-          running = CONTROL_PKT_MSG_TURN_OFF;
+      // a full fifo may have held the thread past the horizon
+      if (sc_time_stamp() < horizon) wait(horizon - sc_time_stamp(), in->data_written_event());
+    } // end while
+  }
 
-          printf("\nInfo: conveyor_inst: control_pkt received: \n");
-          printf("Info: Turning Off \n");
-        }
+  /**
+   * @brief number of ticks at or before time t
+   *
+   */
+  uint64_t ticks_at(const sc_time &t) const {
+    if (t < tick_origin) return 0;
+    return (t - tick_origin).value() / sc_time(config.report_rate_ms(), SC_MS).value() + 1;
+  }
 
-        ctrl_pkt_ptr->print();
+  /**
+   * @brief time of tick k, k >= 1
+   *
+   */
+  sc_time tick_time(uint64_t k) const {
+    sc_time period(config.report_rate_ms(), SC_MS);
 
-        delete ctrl_pkt_ptr; // free memory
-      }
+    return sc_time::from_value(tick_origin.value() + (k - 1) * period.value());
+  }
+
+  /**
+   * @brief encoder count at time t, from the count of the last update and the ticks since
+   * Same value as adding encoder_count_increment() on every tick the segment is running.
+   *
+   */
+  int encoder_count_at(const sc_time &t) const {
+    uint64_t ticks = running ? ticks_at(t) - count_ticks : 0;
+
+    // wraps like the per tick increment
+    return (int)((uint32_t)count + (uint32_t)(ticks * (uint32_t)config.encoder_count_increment()));
+  }
+
+  /**
+   * @brief one activation of the lazy encoder
+   * Brings the count up to date, applies the control packets from the next tick
+   * on and sets wake_time to the next periodic report, sc_max_time() when there
+   * is none and only a control packet can wake the segment.
+   *
+   * @return true when a report is due now
+   */
+  bool lazy_step() {
+    int      was_running = running;
+    uint64_t next_tick;
+    bool     due;
+
+    ++wakeup_count;
+
+    count       = encoder_count_at(sc_time_stamp());
+    count_ticks = ticks_at(sc_time_stamp());
+    read_control(true);
+
+    if (0 == report_every) {
+      due = (running != was_running);
+    } else {
+      // on a reporting tick the segment ran through
+      due = was_running && (count_ticks > last_report_tick) && (0 == count_ticks % report_every) &&
+            (tick_time(count_ticks) == sc_time_stamp());
+      if (due) last_report_tick = count_ticks;
+    }
+
+    if (running && (report_every > 0)) {
+      next_tick = (count_ticks / report_every + 1) * report_every;
+      wake_time = tick_time(next_tick);
+    } else {
+      wake_time = sc_max_time();
+    }
+    return due;
+  }
+
+  /**
+   * @brief a wakeup per report or state change instead of one per tick
+   *
+   */
+  void lazy_loop() {
+    tick_origin = sc_time_stamp() + sc_time(config.report_rate_ms(), SC_MS);
 
-      // --------------------------------
-      // if running, send status
-      // --------------------------------
-      if (running) {
-
-        // update the variables for the fields in the packet
-
-        // encoder count
-        count += (int)ENCODER_COUNT_INCREMENT;
-
-        // temperature
-        tmp_var = rand();
-        if (tmp_var & 0x00000001)
-          temp = TEMPERATURE_MEAN + (tmp_var % (TEMPERATURE_VARIANCE / 2));
-        else
-          temp = TEMPERATURE_MEAN - (tmp_var % (TEMPERATURE_VARIANCE / 2));
-
-        // vibration
-        tmp_var = rand();
-        if (tmp_var & 0x00000001)
-          vibr = VIBRATION_MEAN + (tmp_var % (VIBRATION_VARIANCE / 2));
-        else
-          vibr = VIBRATION_MEAN - (tmp_var % (VIBRATION_VARIANCE / 2));
-
-        // create a packet
-        conveyor_pkt_ptr = new conveyor_sts_packet();
-
-        // fill out the packet
-        conveyor_pkt_ptr->set_id(my_id);
-        conveyor_pkt_ptr->set_vibration(vibr);
-        conveyor_pkt_ptr->set_temperature(temp);
-        conveyor_pkt_ptr->set_current_cnt(count);
-        conveyor_pkt_ptr->set_timestamp(sc_time_stamp());
-
-        out->write(conveyor_pkt_ptr); // send it
+    while (true) {
+      // the profiled activation ends before the wait
+      {
+        PROFILE_ACTIVATION(profile_slot);
+        if (lazy_step()) out->write(make_status(sc_time_stamp())); // send it
       }
 
+      // control packets written while the report was blocked on the fifo
+      if ((in->num_available() > 0) || (wake_time <= sc_time_stamp())) continue;
+
+      if (sc_max_time() == wake_time) {
+        wait(in->data_written_event());
+      } else {
+        wait(wake_time - sc_time_stamp(), in->data_written_event());
+      }
     } // end while
+  }
+
+  void conveyor_thread() {
+
+    // get each instance off of time=0 by some random amount
+    tmp_var = rng.uniform(20) + 1; // 1 to 20 ms
+    wait(tmp_var, SC_MS);
+
+    if (SC_ZERO_TIME != quantum) {
+      decoupled_loop();
+    } else if (1 != report_every) {
+      lazy_loop();
+    } else {
+      timed_loop();
+    }
 
   } // End conveyor thread
+
+  /**
+   * @brief re-arm conveyor_method at wake_time, in STATE_SYNC also on a control packet
+   *
+   */
+  void trigger_at_wake_time() {
+    if (STATE_LAZY == state) {
+      if ((in->num_available() > 0) || (wake_time <= sc_time_stamp())) {
+        next_trigger(SC_ZERO_TIME);
+      } else if (sc_max_time() == wake_time) {
+        next_trigger(in->data_written_event());
+      } else {
+        next_trigger(wake_time - sc_time_stamp(), in->data_written_event());
+      }
+    } else if (STATE_SYNC == state) {
+      next_trigger(wake_time - sc_time_stamp(), in->data_written_event());
+    } else {
+      next_trigger(wake_time - sc_time_stamp());
+    }
+  }
+
+  /**
+   * @brief conveyor_thread as a stackless SC_METHOD
+   * Each wait() of the thread becomes a next_trigger() and the state to resume
+   * from. A report that does not fit in the fifo stays pending and is written
+   * first on the next activation.
+   *
+   */
+  void conveyor_method() {
+    PROFILE_ACTIVATION(profile_slot);
+    sc_time period(config.report_rate_ms(), SC_MS);
+
+    if (restoring) {
+      // sleep through the time before the checkpoint, then through the rest of the wait
+      if (sc_time_stamp() < resume_time) {
+        next_trigger(resume_time - sc_time_stamp());
+        return;
+      }
+      restoring = false;
+      if (!pending && (wake_time > sc_time_stamp()) &&
+          !(((STATE_SYNC == state) || (STATE_LAZY == state)) && (in->num_available() > 0))) {
+        trigger_at_wake_time();
+        return;
+      }
+    }
+
+    switch (state) {
+    case STATE_START:
+      // get each instance off of time=0 by some random amount
+      tmp_var = rng.uniform(20) + 1; // 1 to 20 ms
+
+      if ((SC_ZERO_TIME == quantum) && (1 != report_every)) {
+        state       = STATE_LAZY;
+        wake_time   = sc_time_stamp() + sc_time(tmp_var, SC_MS);
+        tick_origin = wake_time + period;
+      } else if (SC_ZERO_TIME == quantum) {
+        state     = STATE_REPORT;
+        wake_time = sc_time_stamp() + sc_time(tmp_var, SC_MS) + period;
+      } else {
+        state       = STATE_SYNC;
+        next_report = sc_time_stamp() + sc_time(tmp_var, SC_MS) + period;
+        wake_time   = sc_time_stamp() + sc_time(tmp_var, SC_MS);
+      }
+      next_trigger(wake_time - sc_time_stamp());
+      return;
+
+    case STATE_REPORT:
+      if (pending) {
+        if (!flush_pending()) return;
+      } else {
+        ++wakeup_count;
+        read_control(false);
+
+        if (running) {
+          pending_msg = next_status(sc_time_stamp());
+          pending     = true;
+          if (!flush_pending()) return;
+        }
+      }
+      wake_time = sc_time_stamp() + period;
+      trigger_at_wake_time();
+      return;
+
+    case STATE_SYNC:
+      // sync point, the kernel time is the local time
+      ++wakeup_count;
+      read_control(true);
+
+      horizon = sc_time_stamp() + quantum;
+      state   = STATE_RUN_AHEAD;
+      // fall through
+
+    case STATE_RUN_AHEAD:
+      if (pending && !flush_pending()) return;
+
+      // run ahead up to the end of the quantum
+      while (next_report < horizon) {
+        if (running) {
+          pending_msg = next_status(next_report);
+          pending     = true;
+        }
+        next_report += period;
+        if (pending && !flush_pending()) return;
+      }
+
+      // a full fifo may have held the method past the horizon
+      state     = STATE_SYNC;
+      wake_time = (sc_time_stamp() < horizon) ? horizon : sc_time_stamp();
+      trigger_at_wake_time();
+      return;
+
+    case STATE_LAZY:
+      if (pending) {
+        if (!flush_pending()) return;
+      } else if (lazy_step()) {
+        pending_msg = make_status(sc_time_stamp());
+        pending     = true;
+        if (!flush_pending()) return;
+      }
+      trigger_at_wake_time();
+      return;
+    }
+  }
+
+  /**
+   * @brief write the conveyor state to a checkpoint, PROCESS_STYLE_METHOD only
+   *
+   */
+  void save(checkpoint_writer &ckpt) const {
+    ckpt.put(temp);
+    ckpt.put(vibr);
+    ckpt.put(count);
+    ckpt.put(running);
+    ckpt.put(rng.get_counter());
+    ckpt.put(batch_counter);
+    ckpt.put(sample_index);
+    ckpt.put((int)state);
+    ckpt.put(next_report);
+    ckpt.put(horizon);
+    ckpt.put(wake_time);
+    ckpt.put(wakeup_count);
+    ckpt.put(tick_origin);
+    ckpt.put(count_ticks);
+    ckpt.put(last_report_tick);
+    ckpt.put(pending);
+    if (pending) save_packet(ckpt, packet_of<conveyor_sts_packet>(pending_msg));
+  }
+
+  /**
+   * @brief read the state written by save(), before sc_start()
+   * The sample batch in use is drawn again from its rng counter.
+   *
+   * @param checkpoint_time the method sleeps until then
+   */
+  void restore(checkpoint_reader &ckpt, const sc_time &checkpoint_time) {
+    uint64_t counter     = 0;
+    int      saved_state = STATE_START;
+
+    ckpt.get(temp);
+    ckpt.get(vibr);
+    ckpt.get(count);
+    ckpt.get(running);
+    ckpt.get(counter);
+    ckpt.get(batch_counter);
+    ckpt.get(sample_index);
+    ckpt.get(saved_state);
+    ckpt.get(next_report);
+    ckpt.get(horizon);
+    ckpt.get(wake_time);
+    ckpt.get(wakeup_count);
+    ckpt.get(tick_origin);
+    ckpt.get(count_ticks);
+    ckpt.get(last_report_tick);
+    ckpt.get(pending);
+    if (pending) {
+      packet_ptr<conveyor_sts_packet> conveyor_pkt;
+
+      restore_packet(ckpt, *conveyor_pkt);
+      pending_msg = conveyor_pkt.send();
+    }
+
+    if ((sample_index < 0) || (sample_index > CONVEYOR_SAMPLE_BATCH)) ckpt.fail();
+    if (sample_index < CONVEYOR_SAMPLE_BATCH) {
+      int index = sample_index;
+
+      rng.set_counter(batch_counter);
+      draw_samples();
+      sample_index = index;
+    }
+    rng.set_counter(counter);
+    state = (method_state)saved_state;
+
+    restoring   = true;
+    resume_time = checkpoint_time;
+  }
+
+  long get_wakeup_count() const { return wakeup_count; }
+
+  /**
+   * @brief encoder count now, computed on demand in the lazy mode
+   *
+   */
+  int get_encoder_count() const {
+    return ((1 == report_every) || (SC_ZERO_TIME != quantum)) ? count : encoder_count_at(sc_time_stamp());
+  }
 };
 
 /**
  * @brief Control_system module
  * This module controls the conveyor belt. It communicates with the scanner and the conveyor through
  * sc_fifos
+ * In CONTROL_MODE_POLLING the controller wakes every control_rate_us() and polls the fifos.
+ * In CONTROL_MODE_EVENT it blocks on the data_written_event() of every input fifo and only runs when
+ * there is work, the loop count is then a simulated time budget of loop count * control_rate_us().
+ * In CONTROL_MODE_COSIM it waits like the event mode but forwards the status packets to a
+ * cosim_controller running the control rules on an OS thread, and writes the commands it sends back.
  * @param Input scanner_sts_packet from scanner
  * @param Input conveyor_sts_packet from conveyor system
  * @param Output control_packet to scanner system
  * @param Output control_packet to conveyor system
+ * @param Config configuration policy, see conveyor_config.hpp
  */
+template <typename Config>
 class Control_System : public sc_module {
 private:
   int index;
@@ -250,172 +947,909 @@ private:
   int scanner_running;
   int samples_available;
   int control_system_loop_count;
+  int control_mode;
+  int num_segments;
 
-  // Control packets
-  control_packet *control_pkt_ptr;
+  Config          config;
+  sim_log_source &log;
 
-  // Received status packets
-  scanner_sts_packet  *scanner_pkt_ptr;
-  conveyor_sts_packet *conveyor_pkt_ptr;
+  // wakeup statistics
+  long wakeup_count;       // number of times the control loop ran
+  long empty_wakeup_count; // number of times the control loop found no packet
 
-  // arrays that hold the pointers to the sc_ports
-  sc_port<sc_fifo_in_if<conveyor_sts_packet *> > *seg_in_port[NUM_CONVEYOR_SEGMENTS];
-  sc_port<sc_fifo_out_if<control_packet *> >     *seg_out_port[NUM_CONVEYOR_SEGMENTS];
+  // run statistics
+  long bags_scanned;    // scanner status packets received
+  long scanner_toggles; // scanner on/off changes
+  int  max_bag_count;   // max number of bags in the system
+  long bags_delivered;  // bags that reached the end of the belt
 
-  ds::HashMap bag_hash; // hash table to keep track of BagID's
+  // bag delivery, the belt position is the encoder count of the first segment
+  uint32_t              delivery_counts;  // encoder counts from the scanner to the end of the belt, 0 never
+  uint32_t              belt_count;       // last encoder count of the first segment
+  sc_time               belt_time;        // time of belt_count, sc_max_time() before the first report
+  sc_time               scanner_off_time; // time the scanner was turned off, sc_max_time() when on
 
-public:
-  // port list
-  sc_port<sc_fifo_in_if<scanner_sts_packet *> > scanner_in;
-  sc_port<sc_fifo_out_if<control_packet *> >    scanner_out;
+  // latency histograms, time resolution ticks
+  hdr_histogram scan_to_delivery; // scanner status packet to the end of the belt
+  hdr_histogram scanner_off;      // scanner turned off to turned back on
+  hdr_histogram fifo_delay;       // status packet stamped to read by the control system
 
-  sc_port<sc_fifo_in_if<conveyor_sts_packet *> > seg0_in;
-  sc_port<sc_fifo_out_if<control_packet *> >     seg0_out;
+  // Received status packets
+  packet_msg<scanner_sts_packet>  scanner_msg;
+  packet_msg<conveyor_sts_packet> conveyor_msg;
+  scanner_sts_packet             *scanner_pkt_ptr; // packets kept in the bag_ring
+
+  // segments with received status packets, used when all segment fifos are ready_fifos
+  ready_queue      seg_ready;
+  std::vector<int> ready_segs;
+  bool             ready_ingest;
+
+  telemetry_recorder *telemetry; // records the conveyor status packets when set
+
+  health_monitor health; // temperature and vibration alarms
+
+  PROFILE_SLOT(profile_slot);
+
+  // a bag in the system
+  struct bag_entry {
+    scanner_sts_packet *pkt;         // scanner packet of the bag, with its BagID
+    uint32_t            start_count; // belt_count at the scan
+  };
+
+  // bags in the system in order of scan, sized in the constructor: no allocation per bag
+  std::vector<bag_entry> bag_ring;
+  size_t                 bag_first; // index of the oldest bag
+  size_t                 bag_held;  // bags in the bag_ring
+
+  // checkpoint and restore
+  sc_time loop_wait_start; // time the control loop started its current wait
+  bool    waiting;         // the control loop is in its wait, the only point a checkpoint can be taken
+  bool    restoring;       // restored from a checkpoint, not resumed yet
+  sc_time resume_time;     // time the restored thread resumes its loop
+
+  // CONTROL_MODE_COSIM, the control rules run on the cosim_controller thread
+  cosim_controller          *cosim;
+  sc_time                    cosim_sync;    // simulated time between sync points, 0 syncs every wakeup
+  cosim_link                 link;          // wakes the control loop when commands come back
+  uint64_t                   cosim_seq;     // status messages sent
+  std::vector<cosim_command> cosim_pending; // commands received, not written yet
+  cosim_latency              command_latency; // status sent to control packet written, real time
+  cosim_latency              sync_wait;       // kernel stopped at the sync points, real time
+  long                       ring_stalls;     // sends that found the status ring full
 
-  SC_HAS_PROCESS(Control_System);
+  /**
+   * @brief send a control packet to the scanner
+   *
+   * @param msg CONTROL_PKT_MSG_TURN_ON or CONTROL_PKT_MSG_TURN_OFF
+   */
+  void send_scanner_control(int msg) {
+    packet_ptr<control_packet> control_pkt;
 
-  Control_System(sc_module_name name, int csl_count)
-      : sc_module(name), control_system_loop_count(csl_count), bag_hash(true, 128) {
-    // process declaration
-    SC_THREAD(control_system_thread);
+    control_pkt->set_timestamp(sc_time_stamp());
+    control_pkt->set_msg(msg);
+    control_pkt->set_data(0);
 
-    // initialize variables
-    index             = 0;
-    bag_id            = 0;
-    bag_count         = 0;
-    scanner_running   = 0;
-    samples_available = 0;
+    scanner_out->write(control_pkt.send());
 
-    // initialize ports
-    seg_in_port[0]  = &seg0_in;
-    seg_out_port[0] = &seg0_out;
-    // bag_hash        = new ds::HashMap(true, 128);
+    if (scanner_running != msg) ++scanner_toggles;
+    if (CONTROL_PKT_MSG_TURN_OFF == msg) {
+      if (CONTROL_PKT_MSG_TURN_ON == scanner_running) scanner_off_time = sc_time_stamp();
+    } else if (sc_max_time() != scanner_off_time) {
+      scanner_off.record((sc_time_stamp() - scanner_off_time).value());
+      scanner_off_time = sc_max_time();
+    }
+    scanner_running = msg;
   }
 
-  void control_system_thread() {
+  /**
+   * @brief record the time a status packet waited in its fifo
+   * The decoupled conveyors stamp their reports ahead of the kernel time, they count as 0.
+   *
+   */
+  void record_fifo_delay(const sc_time &timestamp) {
+    fifo_delay.record((sc_time_stamp() > timestamp) ? (sc_time_stamp() - timestamp).value() : 0);
+  }
+
+  /**
+   * @brief encoder count of the first segment at time t
+   *
+   * With --report-every the segment reports once every few ticks but the belt moves on every tick
+   * in between, so the count is carried forward from its last report as if the segment kept running.
+   */
+  uint32_t belt_count_at(const sc_time &t) const {
+    sc_time  period(config.report_rate_ms(), SC_MS);
+    uint64_t ticks;
 
-    control_pkt_ptr = new control_packet();
+    if ((sc_max_time() == belt_time) || (t <= belt_time)) return belt_count;
 
-    control_pkt_ptr->set_timestamp(sc_time_stamp());
-    control_pkt_ptr->set_msg(CONTROL_PKT_MSG_TURN_ON);
-    control_pkt_ptr->set_data(0);
+    ticks = (t - belt_time).value() / period.value();
+    return belt_count + (uint32_t)(ticks * (uint32_t)config.encoder_count_increment());
+  }
 
-    scanner_out->write(control_pkt_ptr);
-    scanner_running = CONTROL_PKT_MSG_TURN_ON;
+  /**
+   * @brief append a bag to the bag_ring
+   * The scanner is turned off at max_bags(), but the scans already in its fifo and the one it may be
+   * writing still arrive, so the ring holds max_bags() + fifo_depth() + 1 bags.
+   *
+   * @param pkt scanner packet of the bag, stays in its pool while the bag is in the system
+   * @param start_count belt_count at the scan
+   * @return false when the ring is full
+   */
+  bool push_bag(scanner_sts_packet *pkt, uint32_t start_count) {
+    if (bag_held == bag_ring.size()) return false;
+
+    bag_entry &bag  = bag_ring[(bag_first + bag_held) % bag_ring.size()];
+    bag.pkt         = pkt;
+    bag.start_count = start_count;
+    ++bag_held;
+    return true;
+  }
 
-    // Cycle through the conveyor segments
-    for (index = 0; index < NUM_CONVEYOR_SEGMENTS; index++) {
-      control_pkt_ptr = new control_packet();
+  // i-th bag of the bag_ring, 0 the oldest
+  const bag_entry &get_bag(size_t i) const {
+    return bag_ring[(bag_first + i) % bag_ring.size()];
+  }
 
-      control_pkt_ptr->set_timestamp(sc_time_stamp());
-      control_pkt_ptr->set_msg(CONTROL_PKT_MSG_TURN_ON);
-      control_pkt_ptr->set_data(0);
+  /**
+   * @brief deliver the bags the belt carried to its end, in order of scan
+   *
+   * @param count encoder count of the first segment
+   * @param timestamp time of the status packet
+   */
+  void deliver_bags(int count, const sc_time &timestamp) {
+    belt_count = (uint32_t)count;
+    belt_time  = timestamp;
+
+    while ((0 != delivery_counts) && (0 != bag_held) &&
+           (belt_count - get_bag(0).start_count >= delivery_counts)) {
+      scanner_pkt_ptr = get_bag(0).pkt;
+      if (timestamp > scanner_pkt_ptr->get_timestamp()) {
+        scan_to_delivery.record((timestamp - scanner_pkt_ptr->get_timestamp()).value());
+      } else {
+        scan_to_delivery.record(0);
+      }
 
-      (*seg_out_port[index])->write(control_pkt_ptr); // send it to conveyor segment
+      // the bag leaves the system, its scanner packet goes back to the pool
+      packet_pool<scanner_sts_packet>::instance().release(scanner_pkt_ptr);
+      bag_first = (bag_first + 1) % bag_ring.size();
+      --bag_held;
+      ++bags_delivered;
+      --bag_count;
     }
+  }
 
-    while (true) {
-      wait(CONTROL_SYSTEM_RATE_US, SC_US);
+  /**
+   * @brief read and process one scanner status packet
+   *
+   */
+  void process_scanner_packet() {
+    int msg;
 
-      // Check for received scanner status packets
-      samples_available = scanner_in->num_available();
-      if (samples_available != 0) {
-        scanner_in->read(scanner_pkt_ptr);
+    scanner_in->read(scanner_msg);
+    packet_ptr<scanner_sts_packet> scanner_pkt(scanner_msg);
 
-        // save the scanner_pkt_ptr in the bag_hash
-        bag_hash.Insert(scanner_pkt_ptr->get_bag_id(), scanner_pkt_ptr);
+    record_fifo_delay(scanner_pkt->get_timestamp());
 
-        ++bag_count;
-        if ((scanner_running == CONTROL_PKT_MSG_TURN_ON) && (bag_count >= MAX_NUMBER_BAGS_IN_SYSTEM)) {
+    if (nullptr != cosim) {
+      cosim_status status = {};
 
-          // send a turn off command to the scanner
-          control_pkt_ptr = new control_packet();
+      status.kind        = COSIM_MSG_SCANNER;
+      status.pkt.scanner = wire_traits<scanner_sts_packet>::encode(*scanner_pkt);
+      cosim_send(status);
+      ++bags_scanned;
+      return;
+    }
 
-          control_pkt_ptr->set_timestamp(sc_time_stamp());
-          control_pkt_ptr->set_msg(CONTROL_PKT_MSG_TURN_OFF);
-          control_pkt_ptr->set_data(0);
+    // save the scanner packet in the bag_ring, it stays in its pool while the bag is in the system
+    scanner_pkt_ptr = scanner_pkt.detach();
+    if (!push_bag(scanner_pkt_ptr, belt_count_at(scanner_pkt_ptr->get_timestamp()))) {
+      SC_REPORT_ERROR(name(), "more bags in the system than max_bags + fifo_depth + 1");
+    }
 
-          scanner_out->write(control_pkt_ptr);
+    ++bags_scanned;
+    ++bag_count;
+    if (bag_count > max_bag_count) max_bag_count = bag_count;
 
-          scanner_running = CONTROL_PKT_MSG_TURN_OFF;
-        }
-      } // end if samples_available
+    // send a turn off command to the scanner when the system is full
+    msg = scanner_control_after_scan(scanner_running, bag_count, config.max_bags());
+    if (CONTROL_PKT_MSG_NONE != msg) send_scanner_control(msg);
+  }
 
-      // Check for received conveyor status packets
-      samples_available = seg0_in->num_available();
-      if (samples_available != 0) {
-        seg0_in->read(conveyor_pkt_ptr);
+  /**
+   * @brief read and process one conveyor status packet
+   *
+   * @param seg index of the conveyor segment port
+   */
+  void process_conveyor_packet(int seg) {
+    int msg;
 
-        conveyor_pkt_ptr->print();
+    seg_in_port[seg]->read(conveyor_msg);
+    packet_ptr<conveyor_sts_packet> conveyor_pkt(conveyor_msg);
 
-        // Check for alarm condition
+    SIM_LOG(log, SIM_LOG_DEBUG, "conveyor_sts_packet: segment %d count %u temp %d vibration %d at %.9f s",
+            conveyor_pkt->get_id(), conveyor_pkt->get_current_cnt(), conveyor_pkt->get_temperature(),
+            conveyor_pkt->get_vibration(), conveyor_pkt->get_timestamp().to_seconds());
 
-        // Update bag postiiion and delete bags delivered
-        bag_id = bag_hash.GetFirstKey();
-        if (-1 != bag_id) {
-          scanner_pkt_ptr = (scanner_sts_packet *)bag_hash.GetValue(bag_id);
-        }
+    record_fifo_delay(conveyor_pkt->get_timestamp());
 
-        if ((CONTROL_PKT_MSG_TURN_OFF == scanner_running) &&
-            (bag_count < (MAX_NUMBER_BAGS_IN_SYSTEM - BAG_COUNT_HYSTERESIS))) {
+    if (nullptr != telemetry) {
+      telemetry->record(conveyor_pkt->get_timestamp().value(), conveyor_pkt->get_id(),
+                        conveyor_pkt->get_current_cnt(), (int16_t)conveyor_pkt->get_temperature(),
+                        (int16_t)conveyor_pkt->get_vibration());
+    }
 
-          // send a turn on command to the scanner
-          control_pkt_ptr = new control_packet();
+    if (nullptr != cosim) {
+      cosim_status status = {};
 
-          control_pkt_ptr->set_timestamp(sc_time_stamp());
-          control_pkt_ptr->set_msg(CONTROL_PKT_MSG_TURN_ON);
-          control_pkt_ptr->set_data(0);
+      status.kind         = COSIM_MSG_CONVEYOR;
+      status.segment      = seg;
+      status.pkt.conveyor = wire_traits<conveyor_sts_packet>::encode(*conveyor_pkt);
+      cosim_send(status);
+      return;
+    }
+
+    // Check for alarm condition, the staged samples are filtered once per wakeup by check_health()
+    health.stage(seg, conveyor_pkt->get_id(), conveyor_pkt->get_timestamp().value(),
+                 conveyor_pkt->get_temperature(), conveyor_pkt->get_vibration());
+
+    // Update bag position and take the bags delivered out of the system
+    if (0 == seg) deliver_bags(conveyor_pkt->get_current_cnt(), conveyor_pkt->get_timestamp());
+
+    // send a turn on command to the scanner once there is room again
+    msg = scanner_control_after_status(scanner_running, bag_count, config.max_bags(),
+                                       config.bag_hysteresis());
+    if (CONTROL_PKT_MSG_NONE != msg) send_scanner_control(msg);
+  } // conveyor_pkt goes back to its pool
+
+  /**
+   * @brief filter the samples received in this wakeup and report the alarm changes
+   *
+   */
+  void check_health() {
+    int                 alarm_count = health.update();
+    const health_alarm *alarms      = health.get_alarms();
 
-          scanner_out->write(control_pkt_ptr);
+    if (0 == alarm_count) return;
+
+    for (int i = 0; i < alarm_count; i++) log_alarm(alarms[i]);
+    health.clear_alarms();
+  }
 
-          scanner_running = CONTROL_PKT_MSG_TURN_ON;
+  // also the alarms of the cosim controller, which cannot log from its thread
+  void log_alarm(const health_alarm &alarm) {
+    SIM_LOG(log, SIM_LOG_INFO, "segment %d %s alarm %s: value=%.0f z=%.2f at %.9f s", alarm.segment,
+            (HEALTH_CHANNEL_TEMPERATURE == alarm.channel) ? "temperature" : "vibration",
+            alarm.raised ? "raised" : "cleared", alarm.value, alarm.z,
+            alarm.timestamp * sc_get_time_resolution().to_seconds());
+  }
+
+  /**
+   * @brief read the conveyor status packets of the segments with data
+   *
+   * @param drain_all read every packet of a segment instead of one per call
+   * @return int number of packets read
+   */
+  int ingest_segments(bool drain_all) {
+    int packets = 0;
+
+    if (!ready_ingest) {
+      // scan every segment
+      for (index = 0; index < num_segments; index++) {
+        while (seg_in_port[index]->num_available() != 0) {
+          process_conveyor_packet(index);
+          ++packets;
+          if (!drain_all) break;
         }
-        delete conveyor_pkt_ptr;
+      }
+      return packets;
+    }
+
+    // only the segments written since the last call
+    seg_ready.take(ready_segs);
+    for (int seg : ready_segs) {
+      while (seg_in_port[seg]->num_available() != 0) {
+        process_conveyor_packet(seg);
+        ++packets;
+        if (!drain_all) break;
       }
 
+      if (seg_in_port[seg]->num_available() != 0) {
+        seg_ready.requeue(seg);
+      } else {
+        seg_ready.clear(seg);
+      }
+    }
+    return packets;
+  }
+
+  /**
+   * @brief read the received status packets, the work of one control loop wakeup
+   *
+   * @param drain_all read every packet instead of one per fifo
+   * @return true when a packet was read
+   */
+  bool service_inputs(bool drain_all) {
+    PROFILE_ACTIVATION(profile_slot);
+    bool work = false;
+
+    // Check for received scanner status packets
+    samples_available = scanner_in->num_available();
+    while (samples_available-- > 0) {
+      process_scanner_packet();
+      work = true;
+      if (!drain_all) break;
+    }
+
+    // Check for received conveyor status packets
+    if (ingest_segments(drain_all) != 0) {
+      check_health();
+      work = true;
+    }
+    return work;
+  }
+
+  /**
+   * @brief control loop waking up every control_rate_us()
+   *
+   */
+  void polling_loop() {
+    while (true) {
+      loop_wait_start = sc_time_stamp();
+      waiting         = true;
+      wait(config.control_rate_us(), SC_US);
+      waiting = false;
+      ++wakeup_count;
+
+      if (!service_inputs(false)) ++empty_wakeup_count;
+
       --control_system_loop_count;
       if (0 == control_system_loop_count) {
         break;
       }
     } // end while
-      // stop
+  }
+
+  /**
+   * @brief add the events of the input fifos to a list
+   *
+   */
+  void add_rx_events(sc_event_or_list &rx_events) {
+    rx_events |= scanner_in->data_written_event();
+    if (ready_ingest) {
+      rx_events |= seg_ready.get_ready_event();
+    } else {
+      for (index = 0; index < num_segments; index++) {
+        rx_events |= seg_in_port[index]->data_written_event();
+      }
+    }
+  }
+
+  /**
+   * @brief control loop blocking on the input fifos until the simulated time budget is spent
+   *
+   * @param resume restored from a checkpoint, the first pass is not a wakeup
+   */
+  void event_loop(bool resume) {
+    sc_time          deadline;
+    sc_event_or_list rx_events;
+
+    // the budget counts from time 0
+    deadline = control_system_loop_count * sc_time(config.control_rate_us(), SC_US);
+
+    add_rx_events(rx_events);
+
+    while (true) {
+      // drain everything received since the last wakeup
+      if (!service_inputs(true) && (0 != wakeup_count) && !resume) ++empty_wakeup_count;
+      resume = false;
+
+      if (sc_time_stamp() >= deadline) {
+        break;
+      }
+
+      loop_wait_start = sc_time_stamp();
+      waiting         = true;
+      wait(deadline - sc_time_stamp(), rx_events);
+      waiting = false;
+      ++wakeup_count;
+    } // end while
+  }
+
+  /**
+   * @brief send a status message to the controller, its commands are drained while the ring is full
+   *
+   */
+  void cosim_send(cosim_status &status) {
+    status.seq     = ++cosim_seq;
+    status.sent_ns = cosim_clock_ns();
+    while (!cosim->try_send(status)) {
+      cosim_drain();
+      ++ring_stalls;
+      std::this_thread::yield();
+    }
+  }
+
+  void cosim_drain() {
+    cosim_command cmd;
+    health_alarm  alarm;
+
+    while (cosim->try_receive(cmd)) cosim_pending.push_back(cmd);
+    while (cosim->try_receive_alarm(alarm)) log_alarm(alarm);
+  }
+
+  /**
+   * @brief stop the kernel until the controller processed every status message sent so far
+   *
+   */
+  void cosim_sync_point() {
+    cosim_status status = {};
+    int64_t      start;
+    int          spins = 0;
+
+    status.kind = COSIM_MSG_SYNC;
+    cosim_send(status);
+
+    start = cosim_clock_ns();
+    while (cosim->get_acked() < status.seq) {
+      cosim_drain();
+      if (++spins > COSIM_SPIN_LIMIT) std::this_thread::yield();
+    }
+    sync_wait.record(cosim_clock_ns() - start);
+  }
+
+  /**
+   * @brief write the control packets received from the controller
+   *
+   * @return int number of control packets written
+   */
+  int cosim_apply() {
+    int     applied;
+    int64_t now_ns;
+
+    cosim_drain();
+    if (cosim_pending.empty()) return 0;
+
+    now_ns = cosim_clock_ns();
+    for (const cosim_command &cmd : cosim_pending) {
+      command_latency.record(now_ns - cmd.cause_ns);
+
+      if (COSIM_TARGET_SCANNER == cmd.target) {
+        send_scanner_control(cmd.msg);
+      } else {
+        packet_ptr<control_packet> control_pkt;
+
+        control_pkt->set_timestamp(sc_time_stamp());
+        control_pkt->set_msg(cmd.msg);
+        control_pkt->set_data(0);
+
+        seg_out_port[cmd.target]->write(control_pkt.send());
+      }
+    }
+    applied = (int)cosim_pending.size();
+    cosim_pending.clear();
+    return applied;
+  }
+
+  /**
+   * @brief control loop of CONTROL_MODE_COSIM, forwards the status packets to the
+   * controller thread and writes the control packets it sends back
+   * The simulated time budget is the one of the event loop. With a sync period
+   * the kernel runs ahead of the controller and stops at every period; without,
+   * it waits for the answer to every wakeup, which makes the run deterministic.
+   *
+   */
+  void cosim_loop() {
+    sc_time               deadline;
+    sc_time               next_sync;
+    sc_time               timeout;
+    sc_event_or_list      rx_events;
+    std::function<void()> wake_fn;
+    bool                  lockstep = (SC_ZERO_TIME == cosim_sync);
+    bool                  work;
+
+    deadline  = control_system_loop_count * sc_time(config.control_rate_us(), SC_US);
+    next_sync = cosim_sync;
+
+    add_rx_events(rx_events);
+    rx_events |= link.command_event();
+
+    // in lockstep the commands are read at the sync point, no need to wake the kernel
+    if (!lockstep) wake_fn = [this]() { link.wake(); };
+    cosim->start(num_segments, wake_fn);
+
+    while (true) {
+      work = service_inputs(true);
+
+      if (lockstep ? work : (sc_time_stamp() >= next_sync)) {
+        cosim_sync_point();
+        while (!lockstep && (next_sync <= sc_time_stamp())) next_sync += cosim_sync;
+      }
+      if (0 != cosim_apply()) work = true;
+      if (!work && (0 != wakeup_count)) ++empty_wakeup_count;
+
+      if (sc_time_stamp() >= deadline) {
+        break;
+      }
+
+      timeout = (!lockstep && (next_sync < deadline)) ? next_sync : deadline;
+      wait(timeout - sc_time_stamp(), rx_events);
+      ++wakeup_count;
+    } // end while
+
+    cosim->stop();
+    cosim_drain();
+    cosim_pending.clear(); // commands after the end of the run
+  }
+
+  /**
+   * @brief print the latencies of the controller thread, in real time
+   *
+   */
+  void print_cosim_stats() {
+    printf("\nController thread:\n");
+    if (SC_ZERO_TIME == cosim_sync) {
+      printf("  sync period     = every wakeup\n");
+    } else {
+      printf("  sync period     = %s\n", cosim_sync.to_string().c_str());
+    }
+    printf("  status messages = %llu\n", (unsigned long long)cosim_seq);
+    printf("  ring stalls     = %ld\n", ring_stalls);
+    if (0 != cosim->get_alarms_dropped()) printf("  alarms dropped  = %ld\n", cosim->get_alarms_dropped());
+    command_latency.print("command latency");
+    sync_wait.print("sync waits");
+  }
+
+  /**
+   * @brief print the latency histograms, then one line per histogram for the sweep tool to merge
+   *
+   */
+  void print_latency_stats() {
+    const double   tick_s  = sc_get_time_resolution().to_seconds();
+    const uint64_t tick_fs = (uint64_t)(tick_s * 1e15 + 0.5);
+
+    printf("\nLatencies (simulated time):\n");
+    printf("  bags delivered   = %ld\n", bags_delivered);
+    scan_to_delivery.print("scan to delivery", tick_s);
+    scanner_off.print("scanner off", tick_s);
+    fifo_delay.print("fifo delay", tick_s);
+
+    scan_to_delivery.print_line("scan_to_delivery", tick_fs);
+    scanner_off.print_line("scanner_off", tick_fs);
+    fifo_delay.print_line("fifo_delay", tick_fs);
+  }
+
+  /**
+   * @brief print the wakeup statistics of the control loop
+   *
+   * @param loop_count number of wakeups the polling loop needs for the same simulated time
+   */
+  void print_wakeup_stats(int loop_count) {
+    printf("\nControl system wakeups:\n");
+    printf("  mode            = %s\n", control_mode_name(control_mode));
+    printf("  wakeups         = %ld\n", wakeup_count);
+    printf("  empty wakeups   = %ld\n", empty_wakeup_count);
+    printf("  avoided wakeups = %ld\n", loop_count - wakeup_count);
+  }
+
+public:
+  // port list
+  sc_port<sc_fifo_in_if<packet_msg<scanner_sts_packet> > > scanner_in;
+  sc_port<sc_fifo_out_if<packet_msg<control_packet> > >    scanner_out;
+
+  // one port pair per conveyor segment
+  sc_vector<sc_port<sc_fifo_in_if<packet_msg<conveyor_sts_packet> > > > seg_in_port;
+  sc_vector<sc_port<sc_fifo_out_if<packet_msg<control_packet> > > >     seg_out_port;
+
+  SC_HAS_PROCESS(Control_System);
+
+  Control_System(sc_module_name name, int csl_count, int segments, int mode = CONTROL_MODE_POLLING,
+                 const Config &cfg = Config())
+      : sc_module(name), control_system_loop_count(csl_count), control_mode(mode), num_segments(segments),
+        config(cfg), log(sim_log::instance().source(this->name())), link("cosim_link"),
+        seg_in_port("seg_in_port", segments), seg_out_port("seg_out_port", segments) {
+    // process declaration
+    SC_THREAD(control_system_thread);
+
+    // initialize variables
+    index              = 0;
+    bag_id             = 0;
+    bag_count          = 0;
+    scanner_running    = 0;
+    samples_available  = 0;
+    wakeup_count       = 0;
+    bags_scanned       = 0;
+    scanner_toggles    = 0;
+    max_bag_count      = 0;
+    bags_delivered     = 0;
+    empty_wakeup_count = 0;
+    ready_ingest       = false;
+    telemetry          = nullptr;
+
+    health.resize(num_segments);
+    bag_ring.resize(config.max_bags() + config.fifo_depth() + 1);
+    bag_first = 0;
+    bag_held  = 0;
+
+    delivery_counts  = 0;
+    belt_count       = 0;
+    belt_time        = sc_max_time();
+    scanner_off_time = sc_max_time();
+
+    waiting   = false;
+    restoring = false;
+
+    cosim       = nullptr;
+    cosim_seq   = 0;
+    ring_stalls = 0;
+  }
+
+  long get_bags_scanned() const {
+    return bags_scanned;
+  }
+
+  long get_scanner_toggles() const {
+    return scanner_toggles;
+  }
+
+  long get_bags_delivered() const {
+    return bags_delivered;
+  }
+
+  /**
+   * @brief length of belt a bag travels from the scanner to its delivery
+   *
+   * @param meters 0 keeps every bag in the system
+   */
+  void set_delivery_distance(double meters) {
+    delivery_counts = (uint32_t)(meters / config.dist_per_count_m() + 0.5);
+  }
+
+  int get_max_bag_count() const {
+    return (nullptr != cosim) ? cosim->get_max_bag_count() : max_bag_count;
+  }
+
+  long get_health_alarms() const {
+    return (nullptr != cosim) ? cosim->get_health_alarms() : (long)health.get_alarms_raised();
+  }
+
+  /**
+   * @brief run the control rules on a controller thread, CONTROL_MODE_COSIM
+   *
+   * @param controller controller, started by the control loop
+   * @param sync_us simulated time between sync points, 0 syncs at every wakeup
+   */
+  void set_cosim(cosim_controller *controller, int sync_us) {
+    cosim      = controller;
+    cosim_sync = sc_time(sync_us, SC_US);
+  }
+
+  /**
+   * @brief write the control system state to a checkpoint
+   *
+   * @return false when the control loop is not in its wait (e.g. blocked on a full fifo)
+   */
+  bool save(checkpoint_writer &ckpt) const {
+    if (!waiting) return false;
+
+    ckpt.put(bag_count);
+    ckpt.put(scanner_running);
+    ckpt.put(wakeup_count);
+    ckpt.put(empty_wakeup_count);
+    ckpt.put(bags_scanned);
+    ckpt.put(scanner_toggles);
+    ckpt.put(max_bag_count);
+    ckpt.put(loop_wait_start);
+
+    // bags in the system, with the belt count at their scan
+    ckpt.put((uint32_t)bag_held);
+    for (size_t i = 0; i < bag_held; i++) {
+      save_packet(ckpt, *get_bag(i).pkt);
+      ckpt.put(get_bag(i).start_count);
+    }
+
+    health.save(ckpt);
+
+    ckpt.put(bags_delivered);
+    ckpt.put(belt_count);
+    ckpt.put(belt_time);
+    ckpt.put(scanner_off_time);
+    ckpt.put(scan_to_delivery);
+    ckpt.put(scanner_off);
+    ckpt.put(fifo_delay);
+    return ckpt.ok();
+  }
+
+  /**
+   * @brief read the state written by save(), before sc_start()
+   *
+   * @param checkpoint_time time of the checkpoint
+   */
+  void restore(checkpoint_reader &ckpt, const sc_time &checkpoint_time) {
+    uint32_t bags        = 0;
+    uint32_t start_count = 0;
+
+    ckpt.get(bag_count);
+    ckpt.get(scanner_running);
+    ckpt.get(wakeup_count);
+    ckpt.get(empty_wakeup_count);
+    ckpt.get(bags_scanned);
+    ckpt.get(scanner_toggles);
+    ckpt.get(max_bag_count);
+    ckpt.get(loop_wait_start);
+
+    ckpt.get(bags);
+    for (uint32_t i = 0; ckpt.ok() && (i < bags); i++) {
+      packet_ptr<scanner_sts_packet> scanner_pkt;
+
+      restore_packet(ckpt, *scanner_pkt);
+      ckpt.get(start_count);
+      if (!ckpt.ok() || (bag_held == bag_ring.size())) break;
+      push_bag(scanner_pkt.detach(), start_count);
+    }
+    if (bags > bag_held) ckpt.fail(); // more bags than the ring of these line parameters holds
+
+    health.restore(ckpt);
+
+    ckpt.get(bags_delivered);
+    ckpt.get(belt_count);
+    ckpt.get(belt_time);
+    ckpt.get(scanner_off_time);
+    ckpt.get(scan_to_delivery);
+    ckpt.get(scanner_off);
+    ckpt.get(fifo_delay);
+
+    // the polling loop resumes its 1 us wait, the event loop resumes at the checkpoint
+    restoring   = true;
+    resume_time = (CONTROL_MODE_EVENT == control_mode) ? checkpoint_time : loop_wait_start;
+
+    // polls left in the budget
+    if (CONTROL_MODE_EVENT != control_mode) {
+      control_system_loop_count -= (int)wakeup_count;
+      if (control_system_loop_count < 1) control_system_loop_count = 1;
+    }
+  }
+
+  /**
+   * @brief record every received conveyor status packet
+   *
+   * @param recorder open telemetry recorder, nullptr to stop recording
+   */
+  void set_telemetry(telemetry_recorder *recorder) {
+    telemetry = recorder;
+  }
+
+  /**
+   * @brief attach the segment fifos to the ready queue, falls back to scanning every
+   * segment when one of them is not a ready_fifo
+   *
+   */
+  void end_of_elaboration() {
+    std::vector<ready_fifo<packet_msg<conveyor_sts_packet> > *> fifos(num_segments);
+
+    ready_ingest = true;
+    for (index = 0; index < num_segments; index++) {
+      fifos[index] =
+          dynamic_cast<ready_fifo<packet_msg<conveyor_sts_packet> > *>(seg_in_port[index].get_interface());
+      ready_ingest = ready_ingest && (nullptr != fifos[index]);
+    }
+
+    if (ready_ingest) {
+      seg_ready.resize(num_segments);
+      for (index = 0; index < num_segments; index++) {
+        fifos[index]->attach(&seg_ready, index);
+      }
+    }
+    ready_segs.reserve(num_segments);
+  }
+
+  void control_system_thread() {
+    int loop_count = control_system_loop_count;
+
+    // restore() took the polls done before the checkpoint out of the budget
+    if (restoring && (CONTROL_MODE_EVENT != control_mode)) loop_count += (int)wakeup_count;
+
+    if (restoring) {
+      // the scanner and the segments are already on, go back into the wait of the control loop
+      wait(resume_time - sc_time_stamp());
+    } else {
+      send_scanner_control(CONTROL_PKT_MSG_TURN_ON);
+
+      // Cycle through the conveyor segments
+      for (index = 0; index < num_segments; index++) {
+        packet_ptr<control_packet> control_pkt;
+
+        control_pkt->set_timestamp(sc_time_stamp());
+        control_pkt->set_msg(CONTROL_PKT_MSG_TURN_ON);
+        control_pkt->set_data(0);
+
+        seg_out_port[index]->write(control_pkt.send()); // send it to conveyor segment
+      }
+    }
+
+    if (CONTROL_MODE_EVENT == control_mode) {
+      event_loop(restoring);
+    } else if (CONTROL_MODE_COSIM == control_mode) {
+      cosim_loop();
+    } else {
+      polling_loop();
+    }
+
+    // stop, the statistics follow the log records
+    sim_log::instance().flush();
+    print_wakeup_stats(loop_count);
+    if (nullptr != cosim) {
+      cosim->print_stats();
+      print_cosim_stats();
+    } else {
+      health.print_stats();
+    }
+    print_latency_stats();
     cout.flush();
     sc_stop();
   } // end control_system_thread
-  ~Control_System() {}
+  ~Control_System() {
+    // the scanner packets of the bags still in the system go back to their pool
+    for (size_t i = 0; i < bag_held; i++) packet_pool<scanner_sts_packet>::instance().release(get_bag(i).pkt);
+  }
 };
 
+
 /**
  * @brief Top level module
  * Creates instance variables for each submodule to be instantiated
+ * @param Config configuration policy of the line, see conveyor_config.hpp
  *
  */
+template <typename Config>
 class top : public sc_module {
 public:
+  typedef packet_msg<scanner_sts_packet>  scanner_msg;
+  typedef packet_msg<conveyor_sts_packet> status_msg;
+  typedef packet_msg<control_packet>      control_msg;
+
+  // occupancy and stalls recorded with -DFIFO_MONITOR=1, see fifo_monitor.hpp
+  typedef monitored_fifo<scanner_msg, profile_fifo<scanner_msg> > scanner_fifo;
+  typedef monitored_fifo<status_msg, ready_fifo<status_msg> >     status_fifo;
+  typedef monitored_fifo<control_msg, profile_fifo<control_msg> > control_fifo;
+
   // declare instance variables
-  sc_fifo<scanner_sts_packet *> baggage_stfifo_inst;
-  sc_fifo<control_packet *>     baggage_ctlfifo_inst;
-  scanner                       baggage_scanner_inst;
+  scanner_fifo    baggage_stfifo_inst;
+  control_fifo    baggage_ctlfifo_inst;
+  scanner<Config> baggage_scanner_inst;
 
-  sc_fifo<conveyor_sts_packet *> conveyor_seg_stfifo_inst0;
-  sc_fifo<control_packet *>      conveyor_seg_ctlfifo_inst0;
-  conveyor                       conveyor_seg_inst0;
+  // one status fifo, control fifo and conveyor per segment
+  sc_vector<status_fifo>       conveyor_seg_stfifo_inst;
+  sc_vector<control_fifo>      conveyor_seg_ctlfifo_inst;
+  sc_vector<conveyor<Config> > conveyor_seg_inst;
 
-  Control_System control_system_inst;
+  Control_System<Config> control_system_inst;
 
   // constructor, create the module instantiations
-  top(sc_module_name name, int csl_count)
+  top(sc_module_name name, int seed, int csl_count, int num_segments, int control_mode, int quantum_ms,
+      int process_style, int report_every, const Config &config = Config())
       : sc_module(name),
         //, control_system_loop_count(csl_count) , // bind variables
 
-        baggage_stfifo_inst("baggage_stfifo_inst", 16), baggage_ctlfifo_inst("baggage_ctlfifo_inst", 16),
-        baggage_scanner_inst("baggage_scanner_inst"),
-
-        conveyor_seg_stfifo_inst0("conveyor_seg_stfifo_inst0", 16),
-        conveyor_seg_ctlfifo_inst0("conveyor_seg_ctlfifo_inst0", 16),
-        conveyor_seg_inst0("conveyor_seg_inst0", 100), // ID=100
-
-        control_system_inst("control_system_inst", csl_count)
+        baggage_stfifo_inst("baggage_stfifo_inst", config.fifo_depth()),
+        baggage_ctlfifo_inst("baggage_ctlfifo_inst", config.fifo_depth()),
+        baggage_scanner_inst("baggage_scanner_inst", seed, process_style, config),
+
+        conveyor_seg_stfifo_inst("conveyor_seg_stfifo_inst", num_segments,
+                                 [config](const char *fifo_name, size_t) {
+                                   return new status_fifo(fifo_name, config.fifo_depth());
+                                 }),
+        conveyor_seg_ctlfifo_inst("conveyor_seg_ctlfifo_inst", num_segments,
+                                  [config](const char *fifo_name, size_t) {
+                                    return new control_fifo(fifo_name, config.fifo_depth());
+                                  }),
+        conveyor_seg_inst("conveyor_seg_inst", num_segments,
+                          [=](const char *seg_name, size_t i) {
+                            return new conveyor<Config>(seg_name, CONVEYOR_SEGMENT_BASE_ID + (int)i, seed,
+                                                        quantum_ms, process_style, report_every,
+                                                        config); // ID=100, 101...
+                          }),
+
+        control_system_inst("control_system_inst", csl_count, num_segments, control_mode, config)
 
   {
 
@@ -426,37 +1860,474 @@ public:
     control_system_inst.scanner_out(baggage_ctlfifo_inst);
     baggage_scanner_inst.in(baggage_ctlfifo_inst);
 
-    conveyor_seg_inst0.out(conveyor_seg_stfifo_inst0);
-    control_system_inst.seg0_in(conveyor_seg_stfifo_inst0);
+    for (int i = 0; i < num_segments; i++) {
+      conveyor_seg_inst[i].out(conveyor_seg_stfifo_inst[i]);
+      control_system_inst.seg_in_port[i](conveyor_seg_stfifo_inst[i]);
+
+      control_system_inst.seg_out_port[i](conveyor_seg_ctlfifo_inst[i]);
+      conveyor_seg_inst[i].in(conveyor_seg_ctlfifo_inst[i]);
+    }
+  }
+
+  /**
+   * @brief total number of times the conveyor threads resumed
+   *
+   */
+  long get_conveyor_wakeups() const {
+    long total = 0;
+    for (size_t i = 0; i < conveyor_seg_inst.size(); i++) total += conveyor_seg_inst[i].get_wakeup_count();
+    return total;
+  }
+
+  /**
+   * @brief write the modules and the fifo contents to a checkpoint, sc_start() must have returned
+   *
+   * @return false when the control system is not at a point it can resume from
+   */
+  bool save(checkpoint_writer &ckpt) const {
+    baggage_scanner_inst.save(ckpt);
+    for (size_t i = 0; i < conveyor_seg_inst.size(); i++) conveyor_seg_inst[i].save(ckpt);
+    if (!control_system_inst.save(ckpt)) return false;
+
+    save_fifo<scanner_sts_packet>(ckpt, baggage_stfifo_inst);
+    save_fifo<control_packet>(ckpt, baggage_ctlfifo_inst);
+    for (size_t i = 0; i < conveyor_seg_inst.size(); i++) {
+      save_fifo<conveyor_sts_packet>(ckpt, conveyor_seg_stfifo_inst[i]);
+      save_fifo<control_packet>(ckpt, conveyor_seg_ctlfifo_inst[i]);
+    }
+    return ckpt.ok();
+  }
+
+  /**
+   * @brief read the state written by save(), after elaboration and before sc_start()
+   *
+   * @param checkpoint_time simulated time of the checkpoint
+   */
+  bool restore(checkpoint_reader &ckpt, const sc_time &checkpoint_time) {
+    baggage_scanner_inst.restore(ckpt, checkpoint_time);
+    for (size_t i = 0; i < conveyor_seg_inst.size(); i++) conveyor_seg_inst[i].restore(ckpt, checkpoint_time);
+    control_system_inst.restore(ckpt, checkpoint_time);
+
+    // the writes are seen in the first delta cycle of sc_start()
+    restore_fifo<scanner_sts_packet>(ckpt, baggage_stfifo_inst);
+    restore_fifo<control_packet>(ckpt, baggage_ctlfifo_inst);
+    for (size_t i = 0; i < conveyor_seg_inst.size(); i++) {
+      restore_fifo<conveyor_sts_packet>(ckpt, conveyor_seg_stfifo_inst[i]);
+      restore_fifo<control_packet>(ckpt, conveyor_seg_ctlfifo_inst[i]);
+    }
+    return ckpt.ok();
+  }
+};
+
+/**
+ * @brief fill a checkpoint header with the run configuration
+ *
+ */
+static void make_checkpoint_header(checkpoint_header &header, int seed, int num_segments, int control_mode,
+                                   int process_style, int quantum_ms, int report_every, int delivery_mm) {
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC));
+  header.version            = CHECKPOINT_VERSION;
+  header.seed               = seed;
+  header.sim_time           = sc_time_stamp().value();
+  header.time_resolution_fs = (uint64_t)(sc_get_time_resolution().to_seconds() * 1e15 + 0.5);
+  header.num_segments       = num_segments;
+  header.control_mode       = control_mode;
+  header.process_style      = process_style;
+  header.quantum_ms         = quantum_ms;
+  header.report_every       = report_every;
+  header.delivery_mm        = delivery_mm;
+}
 
-    control_system_inst.seg0_out(conveyor_seg_ctlfifo_inst0);
-    conveyor_seg_inst0.in(conveyor_seg_ctlfifo_inst0);
+/**
+ * @brief save the model at the current simulated time
+ *
+ */
+template <typename Config>
+static bool save_checkpoint(const top<Config> &top_inst, const char *path, const checkpoint_header &header,
+                            const conveyor_params &params) {
+  checkpoint_writer ckpt;
+
+  if (!ckpt.open(path)) {
+    perror(path);
+    return false;
   }
+  ckpt.put(header);
+  ckpt.put(params);
+  if (!top_inst.save(ckpt)) {
+    ckpt.close();
+    fprintf(stderr, "%s: control system not in its wait at %s, no checkpoint written\n", path,
+            sc_time_stamp().to_string().c_str());
+    remove(path);
+    return false;
+  }
+  return ckpt.close();
+}
+
+/**
+ * @brief check a checkpoint was taken with the same model configuration, the seed may differ
+ *
+ */
+static bool check_checkpoint_header(const checkpoint_header &saved, const checkpoint_header &current,
+                                    const char *path) {
+  if ((0 != memcmp(saved.magic, CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC))) ||
+      (CHECKPOINT_VERSION != saved.version)) {
+    fprintf(stderr, "%s: not a version %d conveyor checkpoint\n", path, CHECKPOINT_VERSION);
+    return false;
+  }
+  if ((saved.time_resolution_fs != current.time_resolution_fs) ||
+      (saved.num_segments != current.num_segments) || (saved.control_mode != current.control_mode) ||
+      (saved.process_style != current.process_style) || (saved.quantum_ms != current.quantum_ms) ||
+      (saved.report_every != current.report_every) || (saved.delivery_mm != current.delivery_mm)) {
+    fprintf(stderr,
+            "%s: saved with segments=%d mode=%d process_style=%d quantum_ms=%d report_every=%d "
+            "delivery_mm=%d resolution_fs=%llu, run has segments=%d mode=%d process_style=%d quantum_ms=%d "
+            "report_every=%d delivery_mm=%d resolution_fs=%llu\n",
+            path, saved.num_segments, saved.control_mode, saved.process_style, saved.quantum_ms,
+            saved.report_every, saved.delivery_mm, (unsigned long long)saved.time_resolution_fs,
+            current.num_segments, current.control_mode, current.process_style, current.quantum_ms,
+            current.report_every, current.delivery_mm, (unsigned long long)current.time_resolution_fs);
+    return false;
+  }
+  return true;
+}
+
+/**
+ * @brief set one line parameter from a name=value argument
+ *
+ * @return false when the name is unknown, the value is missing or an integer field gets a value
+ * that is not a whole number of the int range
+ */
+static bool set_param(conveyor_params &params, const char *arg) {
+  char   name[64];
+  double value;
+  bool   whole;
+
+  if (2 != sscanf(arg, "%63[^=]=%lf", name, &value)) return false;
+
+  // the range is checked by check_conveyor_params(), the cast must not wrap before it
+  whole = (value >= std::numeric_limits<int>::min()) && (value <= std::numeric_limits<int>::max()) &&
+          ((double)(int)value == value);
+  if (!whole && (0 != strcmp(name, "speed_mps")) && (0 != strcmp(name, "dist_per_count_m"))) return false;
+
+  if (0 == strcmp(name, "scanner_delay_variance_s")) {
+    params.scanner_delay_variance_s = (int)value;
+  } else if (0 == strcmp(name, "max_bags")) {
+    params.max_bags = (int)value;
+  } else if (0 == strcmp(name, "bag_hysteresis")) {
+    params.bag_hysteresis = (int)value;
+  } else if (0 == strcmp(name, "report_rate_ms")) {
+    params.report_rate_ms = (int)value;
+  } else if (0 == strcmp(name, "speed_mps")) {
+    params.speed_mps = value;
+  } else if (0 == strcmp(name, "dist_per_count_m")) {
+    params.dist_per_count_m = value;
+  } else if (0 == strcmp(name, "temperature_mean")) {
+    params.temperature_mean = (int)value;
+  } else if (0 == strcmp(name, "temperature_variance")) {
+    params.temperature_variance = (int)value;
+  } else if (0 == strcmp(name, "vibration_mean")) {
+    params.vibration_mean = (int)value;
+  } else if (0 == strcmp(name, "vibration_variance")) {
+    params.vibration_variance = (int)value;
+  } else if (0 == strcmp(name, "control_rate_us")) {
+    params.control_rate_us = (int)value;
+  } else if (0 == strcmp(name, "fifo_depth")) {
+    params.fifo_depth = (int)value;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+/**
+ * @brief command line options of a run
+ *
+ */
+struct run_options {
+  int         seed;
+  int         control_system_loop_count;
+  int         control_mode;
+  int         num_segments;
+  int         quantum_ms;
+  int         process_style;
+  int         report_every;
+  int         cosim_sync_us;
+  int         delivery_mm;
+  const char *telemetry_path;
+  int         checkpoint_ms;
+  const char *checkpoint_path;
+  const char *restore_path;
 };
 
+/**
+ * @brief build the model on a configuration policy, run it and print the statistics
+ *
+ * @return exit status of the program
+ */
+template <typename Config>
+static int run_model(const run_options &opt, const Config &config) {
+  telemetry_recorder telemetry;
+  checkpoint_reader  restore_ckpt;
+  checkpoint_header  header, saved_header;
+  conveyor_params    saved_params;
+
+  struct rusage                         usage;
+  std::chrono::steady_clock::time_point wall_start;
+  std::chrono::duration<double>         wall_time;
+
+  // instantiation of top
+  top<Config> top_inst("top_inst", opt.seed, opt.control_system_loop_count, opt.num_segments,
+                       opt.control_mode, opt.quantum_ms, opt.process_style, opt.report_every, config);
+
+  // joined by the control loop before sc_stop(), outlives the kernel; its rings are too large for the stack
+  std::unique_ptr<cosim_controller> cosim;
+  if (CONTROL_MODE_COSIM == opt.control_mode) {
+    cosim.reset(new cosim_controller(config.max_bags(), config.bag_hysteresis()));
+    top_inst.control_system_inst.set_cosim(cosim.get(), opt.cosim_sync_us);
+  }
+  top_inst.control_system_inst.set_delivery_distance(opt.delivery_mm / 1000.0);
+
+  if (nullptr != opt.telemetry_path) {
+    // timestamps are recorded in time resolution ticks
+    if (!telemetry.open(opt.telemetry_path, (uint64_t)(sc_get_time_resolution().to_seconds() * 1e15 + 0.5))) {
+      perror(opt.telemetry_path);
+      return 1;
+    }
+    top_inst.control_system_inst.set_telemetry(&telemetry);
+  }
+
+  // enough packets for the fifos and the bags in the system, no heap allocations once running
+  packet_pool<scanner_sts_packet>::instance().reserve(config.max_bags() + config.fifo_depth());
+  packet_pool<conveyor_sts_packet>::instance().reserve(opt.num_segments * config.fifo_depth());
+  packet_pool<control_packet>::instance().reserve((opt.num_segments + 1) * config.fifo_depth());
+
+  if (nullptr != opt.restore_path) {
+    if (!restore_ckpt.open(opt.restore_path)) {
+      perror(opt.restore_path);
+      return 1;
+    }
+    make_checkpoint_header(header, opt.seed, opt.num_segments, opt.control_mode, opt.process_style,
+                           opt.quantum_ms, opt.report_every, opt.delivery_mm);
+    restore_ckpt.get(saved_header);
+    if (!restore_ckpt.ok() || !check_checkpoint_header(saved_header, header, opt.restore_path)) return 1;
+    restore_ckpt.get(saved_params);
+    if (!restore_ckpt.ok() || (0 != memcmp(&saved_params, &config.params(), sizeof(saved_params)))) {
+      fprintf(stderr, "%s: saved with other line parameters (--param)\n", opt.restore_path);
+      return 1;
+    }
+
+    // the random streams continue from the saved counters, a different seed forks the run at the checkpoint
+    if (saved_header.seed != opt.seed) {
+      printf("restore: checkpoint seed %d, run seed %d\n", saved_header.seed, opt.seed);
+    }
+
+    if (!top_inst.restore(restore_ckpt, sc_time::from_value(saved_header.sim_time))) {
+      fprintf(stderr, "%s: truncated or corrupt checkpoint\n", opt.restore_path);
+      return 1;
+    }
+    restore_ckpt.close();
+    printf("restore: resuming at %s\n", sc_time::from_value(saved_header.sim_time).to_string().c_str());
+  }
+
+  wall_start = std::chrono::steady_clock::now();
+  if (nullptr != opt.checkpoint_path) {
+    sc_start(sc_time(opt.checkpoint_ms, SC_MS));
+    sim_log::instance().flush();
+    if (sc_time_stamp() < sc_time(opt.checkpoint_ms, SC_MS)) {
+      printf("checkpoint: run ended at %s, before %d ms\n", sc_time_stamp().to_string().c_str(),
+             opt.checkpoint_ms);
+    } else {
+      make_checkpoint_header(header, opt.seed, opt.num_segments, opt.control_mode, opt.process_style,
+                             opt.quantum_ms, opt.report_every, opt.delivery_mm);
+      if (!save_checkpoint(top_inst, opt.checkpoint_path, header, config.params())) return 1;
+      printf("checkpoint: %s written at %s\n", opt.checkpoint_path, sc_time_stamp().to_string().c_str());
+    }
+  }
+  if (SC_STOPPED != sc_get_status()) sc_start(); // burn simulation time
+  wall_time = std::chrono::steady_clock::now() - wall_start;
+
+  sim_log::instance().flush();
+  PROFILE_REPORT("conveyor_profile");
+  FIFO_MONITOR_REPORT("conveyor_fifos");
+
+  if (telemetry.is_open()) {
+    telemetry.close();
+    printf("\ntelemetry: %llu rows written to %s, %llu recorder stalls\n",
+           (unsigned long long)telemetry.get_rows_written(), opt.telemetry_path,
+           (unsigned long long)telemetry.get_stalls());
+  }
+
+  if (0 != sim_log::instance().get_records()) {
+    printf("\nlog: %llu records, %llu waits for room in the ring\n",
+           (unsigned long long)sim_log::instance().get_records(),
+           (unsigned long long)sim_log::instance().get_full_waits());
+  }
+
+  printf("\n");
+  packet_pool<scanner_sts_packet>::instance().print_stats("scanner_sts_packet");
+  packet_pool<conveyor_sts_packet>::instance().print_stats("conveyor_sts_packet");
+  packet_pool<control_packet>::instance().print_stats("control_packet");
+
+  // one line, key=value summary of the run for the benchmark and sweep tools
+  getrusage(RUSAGE_SELF, &usage);
+  printf("\nsummary: segments=%d sim_time_s=%f wall_time_s=%f max_rss_kb=%ld seed=%d bags_scanned=%ld "
+         "scanner_toggles=%ld max_bag_count=%d quantum_ms=%d conveyor_wakeups=%ld process_style=%d "
+         "health_alarms=%ld report_every=%d bags_delivered=%ld\n",
+         opt.num_segments, sc_time_stamp().to_seconds(), wall_time.count(), usage.ru_maxrss, opt.seed,
+         top_inst.control_system_inst.get_bags_scanned(), top_inst.control_system_inst.get_scanner_toggles(),
+         top_inst.control_system_inst.get_max_bag_count(), opt.quantum_ms, top_inst.get_conveyor_wakeups(),
+         opt.process_style, top_inst.control_system_inst.get_health_alarms(), opt.report_every,
+         top_inst.control_system_inst.get_bags_delivered());
+  return 0;
+}
+
 int sc_main(int argc, char *argv[]) {
-  int seed                      = 5;
-  int control_system_loop_count = 5000000;
+  run_options     opt            = {};
+  conveyor_params params         = default_conveyor_params;
+  bool            runtime_config = false;
+  int             positional     = 0;
+  double          deliver_m      = BAG_DELIVERY_DISTANCE_M;
+  const char     *param_error;
+
+  std::vector<const char *> log_levels;
+
+  opt.seed                      = 5;
+  opt.control_system_loop_count = 5000000;
+  opt.control_mode              = CONTROL_MODE_POLLING;
+  opt.num_segments              = NUM_CONVEYOR_SEGMENTS;
+  opt.quantum_ms                = CONVEYOR_QUANTUM_MS;
+  opt.process_style             = PROCESS_STYLE_THREAD;
+  opt.report_every              = CONVEYOR_REPORT_EVERY;
 
   // -----------------------------------
   // input validation
   // -----------------------------------
-  if (argc > 1) seed = atoi(argv[1]);
+  for (int i = 1; i < argc; ++i) {
+    if (0 == strcmp(argv[i], "--event")) {
+      opt.control_mode = CONTROL_MODE_EVENT;
+    } else if ((0 == strcmp(argv[i], "--cosim")) && (i + 1 < argc)) {
+      opt.control_mode  = CONTROL_MODE_COSIM;
+      opt.cosim_sync_us = atoi(argv[++i]);
+    } else if ((0 == strcmp(argv[i], "--deliver")) && (i + 1 < argc)) {
+      deliver_m = atof(argv[++i]);
+    } else if ((0 == strcmp(argv[i], "--segments")) && (i + 1 < argc)) {
+      opt.num_segments = atoi(argv[++i]);
+    } else if (0 == strcmp(argv[i], "--method")) {
+      opt.process_style = PROCESS_STYLE_METHOD;
+    } else if ((0 == strcmp(argv[i], "--quantum")) && (i + 1 < argc)) {
+      opt.quantum_ms = atoi(argv[++i]);
+    } else if ((0 == strcmp(argv[i], "--report-every")) && (i + 1 < argc)) {
+      opt.report_every = atoi(argv[++i]);
+    } else if ((0 == strcmp(argv[i], "-v")) && (i + 1 < argc)) {
+      verbosity = atoi(argv[++i]);
+    } else if ((0 == strcmp(argv[i], "--log")) && (i + 1 < argc)) {
+      log_levels.push_back(argv[++i]);
+    } else if ((0 == strcmp(argv[i], "--telemetry")) && (i + 1 < argc)) {
+      opt.telemetry_path = argv[++i];
+    } else if ((0 == strcmp(argv[i], "--checkpoint")) && (i + 2 < argc)) {
+      opt.checkpoint_ms   = atoi(argv[++i]);
+      opt.checkpoint_path = argv[++i];
+    } else if ((0 == strcmp(argv[i], "--restore")) && (i + 1 < argc)) {
+      opt.restore_path = argv[++i];
+    } else if (0 == strcmp(argv[i], "--runtime-config")) {
+      runtime_config = true;
+    } else if ((0 == strcmp(argv[i], "--param")) && (i + 1 < argc)) {
+      if (!set_param(params, argv[++i])) {
+        fprintf(stderr, "--param %s: unknown parameter or value, see conveyor_params\n", argv[i]);
+        return 1;
+      }
+      runtime_config = true;
+    } else if (0 == positional++) {
+      opt.seed = atoi(argv[i]);
+    } else {
+      opt.control_system_loop_count = atoi(argv[i]);
+    }
+  }
 
-  if (argc > 2) control_system_loop_count = atoi(argv[2]);
+  if (opt.num_segments < 1) opt.num_segments = 1;
+  if (opt.quantum_ms < 0) opt.quantum_ms = 0;
+  if (opt.report_every < 0) opt.report_every = 0;
+  if (opt.cosim_sync_us < 0) opt.cosim_sync_us = 0;
+  if (deliver_m < 0.0) deliver_m = 0.0;
+  opt.delivery_mm = (int)(deliver_m * 1000.0 + 0.5);
+
+  // -v sets the level of every module, --log the level of the modules under a name prefix
+  sim_log::instance().set_default_level(std::min(SIM_LOG_WARN + std::max(verbosity, 0), SIM_LOG_TRACE));
+  for (const char *level : log_levels) {
+    if (!sim_log::instance().set_level(level)) {
+      fprintf(stderr, "--log %s: expected prefix=level, level error warn info debug trace or off\n", level);
+      return 1;
+    }
+  }
 
-  std::srand(seed);
-  // std::srand(time(0) ^ getpid()); // FIXME seed, command line arg
+  // the compile time configuration is checked by static_conveyor_config
+  param_error = check_conveyor_params(params);
+  if (nullptr != param_error) {
+    fprintf(stderr, "--param: %s\n", param_error);
+    return 1;
+  }
 
-  printf("Command line arguments:\n");
-  printf("  seed       = %d\n", seed);
-  printf("  loop count = %d\n", control_system_loop_count);
+  // the bags are counted by the controller thread, which does not deliver them
+  if ((0 != opt.delivery_mm) && (CONTROL_MODE_COSIM == opt.control_mode)) {
+    fprintf(stderr, "--deliver does not support --cosim\n");
+    return 1;
+  }
 
-  // printf("FYI: encoder count inc=%f\n", ENCODER_COUNT_INCREMENT);
+#if PACKET_TRANSPORT_PACKED
+  if (opt.num_segments > WIRE_MAX_SEGMENTS) {
+    fprintf(stderr, "at most %d segments with the packed transport\n", (int)WIRE_MAX_SEGMENTS);
+    return 1;
+  }
+#endif
 
-  // instantiation of top
-  top top_inst("top_inst", control_system_loop_count);
+  // the bags are delivered at the status packets of the first segment, which reports nothing while running
+  if ((0 != opt.delivery_mm) && (0 == opt.report_every)) {
+    fprintf(stderr, "--deliver needs --report-every 1 or more\n");
+    return 1;
+  }
 
-  sc_start(); // burn simulation time
-  return 0;
-}
\ No newline at end of file
+  // the decoupled conveyors already send a quantum of reports per wakeup
+  if ((1 != opt.report_every) && (0 != opt.quantum_ms)) {
+    fprintf(stderr, "--report-every needs --quantum 0\n");
+    return 1;
+  }
+
+  // threads keep their state on their stacks, only the method processes can be saved
+  if (((nullptr != opt.checkpoint_path) || (nullptr != opt.restore_path)) &&
+      (PROCESS_STYLE_METHOD != opt.process_style)) {
+    fprintf(stderr, "--checkpoint and --restore need --method\n");
+    return 1;
+  }
+
+  // the controller thread state is not part of the checkpoint
+  if (((nullptr != opt.checkpoint_path) || (nullptr != opt.restore_path)) &&
+      (CONTROL_MODE_COSIM == opt.control_mode)) {
+    fprintf(stderr, "--checkpoint and --restore do not support --cosim\n");
+    return 1;
+  }
+
+  printf("Command line arguments:\n");
+  printf("  seed       = %d\n", opt.seed);
+  printf("  loop count = %d\n", opt.control_system_loop_count);
+  printf("  mode       = %s\n", control_mode_name(opt.control_mode));
+  if (CONTROL_MODE_COSIM == opt.control_mode) printf("  sync       = %d us\n", opt.cosim_sync_us);
+  if (0 != opt.delivery_mm) printf("  delivery   = %.3f m\n", opt.delivery_mm / 1000.0);
+  printf("  segments   = %d\n", opt.num_segments);
+  printf("  quantum    = %d ms\n", opt.quantum_ms);
+  printf("  reports    = every %d tick(s)%s\n", opt.report_every,
+         (0 == opt.report_every) ? ", state changes only" : "");
+  printf("  process    = %s\n", (PROCESS_STYLE_METHOD == opt.process_style) ? "method" : "thread");
+  printf("  config     = %s, %d counts per report\n", runtime_config ? "runtime" : "compile time",
+         encoder_count_increment(params));
+  printf("  verbosity  = %d\n", verbosity);
+  for (const char *level : log_levels) printf("  log        = %s\n", level);
+  if (nullptr != opt.telemetry_path) printf("  telemetry  = %s\n", opt.telemetry_path);
+  if (nullptr != opt.checkpoint_path) {
+    printf("  checkpoint = %s at %d ms\n", opt.checkpoint_path, opt.checkpoint_ms);
+  }
+  if (nullptr != opt.restore_path) printf("  restore    = %s\n", opt.restore_path);
+
+  if (runtime_config) return run_model(opt, runtime_conveyor_config(params));
+  return run_model(opt, default_conveyor_config());
+}
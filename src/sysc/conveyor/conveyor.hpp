@@ -34,6 +34,7 @@
 #define CONVEYOR_HPP_
 
 // Includes
+#include "process_style.hpp"
 #include <systemc.h>
 
 #define INSTANCE_NAME_STRING_LEN 256
@@ -45,18 +46,18 @@
 
 #define MAX_NUMBER_BAGS_IN_SYSTEM 16
 #define BAG_COUNT_HYSTERESIS      4
+#define BAG_DELIVERY_DISTANCE_M   0.0 // default, see --deliver; 0 is off, every bag stays in the system
 
 // -----------------------------
 // conveyor segment constants
 // -----------------------------
-#define NUM_CONVEYOR_SEGMENTS 1
+#define NUM_CONVEYOR_SEGMENTS   1   // default, see --segments
+#define CONVEYOR_SEGMENT_BASE_ID 100 // ID of the first segment
 
 #define CONVEYOR_REPORT_RATE_MS 10      // 10 ms
 #define DESIRED_CONVEYOR_SPEED  0.5     // m/s (meters per sec)
 #define DIST_PER_ENCODER_COUNT  0.00001 // m (0.01 mm per count)
-#define ENCODER_COUNT_INCREMENT \
-  (DESIRED_CONVEYOR_SPEED * CONVEYOR_REPORT_RATE_MS * 0.001) / DIST_PER_ENCODER_COUNT
-// (0.5 * 10 * 0.001) / 0.00001 = 500 (5mm per 10ms)
+// encoder counts per report: encoder_count_increment() in conveyor_config.hpp
 
 #define TEMPERATURE_MEAN     45 // degrees C
 #define TEMPERATURE_VARIANCE 4
@@ -64,15 +65,54 @@
 #define VIBRATION_MEAN     12 // in mils
 #define VIBRATION_VARIANCE 10
 
+#define CONVEYOR_SAMPLE_BATCH 64 // temperature/vibration samples drawn at once
+
+#define CONVEYOR_QUANTUM_MS 0 // default, see --quantum; 0 wakes on every report
+
+#define CONVEYOR_REPORT_EVERY 1 // default, see --report-every; ticks per report, 0 reports state changes only
+
 // -----------------------------
 // control system constants
 // -----------------------------
 #define CONTROL_SYSTEM_RATE_US 1 // 1 us
 
+// control system scheduling modes
+#define CONTROL_MODE_POLLING 0 // wake every CONTROL_SYSTEM_RATE_US and poll the fifos
+#define CONTROL_MODE_EVENT   1 // block on the fifos data_written_event()
+#define CONTROL_MODE_COSIM   2 // forward the fifos to a controller on an OS thread, see cosim_bridge.hpp
+
+// -----------------------------
+// output verbosity levels
+// -----------------------------
+#define VERBOSITY_NONE    0 // end of run statistics only
+#define VERBOSITY_INFO    1 // control packets received by the scanner and the conveyors
+#define VERBOSITY_PACKETS 2 // every conveyor status packet received by the control system
+
 // control packet defines
+#define CONTROL_PKT_MSG_NONE     -1 // no control packet to send
 #define CONTROL_PKT_MSG_TURN_OFF 0
 #define CONTROL_PKT_MSG_TURN_ON  1
 
+// -----------------------------
+// scanner control rules, shared by the Control_System and the co-simulated controller
+// -----------------------------
+
+// control packet for the scanner after a bag was scanned
+inline int scanner_control_after_scan(int scanner_running, int bag_count, int max_bags) {
+  if ((CONTROL_PKT_MSG_TURN_ON == scanner_running) && (bag_count >= max_bags)) {
+    return CONTROL_PKT_MSG_TURN_OFF;
+  }
+  return CONTROL_PKT_MSG_NONE;
+}
+
+// control packet for the scanner after a conveyor status packet
+inline int scanner_control_after_status(int scanner_running, int bag_count, int max_bags, int hysteresis) {
+  if ((CONTROL_PKT_MSG_TURN_OFF == scanner_running) && (bag_count < (max_bags - hysteresis))) {
+    return CONTROL_PKT_MSG_TURN_ON;
+  }
+  return CONTROL_PKT_MSG_NONE;
+}
+
 /**
  * @brief Class scanner_sts_packet
  *
@@ -95,7 +135,7 @@ public:
     timestamp = ts;
   }
 
-  sc_time get_timestamp() {
+  sc_time get_timestamp() const {
     return timestamp;
   }
 
@@ -103,11 +143,11 @@ public:
     this->bag_id = bag_id;
   }
 
-  int get_bag_id() {
+  int get_bag_id() const {
     return bag_id;
   }
 
-  int get_pox_bag() {
+  int get_pox_bag() const {
     return pox_bag;
   }
 
@@ -119,6 +159,10 @@ public:
   }
 };
 
+inline ostream &operator<<(ostream &os, const scanner_sts_packet &pkt) {
+  return os << "scanner_sts_packet(" << pkt.get_timestamp() << ", bag " << pkt.get_bag_id() << ")";
+}
+
 /**
  * @brief Class conveyor_sts_packet
  *
@@ -145,7 +189,7 @@ public:
     timestamp = ts;
   }
 
-  sc_time get_timestamp() {
+  sc_time get_timestamp() const {
     return timestamp;
   }
 
@@ -153,7 +197,7 @@ public:
     my_id = id;
   }
 
-  int get_id() {
+  int get_id() const {
     return my_id;
   }
 
@@ -161,7 +205,7 @@ public:
     current_cnt = cnt;
   }
 
-  unsigned int get_current_cnt() {
+  unsigned int get_current_cnt() const {
     return current_cnt;
   }
 
@@ -169,7 +213,7 @@ public:
     temperature = temp;
   }
 
-  int get_temperature() {
+  int get_temperature() const {
     return temperature;
   }
 
@@ -177,7 +221,7 @@ public:
     vibration = vib;
   }
 
-  int get_vibration() {
+  int get_vibration() const {
     return vibration;
   }
 
@@ -192,6 +236,11 @@ public:
   }
 };
 
+inline ostream &operator<<(ostream &os, const conveyor_sts_packet &pkt) {
+  return os << "conveyor_sts_packet(" << pkt.get_timestamp() << ", segment " << pkt.get_id() << ", count "
+            << pkt.get_current_cnt() << ")";
+}
+
 /**
  * @brief Class control_packet
  *
@@ -215,7 +264,7 @@ public:
     timestamp = ts;
   }
 
-  sc_time get_timestamp() {
+  sc_time get_timestamp() const {
     return timestamp;
   }
 
@@ -223,7 +272,7 @@ public:
     this->msg = msg;
   }
 
-  int get_msg() {
+  int get_msg() const {
     return msg;
   }
 
@@ -231,7 +280,7 @@ public:
     this->data = data;
   }
 
-  int get_data() {
+  int get_data() const {
     return data;
   }
 
@@ -243,4 +292,8 @@ public:
     printf("                      Data        = %d\n", data);
   }
 };
+
+inline ostream &operator<<(ostream &os, const control_packet &pkt) {
+  return os << "control_packet(" << pkt.get_timestamp() << ", msg " << pkt.get_msg() << ")";
+}
 #endif /* CONVEYOR_HPP_ */
\ No newline at end of file
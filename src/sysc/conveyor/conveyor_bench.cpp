@@ -0,0 +1,229 @@
+/*******************************************************************************
+ * Copyright (C) 2023 by Salvador Z                                            *
+ *                                                                             *
+ * This file is part of SYSTEM_MODELS                                          *
+ *                                                                             *
+ *   Permission is hereby granted, free of charge, to any person obtaining a   *
+ *   copy of this software and associated documentation files (the Software)   *
+ *   to deal in the Software without restriction including without limitation  *
+ *   the rights to use, copy, modify, merge, publish, distribute, sublicense,  *
+ *   and/or sell copies ot the Software, and to permit persons to whom the     *
+ *   Software is furnished to do so, subject to the following conditions:      *
+ *                                                                             *
+ *   The above copyright notice and this permission notice shall be included   *
+ *   in all copies or substantial portions of the Software.                    *
+ *                                                                             *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS   *
+ *   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARANTIES OF MERCHANTABILITY *
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL   *
+ *   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR      *
+ *   OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,     *
+ *   ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE        *
+ *   OR OTHER DEALINGS IN THE SOFTWARE.                                        *
+ ******************************************************************************/
+
+
+/**
+ * @file conveyor_bench.cpp
+ * @author Salvador Z
+ * @version 1.0
+ * @brief Benchmark of the conveyor model as the number of segments grows
+ *
+ * Runs the conveyor binary once per segment count (the SystemC kernel can only be
+ * elaborated once per process) and reports the wall time per simulated second and
+ * the memory per segment taken from the summary line of each run. With -q every
+ * segment count is run again with the conveyors decoupled by the given quantum,
+ * and the speedup and wakeup reduction against the timed run are reported.
+ *
+ * -m runs the scanner and the conveyors as SC_METHOD state machines instead of
+ * SC_THREADs, to compare the memory per segment and the wall time of both styles.
+ *
+ * -r runs every segment count again with the lazy encoder and one report every
+ * given number of ticks (0 for state changes only).
+ *
+ * -p runs every segment count again on the runtime configuration policy, same
+ * parameters read from an object instead of folded in at compile time, and
+ * reports the cost of the runtime policy.
+ *
+ * usage: conveyor_bench [-c conveyor_binary] [-t sim_seconds] [-q quantum_ms] [-r ticks] [-m] [-p]
+ *                       [segments ...]
+ */
+
+#include "child_process.hpp"
+#include "process_style.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#define BENCH_DEFAULT_SIM_SECONDS 1
+#define BENCH_US_PER_SEC          1000000
+
+/**
+ * @brief values parsed from the summary line of one conveyor run
+ *
+ */
+struct run_result {
+  int    segments;
+  double sim_time_s;
+  double wall_time_s;
+  long   max_rss_kb;
+  long   conveyor_wakeups;
+};
+
+/**
+ * @brief run the conveyor binary and parse its summary line
+ *
+ * @param binary path to the conveyor executable
+ * @param args command line arguments
+ * @param result parsed summary
+ * @return true when the run finished and printed a summary
+ */
+static bool run_conveyor(const std::string &binary, const std::vector<std::string> &args,
+                         run_result &result) {
+  summary_metrics metrics;
+
+  if (!child_run_summary(binary, args, metrics)) return false;
+  if ((0 == metrics.count("segments")) || (0 == metrics.count("sim_time_s")) ||
+      (0 == metrics.count("wall_time_s")) || (0 == metrics.count("max_rss_kb"))) {
+    return false;
+  }
+
+  result.segments         = (int)metrics["segments"];
+  result.sim_time_s       = metrics["sim_time_s"];
+  result.wall_time_s      = metrics["wall_time_s"];
+  result.max_rss_kb       = (long)metrics["max_rss_kb"];
+  result.conveyor_wakeups = metrics.count("conveyor_wakeups") ? (long)metrics["conveyor_wakeups"] : 0;
+  return true;
+}
+
+int main(int argc, char *argv[]) {
+  std::string             binary;
+  int                     sim_seconds   = BENCH_DEFAULT_SIM_SECONDS;
+  int                     quantum_ms    = 0;
+  int                     report_every  = 1;
+  int                     process_style = PROCESS_STYLE_THREAD;
+  bool                    runtime_cmp   = false;
+  std::vector<int>        segment_counts;
+  std::vector<run_result> results;
+  const char             *slash;
+
+  // the conveyor binary is built next to this one
+  slash  = strrchr(argv[0], '/');
+  binary = slash ? std::string(argv[0], slash - argv[0] + 1) + "conveyor" : "./conveyor";
+
+  for (int i = 1; i < argc; ++i) {
+    if ((0 == strcmp(argv[i], "-c")) && (i + 1 < argc)) {
+      binary = argv[++i];
+    } else if ((0 == strcmp(argv[i], "-t")) && (i + 1 < argc)) {
+      sim_seconds = atoi(argv[++i]);
+    } else if (0 == strcmp(argv[i], "-m")) {
+      process_style = PROCESS_STYLE_METHOD;
+    } else if ((0 == strcmp(argv[i], "-q")) && (i + 1 < argc)) {
+      quantum_ms = atoi(argv[++i]);
+    } else if ((0 == strcmp(argv[i], "-r")) && (i + 1 < argc)) {
+      report_every = atoi(argv[++i]);
+    } else if (0 == strcmp(argv[i], "-p")) {
+      runtime_cmp = true;
+    } else {
+      segment_counts.push_back(atoi(argv[i]));
+    }
+  }
+
+  if (segment_counts.empty()) segment_counts = {1, 10, 100, 1000, 10000};
+  if (sim_seconds < 1) sim_seconds = 1;
+
+  printf("conveyor_bench: %s, %d simulated second(s) per run, event driven control system, %s processes, "
+         "no text output\n\n",
+         binary.c_str(), sim_seconds, (PROCESS_STYLE_METHOD == process_style) ? "SC_METHOD" : "SC_THREAD");
+  printf("%10s %12s %12s %12s %16s %14s %14s %14s\n", "segments", "quantum [ms]", "sim [s]", "wall [s]",
+         "wall/sim [s/s]", "max rss [KB]", "KB/segment", "wakeups");
+
+  for (int segments : segment_counts) {
+    run_result result;
+    double     kb_per_segment = 0.0;
+
+    std::vector<std::string> args = {"5", std::to_string(sim_seconds * BENCH_US_PER_SEC), "--event", "-v",
+                                     "0", "--segments", std::to_string(segments)};
+
+    if (PROCESS_STYLE_METHOD == process_style) args.push_back("--method");
+
+    if (!run_conveyor(binary, args, result)) {
+      printf("%10d %12d %12s\n", segments, 0, "failed");
+      continue;
+    }
+
+    // memory per segment relative to the smallest run, so the fixed cost of the kernel is left out
+    if (!results.empty() && (result.segments > results.front().segments)) {
+      kb_per_segment = (double)(result.max_rss_kb - results.front().max_rss_kb) /
+                       (result.segments - results.front().segments);
+    }
+    results.push_back(result);
+
+    printf("%10d %12d %12.3f %12.3f %16.4f %14ld %14.2f %14ld\n", result.segments, 0, result.sim_time_s,
+           result.wall_time_s, result.wall_time_s / result.sim_time_s, result.max_rss_kb, kb_per_segment,
+           result.conveyor_wakeups);
+    fflush(stdout);
+
+    if (1 != report_every) {
+      // same run with the lazy encoder
+      run_result               lazy;
+      std::vector<std::string> lazy_args = args;
+
+      lazy_args.push_back("--report-every");
+      lazy_args.push_back(std::to_string(report_every));
+
+      if (!run_conveyor(binary, lazy_args, lazy)) {
+        printf("%10d %12s %12s\n", segments, "lazy", "failed");
+      } else {
+        printf("%10d %12s %12.3f %12.3f %16.4f %14ld %14s %14ld   speedup %.2fx, wakeups /%.1f\n",
+               lazy.segments, "lazy", lazy.sim_time_s, lazy.wall_time_s, lazy.wall_time_s / lazy.sim_time_s,
+               lazy.max_rss_kb, "", lazy.conveyor_wakeups,
+               (result.wall_time_s / result.sim_time_s) / (lazy.wall_time_s / lazy.sim_time_s),
+               lazy.conveyor_wakeups ? (double)result.conveyor_wakeups / lazy.conveyor_wakeups : 0.0);
+      }
+      fflush(stdout);
+    }
+
+    if (runtime_cmp) {
+      // same run on runtime_conveyor_config
+      run_result               runtime;
+      std::vector<std::string> runtime_args = args;
+
+      runtime_args.push_back("--runtime-config");
+
+      if (!run_conveyor(binary, runtime_args, runtime)) {
+        printf("%10d %12s %12s\n", segments, "runtime", "failed");
+      } else {
+        printf("%10d %12s %12.3f %12.3f %16.4f %14ld %14s %14ld   compile time policy speedup %.2fx\n",
+               runtime.segments, "runtime", runtime.sim_time_s, runtime.wall_time_s,
+               runtime.wall_time_s / runtime.sim_time_s, runtime.max_rss_kb, "", runtime.conveyor_wakeups,
+               (runtime.wall_time_s / runtime.sim_time_s) / (result.wall_time_s / result.sim_time_s));
+      }
+      fflush(stdout);
+    }
+
+    if (quantum_ms <= 0) continue;
+
+    // same run with the conveyors decoupled
+    run_result decoupled;
+
+    args.push_back("--quantum");
+    args.push_back(std::to_string(quantum_ms));
+
+    if (!run_conveyor(binary, args, decoupled)) {
+      printf("%10d %12d %12s\n", segments, quantum_ms, "failed");
+      continue;
+    }
+
+    printf("%10d %12d %12.3f %12.3f %16.4f %14ld %14s %14ld   speedup %.2fx, wakeups /%.1f\n",
+           decoupled.segments, quantum_ms, decoupled.sim_time_s, decoupled.wall_time_s,
+           decoupled.wall_time_s / decoupled.sim_time_s, decoupled.max_rss_kb, "", decoupled.conveyor_wakeups,
+           (result.wall_time_s / result.sim_time_s) / (decoupled.wall_time_s / decoupled.sim_time_s),
+           decoupled.conveyor_wakeups ? (double)result.conveyor_wakeups / decoupled.conveyor_wakeups : 0.0);
+    fflush(stdout);
+  }
+
+  return 0;
+}
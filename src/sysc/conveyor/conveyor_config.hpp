@@ -0,0 +1,189 @@
+/*******************************************************************************
+ * Copyright (C) 2023 by Salvador Z                                            *
+ *                                                                             *
+ * This file is part of SYSTEM_MODELS                                          *
+ *                                                                             *
+ *   Permission is hereby granted, free of charge, to any person obtaining a   *
+ *   copy of this software and associated documentation files (the Software)   *
+ *   to deal in the Software without restriction including without limitation  *
+ *   the rights to use, copy, modify, merge, publish, distribute, sublicense,  *
+ *   and/or sell copies ot the Software, and to permit persons to whom the     *
+ *   Software is furnished to do so, subject to the following conditions:      *
+ *                                                                             *
+ *   The above copyright notice and this permission notice shall be included   *
+ *   in all copies or substantial portions of the Software.                    *
+ *                                                                             *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS   *
+ *   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARANTIES OF MERCHANTABILITY *
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL   *
+ *   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR      *
+ *   OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,     *
+ *   ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE        *
+ *   OR OTHER DEALINGS IN THE SOFTWARE.                                        *
+ ******************************************************************************/
+
+
+/**
+ * @file conveyor_config.hpp
+ * @author Salvador Z
+ * @version 1.0
+ * @brief File for the configuration policies of the scanner, conveyor and control system
+ *
+ * The modules are templates on a configuration policy, a type with one accessor per
+ * parameter. static_conveyor_config returns constexpr values, checked when the type
+ * is used and folded into the modules; runtime_conveyor_config returns the values of
+ * an object, for sweeps that change them without rebuilding.
+ */
+
+#ifndef CONVEYOR_CONFIG_HPP_
+#define CONVEYOR_CONFIG_HPP_
+
+// Includes
+#include "conveyor.hpp"
+#include <cstdint>
+#include <limits>
+
+#define CONVEYOR_FIFO_DEPTH 16 // packets in every fifo of the model
+
+/**
+ * @brief parameters of one conveyor line
+ *
+ */
+struct conveyor_params {
+  int    scanner_delay_variance_s; // scanner reports every 1 to n s
+  int    max_bags;                 // bags in the system that turn the scanner off
+  int    bag_hysteresis;           // bags under max_bags that turn it back on
+  int    report_rate_ms;           // conveyor status report period
+  double speed_mps;                // belt speed, m/s
+  double dist_per_count_m;         // belt travel per encoder count, m
+  int    temperature_mean;         // degrees C
+  int    temperature_variance;
+  int    vibration_mean; // mils
+  int    vibration_variance;
+  int    control_rate_us; // polling period of the control system
+  int    fifo_depth;
+};
+
+// the macros of conveyor.hpp
+constexpr conveyor_params default_conveyor_params = {
+    BARCODE_SCANNER_REPORT_RATE_VARIANCE_SECS,
+    MAX_NUMBER_BAGS_IN_SYSTEM,
+    BAG_COUNT_HYSTERESIS,
+    CONVEYOR_REPORT_RATE_MS,
+    DESIRED_CONVEYOR_SPEED,
+    DIST_PER_ENCODER_COUNT,
+    TEMPERATURE_MEAN,
+    TEMPERATURE_VARIANCE,
+    VIBRATION_MEAN,
+    VIBRATION_VARIANCE,
+    CONTROL_SYSTEM_RATE_US,
+    CONVEYOR_FIFO_DEPTH,
+};
+
+/**
+ * @brief encoder counts per report, rounded since the ratio of two decimal doubles is not exact
+ * (0.5 * 10 * 0.001) / 0.00001 = 499.99999999999994, 500 counts (5 mm per 10 ms)
+ *
+ */
+constexpr double encoder_counts_per_report(const conveyor_params &p) {
+  return p.speed_mps * p.report_rate_ms * 0.001 / p.dist_per_count_m;
+}
+
+constexpr int encoder_count_increment(const conveyor_params &p) {
+  return (int)(encoder_counts_per_report(p) + 0.5);
+}
+
+/**
+ * @brief check the parameters
+ *
+ * @return nullptr when they are usable, else what is wrong with them
+ */
+constexpr const char *check_conveyor_params(const conveyor_params &p) {
+  double error = 0.0;
+
+  if (p.scanner_delay_variance_s < 1) return "scanner_delay_variance_s must be at least 1";
+  if ((p.max_bags < 1) || (p.bag_hysteresis < 0) || (p.bag_hysteresis >= p.max_bags)) {
+    return "bag_hysteresis must be in [0, max_bags)";
+  }
+  if ((p.report_rate_ms < 1) || (p.control_rate_us < 1)) return "the report and control rates must be > 0";
+  if ((p.speed_mps <= 0.0) || (p.dist_per_count_m <= 0.0)) return "the speed and count length must be > 0";
+  if (encoder_counts_per_report(p) >= 2147483647.0) return "too many encoder counts per report";
+  if (encoder_count_increment(p) < 1) return "the belt must move at least one encoder count per report";
+
+  // the encoder moves whole counts, a fraction would be lost on every report
+  error = encoder_counts_per_report(p) - encoder_count_increment(p);
+  if ((error > 1e-6) || (error < -1e-6)) return "the belt must move whole encoder counts per report";
+
+  // the samples are mean +/- (random % (variance / 2))
+  if ((p.temperature_variance < 2) || (p.vibration_variance < 2)) return "the variances must be at least 2";
+
+  // the samples fit the packed fields of wire_format.hpp, same bounds as its static_asserts
+  if ((p.temperature_mean - p.temperature_variance / 2 < std::numeric_limits<int8_t>::min()) ||
+      (p.temperature_mean + p.temperature_variance / 2 > std::numeric_limits<int8_t>::max())) {
+    return "temperature_mean +/- temperature_variance / 2 must fit in [-128, 127]";
+  }
+  if ((p.vibration_mean - p.vibration_variance / 2 < 0) ||
+      (p.vibration_mean + p.vibration_variance / 2 > std::numeric_limits<uint8_t>::max())) {
+    return "vibration_mean +/- vibration_variance / 2 must fit in [0, 255]";
+  }
+  if (p.fifo_depth < 1) return "fifo_depth must be at least 1";
+  return nullptr;
+}
+
+/**
+ * @brief Class static_conveyor_config
+ * Compile time policy, P is a constexpr conveyor_params. Invalid parameters do not compile.
+ */
+template <const conveyor_params &P>
+struct static_conveyor_config {
+  static_assert(nullptr == check_conveyor_params(P), "invalid conveyor_params, see check_conveyor_params()");
+
+  static constexpr const conveyor_params &params() { return P; }
+
+  static constexpr int    scanner_delay_variance_s() { return P.scanner_delay_variance_s; }
+  static constexpr int    max_bags() { return P.max_bags; }
+  static constexpr int    bag_hysteresis() { return P.bag_hysteresis; }
+  static constexpr int    report_rate_ms() { return P.report_rate_ms; }
+  static constexpr double dist_per_count_m() { return P.dist_per_count_m; }
+  static constexpr int    encoder_count_increment() { return ::encoder_count_increment(P); }
+  static constexpr int    temperature_mean() { return P.temperature_mean; }
+  static constexpr int    temperature_variance() { return P.temperature_variance; }
+  static constexpr int    vibration_mean() { return P.vibration_mean; }
+  static constexpr int    vibration_variance() { return P.vibration_variance; }
+  static constexpr int    control_rate_us() { return P.control_rate_us; }
+  static constexpr int    fifo_depth() { return P.fifo_depth; }
+};
+
+/**
+ * @brief Class runtime_conveyor_config
+ * Run time policy, the same accessors on the values of the object. Check the
+ * values with check_conveyor_params() before building a model on them.
+ */
+class runtime_conveyor_config {
+private:
+  conveyor_params values;
+  int             increment; // encoder counts per report, computed once
+
+public:
+  explicit runtime_conveyor_config(const conveyor_params &p = default_conveyor_params)
+      : values(p), increment(::encoder_count_increment(p)) {}
+
+  const conveyor_params &params() const { return values; }
+
+  int    scanner_delay_variance_s() const { return values.scanner_delay_variance_s; }
+  int    max_bags() const { return values.max_bags; }
+  int    bag_hysteresis() const { return values.bag_hysteresis; }
+  int    report_rate_ms() const { return values.report_rate_ms; }
+  double dist_per_count_m() const { return values.dist_per_count_m; }
+  int    encoder_count_increment() const { return increment; }
+  int    temperature_mean() const { return values.temperature_mean; }
+  int    temperature_variance() const { return values.temperature_variance; }
+  int    vibration_mean() const { return values.vibration_mean; }
+  int    vibration_variance() const { return values.vibration_variance; }
+  int    control_rate_us() const { return values.control_rate_us; }
+  int    fifo_depth() const { return values.fifo_depth; }
+};
+
+typedef static_conveyor_config<default_conveyor_params> default_conveyor_config;
+
+#endif /* CONVEYOR_CONFIG_HPP_ */
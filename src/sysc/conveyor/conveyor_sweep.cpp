@@ -0,0 +1,249 @@
+/*******************************************************************************
+ * Copyright (C) 2023 by Salvador Z                                            *
+ *                                                                             *
+ * This file is part of SYSTEM_MODELS                                          *
+ *                                                                             *
+ *   Permission is hereby granted, free of charge, to any person obtaining a   *
+ *   copy of this software and associated documentation files (the Software)   *
+ *   to deal in the Software without restriction including without limitation  *
+ *   the rights to use, copy, modify, merge, publish, distribute, sublicense,  *
+ *   and/or sell copies ot the Software, and to permit persons to whom the     *
+ *   Software is furnished to do so, subject to the following conditions:      *
+ *                                                                             *
+ *   The above copyright notice and this permission notice shall be included   *
+ *   in all copies or substantial portions of the Software.                    *
+ *                                                                             *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS   *
+ *   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARANTIES OF MERCHANTABILITY *
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL   *
+ *   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR      *
+ *   OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,     *
+ *   ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE        *
+ *   OR OTHER DEALINGS IN THE SOFTWARE.                                        *
+ ******************************************************************************/
+
+
+/**
+ * @file conveyor_sweep.cpp
+ * @author Salvador Z
+ * @version 1.0
+ * @brief Monte Carlo seed sweep of the conveyor model
+ *
+ * The SystemC kernel is global to the process, so every seed runs in its own
+ * conveyor process. Up to one process per core runs at the same time, the
+ * summary line of each run is collected and the metrics are aggregated in a
+ * mean/percentile table. The latency histograms of the runs are merged.
+ *
+ * usage: conveyor_sweep [-c conveyor_binary] [-j jobs] [-s first_seed] [-n runs] [-- conveyor args]
+ */
+
+#include "child_process.hpp"
+#include "hdr_histogram.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <poll.h>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+#define SWEEP_DEFAULT_RUNS       100
+#define SWEEP_DEFAULT_FIRST_SEED 1
+#define SWEEP_DEFAULT_LOOP_COUNT "10000000" // 10 s of simulated time in --event mode
+#define SWEEP_READ_SIZE          4096
+
+/**
+ * @brief one conveyor process of the sweep
+ *
+ */
+struct sweep_run {
+  int           seed;
+  child_process child;
+  std::string   output;
+};
+
+typedef summary_metrics                      run_metrics;
+typedef std::map<std::string, hdr_histogram> run_histograms;
+
+/**
+ * @brief start the conveyor binary for one seed
+ *
+ * @return true when the process was started
+ */
+static bool start_run(const std::string &binary, const std::vector<std::string> &extra_args, sweep_run &run) {
+  std::vector<std::string> args;
+
+  args.push_back(std::to_string(run.seed));
+  args.insert(args.end(), extra_args.begin(), extra_args.end());
+  run.output.clear();
+  return child_start(binary, args, run.child);
+}
+
+/**
+ * @brief add the histogram lines of a run to the merged histograms
+ *
+ * @param unit_fs set to the unit of the histograms, the same for every run
+ */
+static void merge_histograms(const std::string &output, run_histograms &histograms, uint64_t &unit_fs) {
+  char name[64];
+  int  used;
+
+  for (size_t pos = output.find(HDR_LINE_TAG); std::string::npos != pos;
+       pos = output.find(HDR_LINE_TAG, pos + 1)) {
+    const char *line = output.c_str() + pos + strlen(HDR_LINE_TAG);
+
+    if (1 != sscanf(line, " %63s%n", name, &used)) continue;
+    if (!histograms[name].parse_line(line + used, unit_fs)) fprintf(stderr, "bad histogram line %s\n", name);
+  }
+}
+
+/**
+ * @brief nearest rank percentile of sorted values
+ *
+ */
+static double percentile(const std::vector<double> &sorted, double pct) {
+  size_t rank = (size_t)std::ceil(pct / 100.0 * sorted.size());
+
+  if (rank < 1) rank = 1;
+  return sorted[rank - 1];
+}
+
+int main(int argc, char *argv[]) {
+  std::string                                 binary;
+  std::vector<std::string>                    extra_args;
+  int                                         jobs       = (int)sysconf(_SC_NPROCESSORS_ONLN);
+  int                                         first_seed = SWEEP_DEFAULT_FIRST_SEED;
+  int                                         runs       = SWEEP_DEFAULT_RUNS;
+  int                                         next_run   = 0;
+  int                                         failed     = 0;
+  double                                      cpu_time   = 0.0;
+  const char                                 *slash;
+  char                                        buffer[SWEEP_READ_SIZE];
+  std::vector<sweep_run>                      active;
+  std::vector<run_metrics>                    results;
+  run_histograms                              histograms;
+  uint64_t                                    unit_fs = 0;
+  std::map<std::string, std::vector<double> > columns;
+  std::chrono::steady_clock::time_point       wall_start;
+  std::chrono::duration<double>               wall_time;
+
+  // the conveyor binary is built next to this one
+  slash  = strrchr(argv[0], '/');
+  binary = slash ? std::string(argv[0], slash - argv[0] + 1) + "conveyor" : "./conveyor";
+
+  for (int i = 1; i < argc; ++i) {
+    if (0 == strcmp(argv[i], "--")) {
+      extra_args.assign(argv + i + 1, argv + argc);
+      break;
+    } else if ((0 == strcmp(argv[i], "-c")) && (i + 1 < argc)) {
+      binary = argv[++i];
+    } else if ((0 == strcmp(argv[i], "-j")) && (i + 1 < argc)) {
+      jobs = atoi(argv[++i]);
+    } else if ((0 == strcmp(argv[i], "-s")) && (i + 1 < argc)) {
+      first_seed = atoi(argv[++i]);
+    } else if ((0 == strcmp(argv[i], "-n")) && (i + 1 < argc)) {
+      runs = atoi(argv[++i]);
+    } else {
+      fprintf(stderr,
+              "usage: %s [-c conveyor_binary] [-j jobs] [-s first_seed] [-n runs] [-- conveyor args]\n",
+              argv[0]);
+      return 1;
+    }
+  }
+
+  if (jobs < 1) jobs = 1;
+  if (extra_args.empty()) extra_args = {SWEEP_DEFAULT_LOOP_COUNT, "--event", "-v", "0"};
+
+  printf("conveyor_sweep: %s, %d runs from seed %d, %d jobs, args:", binary.c_str(), runs, first_seed, jobs);
+  for (const std::string &arg : extra_args) printf(" %s", arg.c_str());
+  printf("\n");
+
+  wall_start = std::chrono::steady_clock::now();
+
+  while ((next_run < runs) || !active.empty()) {
+    std::vector<struct pollfd> fds;
+
+    // keep every core busy
+    while ((next_run < runs) && ((int)active.size() < jobs)) {
+      sweep_run run;
+
+      run.seed = first_seed + next_run++;
+      if (start_run(binary, extra_args, run)) {
+        active.push_back(run);
+      } else {
+        ++failed;
+      }
+    }
+
+    for (const sweep_run &run : active) fds.push_back({run.child.fd, POLLIN, 0});
+    if (fds.empty()) continue;
+    if (poll(fds.data(), fds.size(), -1) < 0) continue;
+
+    for (size_t i = fds.size(); i-- > 0;) {
+      ssize_t bytes;
+
+      if (0 == fds[i].revents) continue;
+
+      bytes = read(active[i].child.fd, buffer, sizeof(buffer));
+      if (bytes > 0) {
+        active[i].output.append(buffer, bytes);
+        continue;
+      }
+
+      // end of output, collect the run
+      run_metrics metrics;
+      if (child_finish(active[i].child) && parse_summary(active[i].output, metrics)) {
+        results.push_back(metrics);
+        merge_histograms(active[i].output, histograms, unit_fs);
+      } else {
+        fprintf(stderr, "seed %d failed\n", active[i].seed);
+        ++failed;
+      }
+      active.erase(active.begin() + i);
+    }
+  }
+
+  wall_time = std::chrono::steady_clock::now() - wall_start;
+
+  // aggregate every metric over the runs
+  for (const run_metrics &metrics : results) {
+    for (const auto &metric : metrics) columns[metric.first].push_back(metric.second);
+    if (metrics.count("wall_time_s")) cpu_time += metrics.at("wall_time_s");
+  }
+
+  printf("\n%-16s %14s %14s %14s %14s %14s %14s %14s\n", "metric", "mean", "stddev", "min", "p50", "p90",
+         "p99", "max");
+  for (auto &column : columns) {
+    std::vector<double> &values = column.second;
+    double               mean   = 0.0;
+    double               var    = 0.0;
+
+    if (column.first == "seed") continue;
+
+    std::sort(values.begin(), values.end());
+    for (double v : values) mean += v;
+    mean /= values.size();
+    for (double v : values) var += (v - mean) * (v - mean);
+    var = (values.size() > 1) ? var / (values.size() - 1) : 0.0;
+
+    printf("%-16s %14.3f %14.3f %14.3f %14.3f %14.3f %14.3f %14.3f\n", column.first.c_str(), mean,
+           std::sqrt(var), values.front(), percentile(values, 50), percentile(values, 90),
+           percentile(values, 99), values.back());
+  }
+
+  if (!histograms.empty()) {
+    printf("\nlatencies of all runs, simulated time:\n");
+    for (const auto &histogram : histograms) histogram.second.print(histogram.first.c_str(), unit_fs * 1e-15);
+  }
+
+  // speedup: sum of the simulation wall times over the wall time of the sweep
+  printf("\nruns: %zu ok, %d failed\n", results.size(), failed);
+  printf("sweep wall time: %.3f s, sum of run wall times: %.3f s, speedup: %.2fx on %d jobs\n",
+         wall_time.count(), cpu_time, (wall_time.count() > 0.0) ? cpu_time / wall_time.count() : 0.0, jobs);
+
+  return failed ? 1 : 0;
+}
@@ -0,0 +1,412 @@
+/*******************************************************************************
+ * Copyright (C) 2023 by Salvador Z                                            *
+ *                                                                             *
+ * This file is part of SYSTEM_MODELS                                          *
+ *                                                                             *
+ *   Permission is hereby granted, free of charge, to any person obtaining a   *
+ *   copy of this software and associated documentation files (the Software)   *
+ *   to deal in the Software without restriction including without limitation  *
+ *   the rights to use, copy, modify, merge, publish, distribute, sublicense,  *
+ *   and/or sell copies ot the Software, and to permit persons to whom the     *
+ *   Software is furnished to do so, subject to the following conditions:      *
+ *                                                                             *
+ *   The above copyright notice and this permission notice shall be included   *
+ *   in all copies or substantial portions of the Software.                    *
+ *                                                                             *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS   *
+ *   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARANTIES OF MERCHANTABILITY *
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL   *
+ *   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR      *
+ *   OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,     *
+ *   ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE        *
+ *   OR OTHER DEALINGS IN THE SOFTWARE.                                        *
+ ******************************************************************************/
+
+
+/**
+ * @file cosim_bridge.hpp
+ * @author Salvador Z
+ * @version 1.0
+ * @brief File for the co-simulation of the controller on an OS thread
+ *
+ * In CONTROL_MODE_COSIM the Control_System only forwards the received status
+ * packets, in their packed form, to a cosim_controller running on its own OS
+ * thread, and writes the control packets the controller sends back. Both
+ * directions are lock-free spsc_rings. The controller wakes the kernel with
+ * async_request_update() on a cosim_link; at a sync point the kernel stops
+ * until the controller has processed everything sent so far. An idle
+ * controller sleeps on a condition variable until the kernel sends again.
+ * The health alarms come back on a third ring and are logged by the kernel,
+ * the only producer of the sim_log ring.
+ */
+
+#ifndef COSIM_BRIDGE_HPP_
+#define COSIM_BRIDGE_HPP_
+
+// Includes
+#include "conveyor.hpp"
+#include "health_monitor.hpp"
+#include "spsc_ring.hpp"
+#include "wire_format.hpp"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <mutex>
+#include <systemc.h>
+#include <thread>
+
+#define COSIM_RING_SIZE       4096 // messages per direction
+#define COSIM_ALARM_RING_SIZE 256  // alarm changes not logged yet, more are counted and dropped
+#define COSIM_SPIN_LIMIT      256  // polls of an empty ring before yielding the core
+#define COSIM_YIELD_LIMIT     64   // yields with an empty ring before sleeping until the kernel sends
+#define COSIM_LATENCY_BUCKETS 48   // log2 ns buckets, up to 2^47 ns
+
+// kinds of cosim_status
+#define COSIM_MSG_SCANNER  0 // scanner status packet
+#define COSIM_MSG_CONVEYOR 1 // conveyor status packet
+#define COSIM_MSG_SYNC     2 // sync point, the kernel waits until it is acknowledged
+#define COSIM_MSG_STOP     3 // end of the run
+
+#define COSIM_TARGET_SCANNER -1 // cosim_command for the scanner, else a segment port index
+
+/**
+ * @brief kernel to controller message
+ *
+ */
+struct cosim_status {
+  uint64_t seq;     // message number, from 1
+  int64_t  sent_ns; // cosim_clock_ns() when the kernel sent it
+  int32_t  kind;
+  int32_t  segment; // port index of a conveyor status
+  union {
+    packed_scanner_sts  scanner;
+    packed_conveyor_sts conveyor;
+  } pkt;
+};
+
+/**
+ * @brief controller to kernel message
+ *
+ */
+struct cosim_command {
+  int64_t cause_ns; // sent_ns of the status that caused it
+  int32_t target;   // COSIM_TARGET_SCANNER or a segment port index
+  int32_t msg;      // CONTROL_PKT_MSG_*
+};
+
+// real time of the latency measurements
+inline int64_t cosim_clock_ns() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+/**
+ * @brief Class cosim_latency
+ * Log2 histogram of real time latencies in ns.
+ */
+class cosim_latency {
+private:
+  uint64_t buckets[COSIM_LATENCY_BUCKETS];
+  uint64_t count;
+  uint64_t sum_ns;
+  uint64_t max_ns;
+
+public:
+  cosim_latency() : buckets(), count(0), sum_ns(0), max_ns(0) {}
+
+  void record(int64_t ns) {
+    uint64_t value  = (ns > 0) ? (uint64_t)ns : 0;
+    int      bucket = 0;
+
+    while ((value >> bucket) > 1 && (bucket < COSIM_LATENCY_BUCKETS - 1)) ++bucket;
+    ++buckets[bucket];
+    ++count;
+    sum_ns += value;
+    if (value > max_ns) max_ns = value;
+  }
+
+  /**
+   * @brief upper bound of the bucket holding the p quantile
+   *
+   * @param p quantile in [0, 1]
+   */
+  uint64_t quantile_ns(double p) const {
+    uint64_t rank = (uint64_t)(p * count);
+    uint64_t seen = 0;
+
+    for (int i = 0; i < COSIM_LATENCY_BUCKETS; i++) {
+      seen += buckets[i];
+      if (seen > rank) return (uint64_t)2 << i;
+    }
+    return max_ns;
+  }
+
+  uint64_t get_count() const {
+    return count;
+  }
+
+  void print(const char *name) const {
+    printf("  %-15s = %llu, mean %.1f us, p50 < %.1f us, p99 < %.1f us, max %.1f us\n", name,
+           (unsigned long long)count, count ? sum_ns / 1e3 / count : 0.0, quantile_ns(0.50) / 1e3,
+           quantile_ns(0.99) / 1e3, max_ns / 1e3);
+  }
+};
+
+/**
+ * @brief Class cosim_controller
+ * The control rules of the Control_System on an OS thread. The thread only
+ * touches its own state and the rings, so the state can be read once stop()
+ * has joined it.
+ */
+class cosim_controller {
+private:
+  spsc_ring<cosim_status, COSIM_RING_SIZE>       status_ring;  // kernel to controller
+  spsc_ring<cosim_command, COSIM_RING_SIZE>      command_ring; // controller to kernel
+  spsc_ring<health_alarm, COSIM_ALARM_RING_SIZE> alarm_ring;   // controller to kernel, logged there
+  std::atomic<uint64_t>                          acked;        // seq of the last status processed
+  std::function<void()>                          wake;         // asks the kernel to read the commands
+  std::thread                                    worker;
+  std::atomic<bool>                              done;         // the worker left run()
+
+  // the worker sleeps on an empty status ring, the kernel wakes it after a push
+  std::mutex              idle_mutex;
+  std::condition_variable idle_cv;
+  std::atomic<bool>       idle;
+
+  // control state, owned by the worker while it runs
+  int            bag_count; // bags scanned, the cosim run does not deliver them
+  int            scanner_running;
+  int            max_bag_count;
+  int            max_bags; // scanner control rules of the line
+  int            hysteresis;
+  health_monitor health;
+  bool           staged; // samples waiting for health.update()
+  bool           sent;   // commands pushed since the last wake
+  long           alarms_dropped;
+
+  void send(int target, int msg, int64_t cause_ns) {
+    cosim_command cmd = {cause_ns, target, msg};
+
+    // the kernel drains the commands while it waits on its own pushes and syncs
+    while (!command_ring.try_push(cmd)) std::this_thread::yield();
+    sent = true;
+  }
+
+  void check_health() {
+    int                 alarm_count;
+    const health_alarm *alarms;
+
+    if (!staged) return;
+    staged      = false;
+    alarm_count = health.update();
+    alarms      = health.get_alarms();
+
+    // the log is not blocked on, the alarm counts stay exact
+    for (int i = 0; i < alarm_count; i++) {
+      if (!alarm_ring.try_push(alarms[i])) ++alarms_dropped;
+    }
+    health.clear_alarms();
+  }
+
+  void on_status(const cosim_status &status) {
+    int msg = CONTROL_PKT_MSG_NONE;
+
+    switch (status.kind) {
+    case COSIM_MSG_SCANNER:
+      ++bag_count;
+      if (bag_count > max_bag_count) max_bag_count = bag_count;
+      msg = scanner_control_after_scan(scanner_running, bag_count, max_bags);
+      break;
+
+    case COSIM_MSG_CONVEYOR:
+      health.stage(status.segment, status.pkt.conveyor.id, status.pkt.conveyor.ticks,
+                   status.pkt.conveyor.temperature, status.pkt.conveyor.vibration);
+      staged = true;
+      msg    = scanner_control_after_status(scanner_running, bag_count, max_bags, hysteresis);
+      break;
+
+    case COSIM_MSG_SYNC:
+      check_health();
+      break;
+    }
+
+    if (CONTROL_PKT_MSG_NONE != msg) {
+      send(COSIM_TARGET_SCANNER, msg, status.sent_ns);
+      scanner_running = msg;
+    }
+  }
+
+  // no status for a while, block until push_status() sees the idle flag
+  void sleep() {
+    std::unique_lock<std::mutex> lock(idle_mutex);
+
+    idle.store(true);
+    // pairs with the fence in push_status(), either the kernel sees idle or this sees its status
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (status_ring.empty()) {
+      idle_cv.wait(lock, [this] { return !idle.load(); });
+    } else {
+      idle.store(false);
+    }
+  }
+
+  void run() {
+    cosim_status status;
+    int          spins = 0;
+
+    while (true) {
+      if (!status_ring.try_pop(status)) {
+        // the kernel has nothing more for now, end of a batch
+        check_health();
+        ++spins;
+        if (spins > COSIM_SPIN_LIMIT + COSIM_YIELD_LIMIT) {
+          sleep();
+          spins = 0;
+        } else if (spins > COSIM_SPIN_LIMIT) {
+          std::this_thread::yield();
+        }
+        continue;
+      }
+      spins = 0;
+
+      if (COSIM_MSG_STOP == status.kind) break;
+      on_status(status);
+
+      // commands before the ack, the kernel reads them once it sees the ack
+      if (sent && wake) wake();
+      sent = false;
+      acked.store(status.seq, std::memory_order_release);
+    }
+    check_health();
+    done.store(true, std::memory_order_release);
+  }
+
+  bool push_status(const cosim_status &status) {
+    if (!status_ring.try_push(status)) return false;
+
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (idle.load()) {
+      std::lock_guard<std::mutex> lock(idle_mutex);
+
+      idle.store(false);
+      idle_cv.notify_one();
+    }
+    return true;
+  }
+
+public:
+  explicit cosim_controller(int max_bags_in_system = MAX_NUMBER_BAGS_IN_SYSTEM,
+                            int bag_hysteresis     = BAG_COUNT_HYSTERESIS)
+      : acked(0), done(false), idle(false), bag_count(0), scanner_running(CONTROL_PKT_MSG_TURN_ON),
+        max_bag_count(0), max_bags(max_bags_in_system), hysteresis(bag_hysteresis), staged(false),
+        sent(false), alarms_dropped(0) {}
+
+  ~cosim_controller() {
+    stop();
+  }
+
+  /**
+   * @brief start the controller thread, the scanner and the segments are already on
+   *
+   * @param segments number of segment ports
+   * @param wake_fn called from the controller thread after it sent commands, may be empty
+   */
+  void start(int segments, std::function<void()> wake_fn) {
+    health.resize(segments);
+    wake   = wake_fn;
+    worker = std::thread(&cosim_controller::run, this);
+  }
+
+  /**
+   * @brief stop and join the controller thread, once
+   *
+   * The commands still coming back are dropped, a worker blocked on a full command ring
+   * would otherwise never reach the stop message.
+   */
+  void stop() {
+    cosim_status  status = {};
+    cosim_command cmd;
+
+    if (!worker.joinable()) return;
+    status.kind = COSIM_MSG_STOP;
+    while (!push_status(status)) {
+      while (command_ring.try_pop(cmd)) {}
+      std::this_thread::yield();
+    }
+    while (!done.load(std::memory_order_acquire)) {
+      while (command_ring.try_pop(cmd)) {}
+      std::this_thread::yield();
+    }
+    worker.join();
+  }
+
+  // kernel side
+
+  bool try_send(const cosim_status &status) {
+    return push_status(status);
+  }
+
+  bool try_receive(cosim_command &cmd) {
+    return command_ring.try_pop(cmd);
+  }
+
+  // also after stop(), for the alarms of the last batch
+  bool try_receive_alarm(health_alarm &alarm) {
+    return alarm_ring.try_pop(alarm);
+  }
+
+  uint64_t get_acked() const {
+    return acked.load(std::memory_order_acquire);
+  }
+
+  // valid after stop()
+
+  int get_max_bag_count() const {
+    return max_bag_count;
+  }
+
+  long get_health_alarms() const {
+    return (long)health.get_alarms_raised();
+  }
+
+  long get_alarms_dropped() const {
+    return alarms_dropped;
+  }
+
+  void print_stats() const {
+    health.print_stats();
+  }
+};
+
+/**
+ * @brief Class cosim_link
+ * Wakes the kernel from the controller thread, command_event() is notified in
+ * the delta cycle after a wake().
+ */
+class cosim_link : public sc_prim_channel {
+private:
+  sc_event commands_event;
+
+protected:
+  virtual void update() {
+    commands_event.notify(SC_ZERO_TIME);
+  }
+
+public:
+  explicit cosim_link(const char *name) : sc_prim_channel(name) {}
+
+  // any thread
+  void wake() {
+    async_request_update();
+  }
+
+  const sc_event &command_event() const {
+    return commands_event;
+  }
+};
+
+#endif /* COSIM_BRIDGE_HPP_ */
@@ -0,0 +1,353 @@
+/*******************************************************************************
+ * Copyright (C) 2023 by Salvador Z                                            *
+ *                                                                             *
+ * This file is part of SYSTEM_MODELS                                          *
+ *                                                                             *
+ *   Permission is hereby granted, free of charge, to any person obtaining a   *
+ *   copy of this software and associated documentation files (the Software)   *
+ *   to deal in the Software without restriction including without limitation  *
+ *   the rights to use, copy, modify, merge, publish, distribute, sublicense,  *
+ *   and/or sell copies ot the Software, and to permit persons to whom the     *
+ *   Software is furnished to do so, subject to the following conditions:      *
+ *                                                                             *
+ *   The above copyright notice and this permission notice shall be included   *
+ *   in all copies or substantial portions of the Software.                    *
+ *                                                                             *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS   *
+ *   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARANTIES OF MERCHANTABILITY *
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL   *
+ *   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR      *
+ *   OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,     *
+ *   ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE        *
+ *   OR OTHER DEALINGS IN THE SOFTWARE.                                        *
+ ******************************************************************************/
+
+/**
+ * @file health_monitor.hpp
+ * @author Salvador Z
+ * @version 1.0
+ * @brief File for the streaming temperature and vibration health monitor
+ *
+ */
+
+#ifndef HEALTH_MONITOR_HPP_
+#define HEALTH_MONITOR_HPP_
+
+// Includes
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#define HEALTH_EWMA_ALPHA     0.05f // weight of a new sample in the mean, about a 20 report window
+#define HEALTH_WINDOW         64    // samples of the variance window, a segment raises alarms once it is full
+#define HEALTH_Z_RAISE        4.0f  // |z| that raises an alarm
+#define HEALTH_Z_CLEAR        2.0f  // |z| under which a raised alarm clears
+#define HEALTH_MIN_VARIANCE   0.25f // variance floor, a constant signal would alarm on any change
+#define HEALTH_MAX_ALARMS     1024  // alarm events kept between two drains
+
+// monitored channels
+#define HEALTH_CHANNEL_TEMPERATURE 0
+#define HEALTH_CHANNEL_VIBRATION   1
+#define HEALTH_NUM_CHANNELS        2
+
+/**
+ * @brief alarm raised or cleared on one channel of a segment
+ *
+ */
+struct health_alarm {
+  uint64_t timestamp; // time resolution ticks of the status packet
+  int32_t  segment;   // segment ID
+  int16_t  channel;   // HEALTH_CHANNEL_*
+  int16_t  raised;    // 1 raised, 0 cleared
+  float    value;     // sample
+  float    z;         // z-score of the sample against the mean and variance before it
+};
+
+/**
+ * @brief Class health_monitor
+ * Per segment EWMA mean of the temperature and the vibration, and their variance over
+ * the last HEALTH_WINDOW samples, kept as one array per field (structure of arrays).
+ * The window is a ring of samples per segment with its running sum and sum of
+ * squares; the samples are integers, so both sums stay exact in a float. The samples
+ * of a control system wakeup are staged, then update() gathers the state of the
+ * staged segments into contiguous arrays, runs the filter on all of them in one
+ * branch free loop the compiler vectorizes, and scatters the state back. A z-score,
+ * distance to the mean over the window standard deviation, over HEALTH_Z_RAISE raises
+ * an alarm, under HEALTH_Z_CLEAR clears it. Alarms go to a fixed array drained by the
+ * caller, nothing is allocated after resize().
+ */
+class health_monitor {
+private:
+  int num_segments;
+
+  // per segment state
+  std::vector<float>    mean[HEALTH_NUM_CHANNELS];
+  std::vector<float>    sum[HEALTH_NUM_CHANNELS];    // of the samples in the window
+  std::vector<float>    sum_sq[HEALTH_NUM_CHANNELS]; // of the squared samples in the window
+  std::vector<float>    window[HEALTH_NUM_CHANNELS]; // HEALTH_WINDOW samples per segment
+  std::vector<uint8_t>  alarmed[HEALTH_NUM_CHANNELS];
+  std::vector<uint32_t> samples;
+  std::vector<uint32_t> staged_tick; // tick a segment was last staged in
+
+  // samples staged for the current tick, one entry per segment at most
+  uint32_t              tick;
+  int                   staged;
+  std::vector<int32_t>  st_seg;
+  std::vector<int32_t>  st_id;
+  std::vector<uint64_t> st_time;
+  std::vector<float>    st_x[HEALTH_NUM_CHANNELS];
+  std::vector<float>    st_mean[HEALTH_NUM_CHANNELS];
+  std::vector<float>    st_sum[HEALTH_NUM_CHANNELS];
+  std::vector<float>    st_sum_sq[HEALTH_NUM_CHANNELS];
+  std::vector<float>    st_old[HEALTH_NUM_CHANNELS]; // sample leaving the window
+  std::vector<float>    st_d2[HEALTH_NUM_CHANNELS];  // squared distance to the previous mean
+
+  health_alarm alarms[HEALTH_MAX_ALARMS];
+  int          alarm_count;
+
+  // statistics
+  uint64_t total_samples;
+  uint64_t total_updates;
+  uint64_t alarms_raised;
+  uint64_t alarms_dropped;
+
+  /**
+   * @brief EWMA mean and window sums of n staged samples
+   * Leaves in d2 the squared distance of each sample to the mean before it.
+   */
+  static void filter(int n, const float *__restrict x, const float *__restrict old, float *__restrict m,
+                     float *__restrict s, float *__restrict sq, float *__restrict d2) {
+    for (int i = 0; i < n; i++) {
+      float diff = x[i] - m[i];
+
+      d2[i] = diff * diff;
+      m[i]  = m[i] + HEALTH_EWMA_ALPHA * diff;
+      s[i]  = s[i] + (x[i] - old[i]);
+      sq[i] = sq[i] + (x[i] * x[i] - old[i] * old[i]);
+    }
+  }
+
+  /**
+   * @brief sample variance of a full window
+   *
+   */
+  static float window_variance(float s, float sq) {
+    return (sq - s * s / HEALTH_WINDOW) / (HEALTH_WINDOW - 1);
+  }
+
+  void push_alarm(int i, int ch, int raised, float mean_before, float var_before) {
+    if (HEALTH_MAX_ALARMS == alarm_count) {
+      ++alarms_dropped;
+      return;
+    }
+
+    health_alarm &alarm = alarms[alarm_count++];
+
+    alarm.timestamp = st_time[i];
+    alarm.segment   = st_id[i];
+    alarm.channel   = (int16_t)ch;
+    alarm.raised    = (int16_t)raised;
+    alarm.value     = st_x[ch][i];
+    alarm.z         = (st_x[ch][i] - mean_before) / std::sqrt(var_before);
+    if (raised) ++alarms_raised;
+  }
+
+public:
+  health_monitor()
+      : num_segments(0), tick(1), staged(0), alarm_count(0), total_samples(0), total_updates(0),
+        alarms_raised(0), alarms_dropped(0) {}
+
+  /**
+   * @brief allocate the state of all the segments, before the simulation starts
+   *
+   */
+  void resize(int segments) {
+    num_segments = segments;
+
+    for (int ch = 0; ch < HEALTH_NUM_CHANNELS; ch++) {
+      mean[ch].assign(segments, 0.0f);
+      sum[ch].assign(segments, 0.0f);
+      sum_sq[ch].assign(segments, 0.0f);
+      window[ch].assign((size_t)segments * HEALTH_WINDOW, 0.0f);
+      alarmed[ch].assign(segments, 0);
+      st_x[ch].resize(segments);
+      st_mean[ch].resize(segments);
+      st_sum[ch].resize(segments);
+      st_sum_sq[ch].resize(segments);
+      st_old[ch].resize(segments);
+      st_d2[ch].resize(segments);
+    }
+    samples.assign(segments, 0);
+    staged_tick.assign(segments, 0);
+    st_seg.resize(segments);
+    st_id.resize(segments);
+    st_time.resize(segments);
+    staged = 0;
+  }
+
+  /**
+   * @brief stage the sample of a status packet
+   * A segment staged twice in the same tick flushes the tick first, so its second
+   * sample sees the state updated by the first one.
+   *
+   * @param seg segment index
+   * @param id segment ID, reported in the alarms
+   * @param timestamp time resolution ticks of the status packet
+   */
+  void stage(int seg, int id, uint64_t timestamp, int temperature, int vibration) {
+    if (tick == staged_tick[seg]) update();
+
+    staged_tick[seg]                         = tick;
+    st_seg[staged]                           = seg;
+    st_id[staged]                            = id;
+    st_time[staged]                          = timestamp;
+    st_x[HEALTH_CHANNEL_TEMPERATURE][staged] = (float)temperature;
+    st_x[HEALTH_CHANNEL_VIBRATION][staged]   = (float)vibration;
+    ++staged;
+  }
+
+  /**
+   * @brief update the state of the staged segments and queue the alarm changes
+   *
+   * @return int number of alarm events waiting in get_alarms()
+   */
+  int update() {
+    int    n = staged;
+    int    seg;
+    size_t slot;
+    float  mean_before;
+    float  var_before;
+    bool   warm;
+
+    if (0 == n) return alarm_count;
+
+    // gather, the window slot of the next sample holds the oldest one
+    for (int ch = 0; ch < HEALTH_NUM_CHANNELS; ch++) {
+      for (int i = 0; i < n; i++) {
+        seg  = st_seg[i];
+        slot = (size_t)seg * HEALTH_WINDOW + samples[seg] % HEALTH_WINDOW;
+
+        st_mean[ch][i]   = mean[ch][seg];
+        st_sum[ch][i]    = sum[ch][seg];
+        st_sum_sq[ch][i] = sum_sq[ch][seg];
+        st_old[ch][i]    = window[ch][slot];
+      }
+    }
+
+    // the first sample of a segment is its mean, no distance
+    for (int i = 0; i < n; i++) {
+      if (0 == samples[st_seg[i]]) {
+        for (int ch = 0; ch < HEALTH_NUM_CHANNELS; ch++) st_mean[ch][i] = st_x[ch][i];
+      }
+    }
+
+    for (int ch = 0; ch < HEALTH_NUM_CHANNELS; ch++) {
+      filter(n, st_x[ch].data(), st_old[ch].data(), st_mean[ch].data(), st_sum[ch].data(),
+             st_sum_sq[ch].data(), st_d2[ch].data());
+    }
+
+    // scatter and alarm hysteresis, against the window before the sample
+    for (int i = 0; i < n; i++) {
+      seg  = st_seg[i];
+      slot = (size_t)seg * HEALTH_WINDOW + samples[seg] % HEALTH_WINDOW;
+      warm = samples[seg]++ >= HEALTH_WINDOW;
+
+      for (int ch = 0; ch < HEALTH_NUM_CHANNELS; ch++) {
+        mean_before = mean[ch][seg];
+        var_before  = window_variance(sum[ch][seg], sum_sq[ch][seg]);
+        if (var_before < HEALTH_MIN_VARIANCE) var_before = HEALTH_MIN_VARIANCE;
+
+        mean[ch][seg]    = st_mean[ch][i];
+        sum[ch][seg]     = st_sum[ch][i];
+        sum_sq[ch][seg]  = st_sum_sq[ch][i];
+        window[ch][slot] = st_x[ch][i];
+
+        if (!warm) continue;
+
+        if (!alarmed[ch][seg] && (st_d2[ch][i] > HEALTH_Z_RAISE * HEALTH_Z_RAISE * var_before)) {
+          alarmed[ch][seg] = 1;
+          push_alarm(i, ch, 1, mean_before, var_before);
+        } else if (alarmed[ch][seg] && (st_d2[ch][i] < HEALTH_Z_CLEAR * HEALTH_Z_CLEAR * var_before)) {
+          alarmed[ch][seg] = 0;
+          push_alarm(i, ch, 0, mean_before, var_before);
+        }
+      }
+    }
+
+    total_samples += n;
+    ++total_updates;
+    staged = 0;
+    ++tick;
+    return alarm_count;
+  }
+
+  const health_alarm *get_alarms() const {
+    return alarms;
+  }
+
+  int get_alarm_count() const {
+    return alarm_count;
+  }
+
+  void clear_alarms() {
+    alarm_count = 0;
+  }
+
+  uint64_t get_alarms_raised() const {
+    return alarms_raised;
+  }
+
+  /**
+   * @brief write the filter state, between two ticks (nothing staged)
+   *
+   * @param ckpt checkpoint_writer
+   */
+  template <typename WRITER>
+  void save(WRITER &ckpt) const {
+    for (int ch = 0; ch < HEALTH_NUM_CHANNELS; ch++) {
+      ckpt.put_vector(mean[ch]);
+      ckpt.put_vector(sum[ch]);
+      ckpt.put_vector(sum_sq[ch]);
+      ckpt.put_vector(window[ch]);
+      ckpt.put_vector(alarmed[ch]);
+    }
+    ckpt.put_vector(samples);
+    ckpt.put(total_samples);
+    ckpt.put(total_updates);
+    ckpt.put(alarms_raised);
+    ckpt.put(alarms_dropped);
+  }
+
+  /**
+   * @brief read the state written by save(), after resize() to the same number of segments
+   *
+   * @param ckpt checkpoint_reader
+   */
+  template <typename READER>
+  void restore(READER &ckpt) {
+    for (int ch = 0; ch < HEALTH_NUM_CHANNELS; ch++) {
+      ckpt.get_vector(mean[ch]);
+      ckpt.get_vector(sum[ch]);
+      ckpt.get_vector(sum_sq[ch]);
+      ckpt.get_vector(window[ch]);
+      ckpt.get_vector(alarmed[ch]);
+    }
+    ckpt.get_vector(samples);
+    ckpt.get(total_samples);
+    ckpt.get(total_updates);
+    ckpt.get(alarms_raised);
+    ckpt.get(alarms_dropped);
+  }
+
+  void print_stats() const {
+    printf("\nHealth monitor:\n");
+    printf("  samples         = %llu\n", (unsigned long long)total_samples);
+    printf("  updates         = %llu (%.1f samples per update)\n", (unsigned long long)total_updates,
+           total_updates ? (double)total_samples / total_updates : 0.0);
+    printf("  alarms raised   = %llu\n", (unsigned long long)alarms_raised);
+    printf("  alarms dropped  = %llu\n", (unsigned long long)alarms_dropped);
+  }
+};
+
+#endif /* HEALTH_MONITOR_HPP_ */
@@ -0,0 +1,493 @@
+/*******************************************************************************
+ * Copyright (C) 2023 by Salvador Z                                            *
+ *                                                                             *
+ * This file is part of SYSTEM_MODELS                                          *
+ *                                                                             *
+ *   Permission is hereby granted, free of charge, to any person obtaining a   *
+ *   copy of this software and associated documentation files (the Software)   *
+ *   to deal in the Software without restriction including without limitation  *
+ *   the rights to use, copy, modify, merge, publish, distribute, sublicense,  *
+ *   and/or sell copies ot the Software, and to permit persons to whom the     *
+ *   Software is furnished to do so, subject to the following conditions:      *
+ *                                                                             *
+ *   The above copyright notice and this permission notice shall be included   *
+ *   in all copies or substantial portions of the Software.                    *
+ *                                                                             *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS   *
+ *   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARANTIES OF MERCHANTABILITY *
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL   *
+ *   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR      *
+ *   OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,     *
+ *   ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE        *
+ *   OR OTHER DEALINGS IN THE SOFTWARE.                                        *
+ ******************************************************************************/
+
+
+/**
+ * @file network.hpp
+ * @author Salvador Z
+ * @version 1.0
+ * @brief File for the modules of a baggage handling network
+ *
+ * The nodes of a network_description become scanner, belt, merge, diverter and
+ * make-up line modules, its links become sc_fifos. The bags are the scanner status
+ * packets of the conveyor model; their destination make-up line is kept by the
+ * bag_registry under the bag ID, so the packets and their transports are unchanged.
+ * Every node is an SC_METHOD: a network of thousands of nodes has no thread stacks.
+ */
+
+#ifndef NETWORK_HPP_
+#define NETWORK_HPP_
+
+// Includes
+#include "conveyor.hpp"
+#include "counter_rng.hpp"
+#include "fifo_monitor.hpp"
+#include "hdr_histogram.hpp"
+#include "network_description.hpp"
+#include "packet_pool.hpp"
+#include "sim_log.hpp"
+#include "wire_format.hpp"
+#include <systemc.h>
+#include <vector>
+
+#define NETWORK_LINK_DEPTH 2 // bags waiting between two nodes
+
+// Type carried by the links
+typedef packet_msg<scanner_sts_packet> bag_msg;
+
+/**
+ * @brief Class bag_registry
+ * Destination make-up line of every bag, indexed by the bag ID it hands out.
+ */
+class bag_registry {
+private:
+  std::vector<int32_t> destination;
+
+public:
+  int add(int line) {
+    destination.push_back(line);
+    return (int)destination.size() - 1;
+  }
+
+  int get_destination(int bag_id) const {
+    return destination[bag_id];
+  }
+
+  long get_count() const {
+    return (long)destination.size();
+  }
+};
+
+/**
+ * @brief Scanner node
+ * Puts a bag on its output every period on average (uniform in [period / 2, 3 period / 2]),
+ * for a make-up line drawn among the ones it reaches. A full output holds the next bag
+ * back until the belt takes it.
+ */
+class net_scanner : public sc_module {
+private:
+  counter_rng             rng;
+  bag_registry           &registry;
+  const std::vector<int> &lines; // make-up lines reached
+  int                     period_us;
+  bool                    started;
+  bool                    pending; // pending_msg was not written yet
+  bag_msg                 pending_msg;
+  long                    bags_scanned;
+  long                    stalls;
+
+  sc_time draw_delay() {
+    return sc_time(period_us / 2 + rng.uniform(period_us + 1), SC_US);
+  }
+
+  void scan_method() {
+    if (!started) {
+      started = true;
+      next_trigger(draw_delay());
+      return;
+    }
+
+    if (!pending) {
+      packet_ptr<scanner_sts_packet> bag;
+
+      bag->set_timestamp(sc_time_stamp());
+      bag->set_bag_id(registry.add(lines[rng.uniform((uint32_t)lines.size())]));
+      pending_msg = bag.send();
+      pending     = true;
+    }
+    if (!out->nb_write(pending_msg)) {
+      ++stalls;
+      next_trigger(out->data_read_event());
+      return;
+    }
+    pending = false;
+    ++bags_scanned;
+    next_trigger(draw_delay());
+  }
+
+public:
+  sc_fifo_out<bag_msg> out;
+
+  SC_HAS_PROCESS(net_scanner);
+
+  net_scanner(sc_module_name name, int seed, int period_ms, bag_registry &reg, const std::vector<int> &reach)
+      : sc_module(name), rng(seed, counter_rng::instance_id(this->name())), registry(reg), lines(reach),
+        period_us(period_ms * 1000), started(false), pending(false), bags_scanned(0), stalls(0) {
+    SC_METHOD(scan_method);
+  }
+
+  long get_bags_scanned() const {
+    return bags_scanned;
+  }
+
+  long get_stalls() const {
+    return stalls;
+  }
+};
+
+/**
+ * @brief Belt node
+ * Carries up to capacity bags, each one leaves transit time after it got on. Bags keep
+ * their order, a bag that cannot get off holds back the ones behind it.
+ */
+class net_belt : public sc_module {
+private:
+  struct slot {
+    sc_time exit_time;
+    bag_msg msg;
+  };
+
+  std::vector<slot> ring;
+  size_t            head;
+  size_t            count;
+  sc_time           transit;
+  sc_event          exit_event;
+  long              bags_carried;
+  size_t            max_count;
+
+  void belt_method() {
+    const sc_time now = sc_time_stamp();
+
+    // unload the bags that reached the end
+    while ((count > 0) && (ring[head].exit_time <= now) && (out->num_free() > 0)) {
+      out->nb_write(ring[head].msg);
+      head = (head + 1) % ring.size();
+      --count;
+    }
+
+    // load the waiting bags
+    while ((count < ring.size()) && (in->num_available() > 0)) {
+      slot &tail = ring[(head + count) % ring.size()];
+
+      in->nb_read(tail.msg);
+      tail.exit_time = now + transit;
+      ++count;
+      ++bags_carried;
+    }
+    if (count > max_count) max_count = count;
+
+    // a full output wakes the belt with data_read()
+    if (count > 0) {
+      if (ring[head].exit_time > now) {
+        exit_event.notify(ring[head].exit_time - now);
+      } else if (out->num_free() > 0) {
+        exit_event.notify(SC_ZERO_TIME);
+      }
+    }
+  }
+
+public:
+  sc_fifo_in<bag_msg>  in;
+  sc_fifo_out<bag_msg> out;
+
+  SC_HAS_PROCESS(net_belt);
+
+  net_belt(sc_module_name name, int transit_ms, int capacity)
+      : sc_module(name), ring(capacity), head(0), count(0), transit(transit_ms, SC_MS), bags_carried(0),
+        max_count(0) {
+    SC_METHOD(belt_method);
+    sensitive << in.data_written() << out.data_read() << exit_event;
+    dont_initialize();
+  }
+
+  long get_bags_carried() const {
+    return bags_carried;
+  }
+
+  size_t get_count() const {
+    return count;
+  }
+
+  size_t get_max_count() const {
+    return max_count;
+  }
+
+  size_t get_capacity() const {
+    return ring.size();
+  }
+};
+
+/**
+ * @brief Merge node
+ * Takes the bags of its inputs in turn while the output has room.
+ */
+class net_merge : public sc_module {
+private:
+  size_t next; // input served first
+
+  void merge_method() {
+    bag_msg msg;
+    size_t  idle = 0;
+
+    while ((idle < in.size()) && (out->num_free() > 0)) {
+      if (in[next]->nb_read(msg)) {
+        out->nb_write(msg);
+        idle = 0;
+      } else {
+        ++idle;
+      }
+      next = (next + 1) % in.size();
+    }
+  }
+
+public:
+  sc_vector<sc_fifo_in<bag_msg> > in;
+  sc_fifo_out<bag_msg>            out;
+
+  SC_HAS_PROCESS(net_merge);
+
+  net_merge(sc_module_name name, int inputs) : sc_module(name), next(0), in("in", inputs) {
+    SC_METHOD(merge_method);
+    for (sc_fifo_in<bag_msg> &port : in) sensitive << port.data_written();
+    sensitive << out.data_read();
+    dont_initialize();
+  }
+};
+
+/**
+ * @brief Diverter node
+ * Sends every bag to the output that reaches its make-up line. A bag waiting for a
+ * full output holds back the bags behind it.
+ */
+class net_diverter : public sc_module {
+private:
+  const bag_registry &registry;
+  std::vector<int>    routes; // output per make-up line, see network_description::routes()
+  bool                holding;
+  bag_msg             held;
+  int                 route;
+
+  void divert_method() {
+    while (true) {
+      if (!holding) {
+        if (!in->nb_read(held)) return;
+        holding = true;
+        route   = routes[registry.get_destination(packet_of<scanner_sts_packet>(held).get_bag_id())];
+        if (route < 0) route = 0; // not reached from here, the make-up line counts it as misrouted
+      }
+      if (!out[route]->nb_write(held)) return;
+      holding = false;
+    }
+  }
+
+public:
+  sc_fifo_in<bag_msg>              in;
+  sc_vector<sc_fifo_out<bag_msg> > out;
+
+  SC_HAS_PROCESS(net_diverter);
+
+  net_diverter(sc_module_name name, int outputs, const bag_registry &reg, const std::vector<int> &table)
+      : sc_module(name), registry(reg), routes(table), holding(false), route(0), out("out", outputs) {
+    SC_METHOD(divert_method);
+    sensitive << in.data_written();
+    for (sc_fifo_out<bag_msg> &port : out) sensitive << port.data_read();
+    dont_initialize();
+  }
+};
+
+/**
+ * @brief Make-up line node
+ * End of the bags: records the time from scan to arrival in the network histogram.
+ */
+class net_makeup : public sc_module {
+private:
+  const bag_registry &registry;
+  hdr_histogram      &latency;
+  int                 line; // make-up line index
+  sim_log_source     &log;
+  long                bags_delivered;
+  long                bags_misrouted;
+
+  void makeup_method() {
+    bag_msg msg;
+
+    for (sc_fifo_in<bag_msg> &port : in) {
+      while (port->nb_read(msg)) {
+        packet_ptr<scanner_sts_packet> bag(msg);
+
+        latency.record((sc_time_stamp() - bag->get_timestamp()).value());
+        ++bags_delivered;
+        if (registry.get_destination(bag->get_bag_id()) != line) ++bags_misrouted;
+        SIM_LOG(log, SIM_LOG_DEBUG, "bag %d scanned at %.9f s", bag->get_bag_id(),
+                bag->get_timestamp().to_seconds());
+      }
+    }
+  }
+
+public:
+  sc_vector<sc_fifo_in<bag_msg> > in;
+
+  SC_HAS_PROCESS(net_makeup);
+
+  net_makeup(sc_module_name name, int inputs, int index, const bag_registry &reg, hdr_histogram &hist)
+      : sc_module(name), registry(reg), latency(hist), line(index),
+        log(sim_log::instance().source(this->name())), bags_delivered(0), bags_misrouted(0),
+        in("in", inputs) {
+    SC_METHOD(makeup_method);
+    for (sc_fifo_in<bag_msg> &port : in) sensitive << port.data_written();
+    dont_initialize();
+  }
+
+  long get_bags_delivered() const {
+    return bags_delivered;
+  }
+
+  long get_bags_misrouted() const {
+    return bags_misrouted;
+  }
+};
+
+/**
+ * @brief Baggage network module
+ * Elaborates a checked network_description: one sc_vector of modules per node kind,
+ * named after the nodes, and one sc_fifo per link, bound in the order of the links.
+ * The description must outlive the module, the scanners use its make-up line sets.
+ */
+class baggage_network : public sc_module {
+private:
+  const std::vector<network_node> &nodes;
+  bag_registry                     registry;
+  hdr_histogram                    latency; // scan to make-up line
+
+  // nodes of the description of one kind, in the order of their index
+  std::vector<const network_node *> of_kind(int kind) const {
+    std::vector<const network_node *> list;
+
+    for (const network_node &node : nodes) {
+      if (kind == node.kind) list.push_back(&node);
+    }
+    return list;
+  }
+
+public:
+  sc_vector<monitored_fifo<bag_msg> > links; // see fifo_monitor.hpp
+  sc_vector<net_scanner>              scanners;
+  sc_vector<net_belt>                 belts;
+  sc_vector<net_merge>                merges;
+  sc_vector<net_diverter>             diverters;
+  sc_vector<net_makeup>               makeups;
+
+  baggage_network(sc_module_name name, network_description &desc, int seed)
+      : sc_module(name), nodes(desc.get_nodes()),
+        links("link", desc.get_links().size(), [](const char *link_name, size_t) {
+          return new monitored_fifo<bag_msg>(link_name, NETWORK_LINK_DEPTH);
+        }),
+        scanners("scanners"), belts("belts"), merges("merges"), diverters("diverters"), makeups("makeups") {
+    std::vector<const network_node *> list;
+
+    list = of_kind(NODE_SCANNER);
+    scanners.init(list.size(), [&](const char *, size_t i) {
+      return new net_scanner(list[i]->name.c_str(), seed, list[i]->time_ms, registry,
+                             desc.destinations((int)(list[i] - &nodes[0])));
+    });
+    for (size_t i = 0; i < list.size(); i++) scanners[i].out(links[list[i]->outputs[0]]);
+
+    list = of_kind(NODE_BELT);
+    belts.init(list.size(), [&](const char *, size_t i) {
+      return new net_belt(list[i]->name.c_str(), list[i]->time_ms, list[i]->capacity);
+    });
+    for (size_t i = 0; i < list.size(); i++) {
+      belts[i].in(links[list[i]->inputs[0]]);
+      belts[i].out(links[list[i]->outputs[0]]);
+    }
+
+    list = of_kind(NODE_MERGE);
+    merges.init(list.size(), [&](const char *, size_t i) {
+      return new net_merge(list[i]->name.c_str(), (int)list[i]->inputs.size());
+    });
+    for (size_t i = 0; i < list.size(); i++) {
+      for (size_t k = 0; k < list[i]->inputs.size(); k++) merges[i].in[k](links[list[i]->inputs[k]]);
+      merges[i].out(links[list[i]->outputs[0]]);
+    }
+
+    list = of_kind(NODE_DIVERTER);
+    diverters.init(list.size(), [&](const char *, size_t i) {
+      return new net_diverter(list[i]->name.c_str(), (int)list[i]->outputs.size(), registry,
+                              desc.routes((int)(list[i] - &nodes[0])));
+    });
+    for (size_t i = 0; i < list.size(); i++) {
+      diverters[i].in(links[list[i]->inputs[0]]);
+      for (size_t k = 0; k < list[i]->outputs.size(); k++) diverters[i].out[k](links[list[i]->outputs[k]]);
+    }
+
+    list = of_kind(NODE_MAKEUP);
+    makeups.init(list.size(), [&](const char *, size_t i) {
+      return new net_makeup(list[i]->name.c_str(), (int)list[i]->inputs.size(), list[i]->index, registry,
+                            latency);
+    });
+    for (size_t i = 0; i < list.size(); i++) {
+      for (size_t k = 0; k < list[i]->inputs.size(); k++) makeups[i].in[k](links[list[i]->inputs[k]]);
+    }
+  }
+
+  long get_bags_scanned() const {
+    long total = 0;
+
+    for (const net_scanner &node : scanners) total += node.get_bags_scanned();
+    return total;
+  }
+
+  long get_bags_delivered() const {
+    long total = 0;
+
+    for (const net_makeup &node : makeups) total += node.get_bags_delivered();
+    return total;
+  }
+
+  /**
+   * @brief print the network statistics and the scan to make-up line latency
+   *
+   * @param verbosity VERBOSITY_INFO adds the bags of every make-up line
+   */
+  void print_stats(int verbosity) const {
+    long   stalls = 0, misrouted = 0, on_belts = 0;
+    size_t full   = 0;
+
+    for (const net_scanner &node : scanners) stalls += node.get_stalls();
+    for (const net_makeup &node : makeups) misrouted += node.get_bags_misrouted();
+    for (const net_belt &node : belts) {
+      on_belts += (long)node.get_count();
+      if (node.get_max_count() == node.get_capacity()) ++full;
+    }
+
+    printf("\nNetwork:\n");
+    printf("  nodes            = %zu (%zu scanners, %zu belts, %zu merges, %zu diverters, %zu lines)\n",
+           nodes.size(), scanners.size(), belts.size(), merges.size(), diverters.size(), makeups.size());
+    printf("  links            = %zu\n", links.size());
+    printf("  bags scanned     = %ld\n", get_bags_scanned());
+    printf("  bags delivered   = %ld\n", get_bags_delivered());
+    printf("  bags on belts    = %ld\n", on_belts);
+    printf("  bags misrouted   = %ld\n", misrouted);
+    printf("  scanner stalls   = %ld\n", stalls);
+    printf("  belts filled up  = %zu\n", full);
+    if (verbosity >= VERBOSITY_INFO) {
+      for (const net_makeup &node : makeups) {
+        printf("  %-16s = %ld\n", node.basename(), node.get_bags_delivered());
+      }
+    }
+    latency.print("scan to make-up line", sc_get_time_resolution().to_seconds());
+  }
+};
+
+#endif /* NETWORK_HPP_ */
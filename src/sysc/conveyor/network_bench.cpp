@@ -0,0 +1,163 @@
+/*******************************************************************************
+ * Copyright (C) 2023 by Salvador Z                                            *
+ *                                                                             *
+ * This file is part of SYSTEM_MODELS                                          *
+ *                                                                             *
+ *   Permission is hereby granted, free of charge, to any person obtaining a   *
+ *   copy of this software and associated documentation files (the Software)   *
+ *   to deal in the Software without restriction including without limitation  *
+ *   the rights to use, copy, modify, merge, publish, distribute, sublicense,  *
+ *   and/or sell copies ot the Software, and to permit persons to whom the     *
+ *   Software is furnished to do so, subject to the following conditions:      *
+ *                                                                             *
+ *   The above copyright notice and this permission notice shall be included   *
+ *   in all copies or substantial portions of the Software.                    *
+ *                                                                             *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS   *
+ *   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARANTIES OF MERCHANTABILITY *
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL   *
+ *   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR      *
+ *   OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,     *
+ *   ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE        *
+ *   OR OTHER DEALINGS IN THE SOFTWARE.                                        *
+ ******************************************************************************/
+
+
+/**
+ * @file network_bench.cpp
+ * @author Salvador Z
+ * @version 1.0
+ * @brief Benchmark of the baggage network as the number of scanners grows
+ *
+ * Runs the baggage_network binary on a generated network once per scanner count,
+ * with one make-up line per NETWORK_BENCH_SCANNERS_PER_LINE scanners, and reports
+ * the elaboration time, the bags delivered per wall second and the memory per node
+ * taken from the summary line of each run.
+ *
+ * usage: network_bench [-b baggage_network_binary] [-t sim_seconds] [-l scanners_per_line] [scanners ...]
+ */
+
+// Includes
+#include "child_process.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#define NETWORK_BENCH_SIM_SECONDS       100
+#define NETWORK_BENCH_SCANNERS_PER_LINE 4
+
+/**
+ * @brief values parsed from the summary line of one baggage_network run
+ *
+ */
+struct run_result {
+  long   nodes;
+  long   links;
+  long   scanners;
+  long   lines;
+  double sim_time_s;
+  double elaboration_s;
+  double wall_time_s;
+  long   bags_scanned;
+  long   bags_delivered;
+  double bags_per_wall_s;
+  long   max_rss_kb;
+};
+
+/**
+ * @brief run the baggage_network binary and parse its summary line
+ *
+ * @param binary path to the baggage_network executable
+ * @param args command line arguments
+ * @param result parsed summary
+ * @return true when the run finished and printed a summary
+ */
+static bool run_network(const std::string &binary, const std::vector<std::string> &args, run_result &result) {
+  static const char *const keys[] = {"nodes", "links", "scanners", "lines", "sim_time_s", "elaboration_s",
+                                     "wall_time_s", "bags_scanned", "bags_delivered", "bags_per_wall_s",
+                                     "max_rss_kb"};
+  summary_metrics metrics;
+
+  if (!child_run_summary(binary, args, metrics)) return false;
+  for (const char *key : keys) {
+    if (0 == metrics.count(key)) return false;
+  }
+
+  result.nodes           = (long)metrics["nodes"];
+  result.links           = (long)metrics["links"];
+  result.scanners        = (long)metrics["scanners"];
+  result.lines           = (long)metrics["lines"];
+  result.sim_time_s      = metrics["sim_time_s"];
+  result.elaboration_s   = metrics["elaboration_s"];
+  result.wall_time_s     = metrics["wall_time_s"];
+  result.bags_scanned    = (long)metrics["bags_scanned"];
+  result.bags_delivered  = (long)metrics["bags_delivered"];
+  result.bags_per_wall_s = metrics["bags_per_wall_s"];
+  result.max_rss_kb      = (long)metrics["max_rss_kb"];
+  return true;
+}
+
+int main(int argc, char *argv[]) {
+  std::string             binary;
+  int                     sim_seconds       = NETWORK_BENCH_SIM_SECONDS;
+  int                     scanners_per_line = NETWORK_BENCH_SCANNERS_PER_LINE;
+  std::vector<int>        scanner_counts;
+  std::vector<run_result> results;
+  const char             *slash;
+
+  // the baggage_network binary is built next to this one
+  slash  = strrchr(argv[0], '/');
+  binary = slash ? std::string(argv[0], slash - argv[0] + 1) + "baggage_network" : "./baggage_network";
+
+  for (int i = 1; i < argc; ++i) {
+    if ((0 == strcmp(argv[i], "-b")) && (i + 1 < argc)) {
+      binary = argv[++i];
+    } else if ((0 == strcmp(argv[i], "-t")) && (i + 1 < argc)) {
+      sim_seconds = atoi(argv[++i]);
+    } else if ((0 == strcmp(argv[i], "-l")) && (i + 1 < argc)) {
+      scanners_per_line = atoi(argv[++i]);
+    } else {
+      scanner_counts.push_back(atoi(argv[i]));
+    }
+  }
+
+  if (scanner_counts.empty()) scanner_counts = {10, 100, 1000, 4000};
+  if (sim_seconds < 1) sim_seconds = 1;
+  if (scanners_per_line < 1) scanners_per_line = 1;
+
+  printf("network_bench: %s, %d simulated second(s) per run, %d scanner(s) per make-up line\n\n",
+         binary.c_str(), sim_seconds, scanners_per_line);
+  printf("%10s %8s %8s %10s %10s %12s %12s %14s %12s %10s\n", "scanners", "lines", "nodes", "elab [s]",
+         "wall [s]", "scanned", "delivered", "bags/wall s", "max rss [KB]", "KB/node");
+
+  for (int scanners : scanner_counts) {
+    run_result result;
+    double     kb_per_node = 0.0;
+    int        lines       = std::max(scanners / scanners_per_line, 1);
+
+    std::vector<std::string> args = {"--generate", std::to_string(scanners), std::to_string(lines), "--time",
+                                     std::to_string(sim_seconds)};
+
+    if (!run_network(binary, args, result)) {
+      printf("%10d %8s %8s %10s\n", scanners, "", "", "failed");
+      continue;
+    }
+
+    // memory per node relative to the smallest run, so the fixed cost of the kernel is left out
+    if (!results.empty() && (result.nodes > results.front().nodes)) {
+      kb_per_node =
+          (double)(result.max_rss_kb - results.front().max_rss_kb) / (result.nodes - results.front().nodes);
+    }
+    results.push_back(result);
+
+    printf("%10ld %8ld %8ld %10.3f %10.3f %12ld %12ld %14.0f %12ld %10.2f\n", result.scanners, result.lines,
+           result.nodes, result.elaboration_s, result.wall_time_s, result.bags_scanned, result.bags_delivered,
+           result.bags_per_wall_s, result.max_rss_kb, kb_per_node);
+    fflush(stdout);
+  }
+
+  return 0;
+}
@@ -0,0 +1,479 @@
+/*******************************************************************************
+ * Copyright (C) 2023 by Salvador Z                                            *
+ *                                                                             *
+ * This file is part of SYSTEM_MODELS                                          *
+ *                                                                             *
+ *   Permission is hereby granted, free of charge, to any person obtaining a   *
+ *   copy of this software and associated documentation files (the Software)   *
+ *   to deal in the Software without restriction including without limitation  *
+ *   the rights to use, copy, modify, merge, publish, distribute, sublicense,  *
+ *   and/or sell copies ot the Software, and to permit persons to whom the     *
+ *   Software is furnished to do so, subject to the following conditions:      *
+ *                                                                             *
+ *   The above copyright notice and this permission notice shall be included   *
+ *   in all copies or substantial portions of the Software.                    *
+ *                                                                             *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS   *
+ *   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARANTIES OF MERCHANTABILITY *
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL   *
+ *   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR      *
+ *   OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,     *
+ *   ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE        *
+ *   OR OTHER DEALINGS IN THE SOFTWARE.                                        *
+ ******************************************************************************/
+
+
+/**
+ * @file network_description.hpp
+ * @author Salvador Z
+ * @version 1.0
+ * @brief File for the description of a baggage handling network
+ *
+ * A network is a graph of scanners, belts, merges, diverters and make-up lines.
+ * It is read from a text file, one node or link per line, '#' starts a comment:
+ *
+ *   scanner  NAME [period_ms]            one bag every period_ms on average (default 1000)
+ *   belt     NAME transit_ms [capacity]  bags on the belt at most (default 16)
+ *   merge    NAME                        any number of inputs, one output
+ *   diverter NAME                        one input, routes every bag to an output reaching its make-up line
+ *   makeup   NAME                        any number of inputs, end of the bags
+ *   link     FROM TO
+ *
+ * or generated (generate()) as check-in belts merged into one sorter that diverts
+ * to the make-up lines.
+ */
+
+#ifndef NETWORK_DESCRIPTION_HPP_
+#define NETWORK_DESCRIPTION_HPP_
+
+// Includes
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iterator>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#define NETWORK_SCANNER_PERIOD_MS 1000 // default time between two bags of a scanner
+#define NETWORK_BELT_CAPACITY     16   // default bags on a belt
+#define NETWORK_FAN_IN            4    // inputs of a generated merge
+#define NETWORK_FAN_OUT           4    // outputs of a generated diverter
+#define NETWORK_CHECKIN_MS        5000 // transit of a generated check-in belt
+#define NETWORK_SORTER_MS         2000 // transit of the other generated belts
+
+// node kinds
+#define NODE_SCANNER  0
+#define NODE_BELT     1
+#define NODE_MERGE    2
+#define NODE_DIVERTER 3
+#define NODE_MAKEUP   4
+#define NODE_KINDS    5
+
+static const char *const node_kind_names[NODE_KINDS] = {"scanner", "belt", "merge", "diverter", "makeup"};
+
+/**
+ * @brief one node of the network
+ *
+ */
+struct network_node {
+  int              kind;
+  std::string      name;
+  int              time_ms;  // scanner period or belt transit
+  int              capacity; // belt
+  int              index;    // among the nodes of its kind
+  std::vector<int> inputs;   // link indexes
+  std::vector<int> outputs;
+};
+
+/**
+ * @brief one link, a fifo from the output of a node to the input of another
+ *
+ */
+struct network_link {
+  int from;
+  int to;
+};
+
+/**
+ * @brief Class network_description
+ * Nodes and links of a network, checked by check() before the network is built.
+ * Also computes what the built network needs to route the bags: the make-up lines
+ * a scanner reaches and, per diverter, the output that reaches each make-up line.
+ */
+class network_description {
+private:
+  std::vector<network_node>  nodes;
+  std::vector<network_link>  links;
+  std::map<std::string, int> by_name;
+  int                        kind_count[NODE_KINDS];
+
+  // make-up lines reached from the diverters and make-up lines, see reach()
+  std::vector<std::vector<int> > reach_sets;
+  std::vector<bool>              reach_done;
+
+  static bool valid_name(const char *name) {
+    if (!*name) return false;
+    for (; *name; name++) {
+      if (!isalnum((unsigned char)*name) && ('_' != *name)) return false;
+    }
+    return true;
+  }
+
+  // first node from node that does not have exactly one output, -1 on a loop (rejected by check())
+  int branch_of(int node) const {
+    for (size_t steps = 0; steps <= nodes.size(); steps++) {
+      if (1 != nodes[node].outputs.size()) return node;
+      node = links[nodes[node].outputs[0]].to;
+    }
+    return -1;
+  }
+
+  /**
+   * @brief make-up lines reached from a diverter or a make-up line, sorted, memoized
+   * Only called on a graph without loops, so every memoized set is complete.
+   */
+  const std::vector<int> &reach(int node) {
+    std::vector<int> &set = reach_sets[node];
+    int               branch;
+
+    if (reach_done[node]) return set;
+
+    if (NODE_MAKEUP == nodes[node].kind) set.push_back(nodes[node].index);
+    for (int link : nodes[node].outputs) {
+      branch = branch_of(links[link].to);
+      if (branch < 0) continue;
+
+      const std::vector<int> &next = reach(branch);
+      std::vector<int>        merged;
+
+      std::set_union(set.begin(), set.end(), next.begin(), next.end(), std::back_inserter(merged));
+      set.swap(merged);
+    }
+    reach_done[node] = true;
+    return set;
+  }
+
+  /**
+   * @brief find a loop, a bag on it could circle for ever and full belts on it hold each other back
+   *
+   * @return a node on a loop, -1 when there is none
+   */
+  int find_loop() const {
+    std::vector<int>                  state(nodes.size(), 0); // 0 not seen, 1 on the path, 2 done
+    std::vector<std::pair<int, int> > path;                   // node and next output to follow
+
+    for (int start = 0; start < (int)nodes.size(); start++) {
+      if (0 != state[start]) continue;
+      state[start] = 1;
+      path.push_back({start, 0});
+
+      while (!path.empty()) {
+        int node = path.back().first;
+        int k    = path.back().second++;
+
+        if (k == (int)nodes[node].outputs.size()) {
+          state[node] = 2;
+          path.pop_back();
+          continue;
+        }
+
+        int next = links[nodes[node].outputs[k]].to;
+        if (1 == state[next]) return next;
+        if (0 == state[next]) {
+          state[next] = 1;
+          path.push_back({next, 0});
+        }
+      }
+    }
+    return -1;
+  }
+
+  // line 0 for the errors of the whole graph
+  bool error(const char *path, int line, const char *what, const std::string &name = "") const {
+    if (line > 0) {
+      fprintf(stderr, "%s:%d: %s%s%s\n", path, line, what, name.empty() ? "" : " ", name.c_str());
+    } else {
+      fprintf(stderr, "%s: %s%s%s\n", path, what, name.empty() ? "" : " ", name.c_str());
+    }
+    return false;
+  }
+
+public:
+  network_description() {
+    clear();
+  }
+
+  void clear() {
+    nodes.clear();
+    links.clear();
+    by_name.clear();
+    memset(kind_count, 0, sizeof(kind_count));
+  }
+
+  /**
+   * @brief add a node
+   *
+   * @return index of the node, -1 when the name is taken or not made of [A-Za-z0-9_]
+   */
+  int add_node(int kind, const std::string &name, int time_ms = 0, int capacity = NETWORK_BELT_CAPACITY) {
+    network_node node;
+
+    if (!valid_name(name.c_str()) || by_name.count(name)) return -1;
+
+    node.kind     = kind;
+    node.name     = name;
+    node.time_ms  = time_ms;
+    node.capacity = capacity;
+    node.index    = kind_count[kind]++;
+    by_name[name] = (int)nodes.size();
+    nodes.push_back(node);
+    return (int)nodes.size() - 1;
+  }
+
+  void add_link(int from, int to) {
+    nodes[from].outputs.push_back((int)links.size());
+    nodes[to].inputs.push_back((int)links.size());
+    links.push_back({from, to});
+  }
+
+  /**
+   * @brief read a description file
+   *
+   * @return false on the first error, reported on stderr with its line
+   */
+  bool read(const char *path) {
+    FILE *file = fopen(path, "r");
+    char  text[512], word[64], name[64], to[64];
+    int   line = 0, values[2], fields, kind;
+
+    if (nullptr == file) {
+      perror(path);
+      return false;
+    }
+    clear();
+
+    while (fgets(text, sizeof(text), file)) {
+      ++line;
+      if (char *comment = strchr(text, '#')) *comment = '\0';
+      if (1 != sscanf(text, "%63s", word)) continue;
+
+      if (0 == strcmp(word, "link")) {
+        if ((3 != sscanf(text, "%63s %63s %63s", word, name, to)) || !by_name.count(name) ||
+            !by_name.count(to)) {
+          fclose(file);
+          return error(path, line, "link needs two declared nodes");
+        }
+        add_link(by_name[name], by_name[to]);
+        continue;
+      }
+
+      for (kind = 0; (kind < NODE_KINDS) && (0 != strcmp(word, node_kind_names[kind])); kind++) {}
+      values[0] = (NODE_SCANNER == kind) ? NETWORK_SCANNER_PERIOD_MS : 0;
+      values[1] = NETWORK_BELT_CAPACITY;
+      fields    = sscanf(text, "%63s %63s %d %d", word, name, &values[0], &values[1]);
+
+      if (NODE_KINDS == kind) {
+        fclose(file);
+        return error(path, line, "expected scanner, belt, merge, diverter, makeup or link, got", word);
+      }
+      if ((fields < 2) || ((NODE_BELT == kind) && (fields < 3))) {
+        fclose(file);
+        return error(path, line, "missing name or transit time of", word);
+      }
+      if ((values[0] < 0) || (values[1] < 1) || ((NODE_SCANNER == kind) && (values[0] < 1))) {
+        fclose(file);
+        return error(path, line, "bad period, transit or capacity of", name);
+      }
+      if (add_node(kind, name, values[0], values[1]) < 0) {
+        fclose(file);
+        return error(path, line, "duplicate or invalid name", name);
+      }
+    }
+    fclose(file);
+    return check(path);
+  }
+
+  /**
+   * @brief write the description in the file format
+   *
+   */
+  bool write(const char *path) const {
+    FILE *file = fopen(path, "w");
+
+    if (nullptr == file) {
+      perror(path);
+      return false;
+    }
+    fprintf(file, "# %zu nodes, %zu links\n", nodes.size(), links.size());
+    for (const network_node &node : nodes) {
+      fprintf(file, "%-8s %s", node_kind_names[node.kind], node.name.c_str());
+      if (NODE_SCANNER == node.kind) fprintf(file, " %d", node.time_ms);
+      if (NODE_BELT == node.kind) fprintf(file, " %d %d", node.time_ms, node.capacity);
+      fprintf(file, "\n");
+    }
+    for (const network_link &link : links) {
+      fprintf(file, "link %s %s\n", nodes[link.from].name.c_str(), nodes[link.to].name.c_str());
+    }
+    return 0 == fclose(file);
+  }
+
+  /**
+   * @brief generate a hall: every scanner feeds a check-in belt, the check-in belts are
+   * merged NETWORK_FAN_IN at a time onto one sorter belt, which is diverted
+   * NETWORK_FAN_OUT ways at a time to the make-up lines
+   * The belt capacities follow the bags they carry, so the sorter does not limit the flow.
+   *
+   * @param scanners number of scanners
+   * @param lines number of make-up lines
+   * @param period_ms time between two bags of a scanner
+   * @return false, and an empty description, unless all three are at least 1
+   */
+  bool generate(int scanners, int lines, int period_ms = NETWORK_SCANNER_PERIOD_MS) {
+    std::vector<int> level, next;
+    int              node, belt, merges = 0, diverters = 0, belts = 0;
+    const double     bags_per_ms = 1.0 / period_ms;
+
+    // capacity of a belt carrying the bags of n scanners, twice the bags in transit
+    auto capacity = [bags_per_ms](double n, int transit_ms) {
+      return std::max(NETWORK_BELT_CAPACITY, (int)(2.0 * n * bags_per_ms * transit_ms + 0.5));
+    };
+
+    clear();
+    if ((scanners < 1) || (lines < 1) || (period_ms < 1)) return false;
+
+    for (int i = 0; i < scanners; i++) {
+      node = add_node(NODE_SCANNER, "scanner_" + std::to_string(i), period_ms);
+      belt = add_node(NODE_BELT, "checkin_" + std::to_string(i), NETWORK_CHECKIN_MS,
+                      capacity(1, NETWORK_CHECKIN_MS));
+      add_link(node, belt);
+      level.push_back(belt);
+    }
+
+    // merge tree, one belt after every merge
+    for (int width = 1; level.size() > 1; level.swap(next)) {
+      width *= NETWORK_FAN_IN;
+      next.clear();
+      for (size_t i = 0; i < level.size(); i += NETWORK_FAN_IN) {
+        node = add_node(NODE_MERGE, "merge_" + std::to_string(merges++));
+        for (size_t j = i; (j < i + NETWORK_FAN_IN) && (j < level.size()); j++) add_link(level[j], node);
+        belt = add_node(NODE_BELT, "belt_" + std::to_string(belts++), NETWORK_SORTER_MS,
+                        capacity(std::min(width, scanners), NETWORK_SORTER_MS));
+        add_link(node, belt);
+        next.push_back(belt);
+      }
+    }
+
+    // diverter tree over the make-up line ranges [first, last)
+    struct range {
+      int from, first, last;
+    };
+    std::vector<range> todo = {{level[0], 0, lines}};
+
+    while (!todo.empty()) {
+      range r = todo.back();
+      todo.pop_back();
+
+      if (1 == r.last - r.first) {
+        node = add_node(NODE_MAKEUP, "makeup_" + std::to_string(r.first));
+        add_link(r.from, node);
+        continue;
+      }
+
+      node = add_node(NODE_DIVERTER, "diverter_" + std::to_string(diverters++));
+      add_link(r.from, node);
+      for (int k = 0; k < NETWORK_FAN_OUT; k++) {
+        int first = r.first + (r.last - r.first) * k / NETWORK_FAN_OUT;
+        int last  = r.first + (r.last - r.first) * (k + 1) / NETWORK_FAN_OUT;
+
+        if (first == last) continue;
+        belt = add_node(NODE_BELT, "belt_" + std::to_string(belts++), NETWORK_SORTER_MS,
+                        capacity((double)scanners * (last - first) / lines, NETWORK_SORTER_MS));
+        add_link(node, belt);
+        todo.push_back({belt, first, last});
+      }
+    }
+    return true;
+  }
+
+  /**
+   * @brief check the inputs and outputs of every node, that there is no loop and that every
+   * scanner reaches a make-up line
+   *
+   * @param path reported with the errors
+   */
+  bool check(const char *path) {
+    static const int min_inputs[NODE_KINDS]  = {0, 1, 1, 1, 1};
+    static const int max_inputs[NODE_KINDS]  = {0, 1, INT32_MAX, 1, INT32_MAX};
+    static const int min_outputs[NODE_KINDS] = {1, 1, 1, 1, 0};
+    static const int max_outputs[NODE_KINDS] = {1, 1, 1, INT32_MAX, 0};
+    int              loop;
+
+    for (const network_node &node : nodes) {
+      int in = (int)node.inputs.size(), out = (int)node.outputs.size();
+
+      if ((in < min_inputs[node.kind]) || (in > max_inputs[node.kind]) || (out < min_outputs[node.kind]) ||
+          (out > max_outputs[node.kind])) {
+        return error(path, 0, "wrong number of links for", node_kind_names[node.kind] + (" " + node.name));
+      }
+    }
+    if ((0 == kind_count[NODE_SCANNER]) || (0 == kind_count[NODE_MAKEUP])) {
+      return error(path, 0, "a network needs scanners and make-up lines");
+    }
+
+    loop = find_loop();
+    if (loop >= 0) return error(path, 0, "loop through", nodes[loop].name);
+
+    reach_sets.assign(nodes.size(), std::vector<int>());
+    reach_done.assign(nodes.size(), false);
+    for (const network_node &node : nodes) {
+      if ((NODE_SCANNER == node.kind) && (destinations(by_name[node.name]).empty())) {
+        return error(path, 0, "no make-up line reached from", node.name);
+      }
+    }
+    return true;
+  }
+
+  /**
+   * @brief make-up lines reached from a node, the scanners draw the destination of their bags from it
+   * Nodes with one output share the set of the first branch after them.
+   */
+  const std::vector<int> &destinations(int node) {
+    static const std::vector<int> none;
+    int                           branch = branch_of(node);
+
+    return (branch < 0) ? none : reach(branch);
+  }
+
+  /**
+   * @brief output of a diverter to take for each make-up line, -1 when not reached
+   *
+   */
+  std::vector<int> routes(int diverter) {
+    std::vector<int> table(kind_count[NODE_MAKEUP], -1);
+
+    for (size_t k = 0; k < nodes[diverter].outputs.size(); k++) {
+      for (int line : destinations(links[nodes[diverter].outputs[k]].to)) {
+        if (table[line] < 0) table[line] = (int)k;
+      }
+    }
+    return table;
+  }
+
+  const std::vector<network_node> &get_nodes() const {
+    return nodes;
+  }
+
+  const std::vector<network_link> &get_links() const {
+    return links;
+  }
+
+  int get_count(int kind) const {
+    return kind_count[kind];
+  }
+};
+
+#endif /* NETWORK_DESCRIPTION_HPP_ */
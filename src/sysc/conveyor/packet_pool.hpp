@@ -0,0 +1,354 @@
+/*******************************************************************************
+ * Copyright (C) 2023 by Salvador Z                                            *
+ *                                                                             *
+ * This file is part of SYSTEM_MODELS                                          *
+ *                                                                             *
+ *   Permission is hereby granted, free of charge, to any person obtaining a   *
+ *   copy of this software and associated documentation files (the Software)   *
+ *   to deal in the Software without restriction including without limitation  *
+ *   the rights to use, copy, modify, merge, publish, distribute, sublicense,  *
+ *   and/or sell copies ot the Software, and to permit persons to whom the     *
+ *   Software is furnished to do so, subject to the following conditions:      *
+ *                                                                             *
+ *   The above copyright notice and this permission notice shall be included   *
+ *   in all copies or substantial portions of the Software.                    *
+ *                                                                             *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS   *
+ *   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARANTIES OF MERCHANTABILITY *
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL   *
+ *   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR      *
+ *   OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,     *
+ *   ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE        *
+ *   OR OTHER DEALINGS IN THE SOFTWARE.                                        *
+ ******************************************************************************/
+
+
+/**
+ * @file packet_pool.hpp
+ * @author Salvador Z
+ * @version 1.0
+ * @brief File for the packet pool used to transport status and control packets
+ *
+ */
+
+#ifndef PACKET_POOL_HPP_
+#define PACKET_POOL_HPP_
+
+// Includes
+#include <cstddef>
+#include <cstdio>
+#include <new>
+#include <utility>
+#include <vector>
+
+#define PACKET_POOL_SLAB_SIZE 64 // packets per slab
+
+// Packets move through the sc_fifos as pool pointers (0) or by value (1)
+#ifndef PACKET_TRANSPORT_BY_VALUE
+#define PACKET_TRANSPORT_BY_VALUE 0
+#endif
+
+// By value transport of the packed forms (1), see wire_format.hpp
+#ifndef PACKET_TRANSPORT_PACKED
+#define PACKET_TRANSPORT_PACKED 0
+#endif
+
+/**
+ * @brief Class packet_pool
+ * Fixed size slabs of packets of one type. Free packets are kept in an intrusive
+ * free list, the heap is only touched when the pool runs out of free packets.
+ * One pool exists per packet type, see instance().
+ */
+template <typename T, std::size_t SLAB_SIZE = PACKET_POOL_SLAB_SIZE>
+class packet_pool {
+private:
+  union node {
+    node *next;
+    alignas(T) unsigned char storage[sizeof(T)];
+  };
+
+  struct slab {
+    node nodes[SLAB_SIZE];
+  };
+
+  std::vector<slab *> slabs;
+  node               *free_list;
+
+  std::size_t heap_allocs; // number of slab allocations
+  std::size_t acquires;
+  std::size_t releases;
+  std::size_t in_use;
+  std::size_t high_water; // max number of packets in use at the same time
+
+  void grow() {
+    slab *new_slab = new slab;
+    ++heap_allocs;
+    slabs.push_back(new_slab);
+
+    // thread the new nodes into the free list
+    for (std::size_t i = 0; i < SLAB_SIZE; ++i) {
+      new_slab->nodes[i].next = free_list;
+      free_list               = &new_slab->nodes[i];
+    }
+  }
+
+  packet_pool() : free_list(nullptr), heap_allocs(0), acquires(0), releases(0), in_use(0), high_water(0) {}
+
+public:
+  packet_pool(const packet_pool &)            = delete;
+  packet_pool &operator=(const packet_pool &) = delete;
+
+  ~packet_pool() {
+    for (slab *s : slabs) delete s;
+  }
+
+  static packet_pool &instance() {
+    static packet_pool pool;
+    return pool;
+  }
+
+  /**
+   * @brief get a default constructed packet from the pool
+   *
+   * @return T* packet, must be given back with release()
+   */
+  T *acquire() {
+    node *n;
+
+    if (nullptr == free_list) grow();
+
+    n         = free_list;
+    free_list = n->next;
+
+    ++acquires;
+    if (++in_use > high_water) high_water = in_use;
+
+    return new (n->storage) T();
+  }
+
+  /**
+   * @brief give a packet back to the pool
+   *
+   * @param pkt packet obtained with acquire()
+   */
+  void release(T *pkt) {
+    node *n;
+
+    if (nullptr == pkt) return;
+
+    pkt->~T();
+    n         = reinterpret_cast<node *>(pkt);
+    n->next   = free_list;
+    free_list = n;
+
+    ++releases;
+    --in_use;
+  }
+
+  /**
+   * @brief pre-allocate slabs so that count packets are available without touching the heap
+   *
+   * @param count number of packets
+   */
+  void reserve(std::size_t count) {
+    while (slabs.size() * SLAB_SIZE < count) grow();
+  }
+
+  std::size_t get_heap_allocs() const {
+    return heap_allocs;
+  }
+
+  std::size_t get_in_use() const {
+    return in_use;
+  }
+
+  std::size_t get_high_water() const {
+    return high_water;
+  }
+
+  void print_stats(const char *name) const {
+    printf("packet_pool<%s>:\n", name);
+    printf("  slab allocations = %zu (%zu packets)\n", heap_allocs, slabs.size() * SLAB_SIZE);
+    printf("  acquires         = %zu\n", acquires);
+    printf("  releases         = %zu\n", releases);
+    printf("  in use           = %zu\n", in_use);
+    printf("  high water mark  = %zu\n", high_water);
+  }
+};
+
+#if PACKET_TRANSPORT_BY_VALUE
+
+// Type carried by the sc_fifos
+template <typename T>
+using packet_msg = T;
+
+/**
+ * @brief Class packet_ptr
+ * Packet handle for the value transport, the packet lives inside the handle
+ * and is copied into and out of the sc_fifos.
+ */
+template <typename T>
+class packet_ptr {
+private:
+  T pkt;
+
+public:
+  packet_ptr() {}
+  explicit packet_ptr(const packet_msg<T> &msg) : pkt(msg) {}
+
+  T *operator->() {
+    return &pkt;
+  }
+
+  T &operator*() {
+    return pkt;
+  }
+
+  T *get() {
+    return &pkt;
+  }
+
+  // value to write into the fifo
+  packet_msg<T> send() {
+    return pkt;
+  }
+
+  // copy the packet into the pool for long term storage
+  T *detach() {
+    T *p = packet_pool<T>::instance().acquire();
+    *p   = pkt;
+    return p;
+  }
+};
+
+// packet carried by a message, without taking it over
+template <typename T>
+const T &packet_of(const packet_msg<T> &msg) {
+  return msg;
+}
+
+#elif PACKET_TRANSPORT_PACKED
+
+// specialized for every packet type in wire_format.hpp
+template <typename T>
+struct wire_traits;
+
+// Type carried by the sc_fifos
+template <typename T>
+using packet_msg = typename wire_traits<T>::packed_type;
+
+/**
+ * @brief Class packet_ptr
+ * Packet handle for the packed transport, the packet is decoded from the
+ * message it is built from and encoded again by send().
+ */
+template <typename T>
+class packet_ptr {
+private:
+  T pkt;
+
+public:
+  packet_ptr() {}
+  explicit packet_ptr(const packet_msg<T> &msg) {
+    wire_traits<T>::decode(msg, pkt);
+  }
+
+  T *operator->() {
+    return &pkt;
+  }
+
+  T &operator*() {
+    return pkt;
+  }
+
+  T *get() {
+    return &pkt;
+  }
+
+  // value to write into the fifo
+  packet_msg<T> send() {
+    return wire_traits<T>::encode(pkt);
+  }
+
+  // copy the packet into the pool for long term storage
+  T *detach() {
+    T *p = packet_pool<T>::instance().acquire();
+    *p   = pkt;
+    return p;
+  }
+};
+
+// packet carried by a message, decoded into a copy
+template <typename T>
+T packet_of(const packet_msg<T> &msg) {
+  T pkt;
+
+  wire_traits<T>::decode(msg, pkt);
+  return pkt;
+}
+
+#else
+
+// Type carried by the sc_fifos
+template <typename T>
+using packet_msg = T *;
+
+/**
+ * @brief Class packet_ptr
+ * RAII handle of a pooled packet. The packet goes back to its pool when
+ * the handle is destroyed, unless ownership was handed over with send() or detach().
+ */
+template <typename T>
+class packet_ptr {
+private:
+  T *pkt;
+
+public:
+  packet_ptr() : pkt(packet_pool<T>::instance().acquire()) {}
+  explicit packet_ptr(const packet_msg<T> &msg) : pkt(msg) {}
+
+  packet_ptr(const packet_ptr &)            = delete;
+  packet_ptr &operator=(const packet_ptr &) = delete;
+
+  packet_ptr(packet_ptr &&other) : pkt(other.pkt) {
+    other.pkt = nullptr;
+  }
+
+  ~packet_ptr() {
+    packet_pool<T>::instance().release(pkt);
+  }
+
+  T *operator->() {
+    return pkt;
+  }
+
+  T &operator*() {
+    return *pkt;
+  }
+
+  T *get() {
+    return pkt;
+  }
+
+  // hand the packet over to the fifo, the receiver adopts it with packet_ptr(msg)
+  packet_msg<T> send() {
+    T *p = pkt;
+    pkt  = nullptr;
+    return p;
+  }
+
+  // keep the packet for long term storage, give it back with packet_pool<T>::release()
+  T *detach() {
+    return send();
+  }
+};
+
+// packet carried by a message, without taking it over
+template <typename T>
+const T &packet_of(const packet_msg<T> &msg) {
+  return *msg;
+}
+
+#endif /* PACKET_TRANSPORT_BY_VALUE */
+
+#endif /* PACKET_POOL_HPP_ */
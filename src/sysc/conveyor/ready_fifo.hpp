@@ -0,0 +1,135 @@
+/*******************************************************************************
+ * Copyright (C) 2023 by Salvador Z                                            *
+ *                                                                             *
+ * This file is part of SYSTEM_MODELS                                          *
+ *                                                                             *
+ *   Permission is hereby granted, free of charge, to any person obtaining a   *
+ *   copy of this software and associated documentation files (the Software)   *
+ *   to deal in the Software without restriction including without limitation  *
+ *   the rights to use, copy, modify, merge, publish, distribute, sublicense,  *
+ *   and/or sell copies ot the Software, and to permit persons to whom the     *
+ *   Software is furnished to do so, subject to the following conditions:      *
+ *                                                                             *
+ *   The above copyright notice and this permission notice shall be included   *
+ *   in all copies or substantial portions of the Software.                    *
+ *                                                                             *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS   *
+ *   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARANTIES OF MERCHANTABILITY *
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL   *
+ *   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR      *
+ *   OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,     *
+ *   ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE        *
+ *   OR OTHER DEALINGS IN THE SOFTWARE.                                        *
+ ******************************************************************************/
+
+
+/**
+ * @file ready_fifo.hpp
+ * @author Salvador Z
+ * @version 1.0
+ * @brief File for the sc_fifo that reports writes to a ready queue
+ *
+ */
+
+#ifndef READY_FIFO_HPP_
+#define READY_FIFO_HPP_
+
+// Includes
+#include "sim_profile.hpp"
+#include <algorithm>
+#include <systemc.h>
+#include <vector>
+
+/**
+ * @brief Class ready_queue
+ * List of the fifos (by index) that received data since the reader last looked at them.
+ * A fifo is queued only once until the reader clears it, so the cost of the reader
+ * follows the number of fifos with data and not the number of fifos.
+ */
+class ready_queue {
+private:
+  std::vector<int>  ready;  // queued indexes, in order of arrival
+  std::vector<char> queued; // 1 when the index is in the ready list
+  sc_event          ready_event;
+
+public:
+  ready_queue() : ready_event("ready_event") {}
+
+  void resize(int size) {
+    queued.assign(size, 0);
+    ready.clear();
+    ready.reserve(size);
+  }
+
+  /**
+   * @brief queue a fifo and wake up the reader, called from the fifo update phase
+   *
+   * @param index fifo index
+   */
+  void mark(int index) {
+    if (!queued[index]) {
+      queued[index] = 1;
+      ready.push_back(index);
+    }
+    ready_event.notify(SC_ZERO_TIME);
+  }
+
+  /**
+   * @brief move the queued indexes to list, sorted so the reader sees them in a deterministic order
+   *
+   * @param list receives the queued indexes, the indexes stay marked until clear()
+   */
+  void take(std::vector<int> &list) {
+    list.clear();
+    list.swap(ready);
+    std::sort(list.begin(), list.end());
+  }
+
+  // put back an index taken with take() that still has data
+  void requeue(int index) {
+    ready.push_back(index);
+  }
+
+  // the reader emptied the fifo
+  void clear(int index) {
+    queued[index] = 0;
+  }
+
+  bool empty() const {
+    return ready.empty();
+  }
+
+  const sc_event &get_ready_event() const {
+    return ready_event;
+  }
+};
+
+/**
+ * @brief Class ready_fifo
+ * sc_fifo that queues its index in a ready_queue every time data is written to it.
+ */
+template <typename T>
+class ready_fifo : public profile_fifo<T> {
+private:
+  ready_queue *queue;
+  int          index;
+
+public:
+  explicit ready_fifo(const char *name, int size = 16)
+      : profile_fifo<T>(name, size), queue(nullptr), index(0) {}
+
+  void attach(ready_queue *q, int i) {
+    queue = q;
+    index = i;
+  }
+
+protected:
+  virtual void update() {
+    if ((nullptr != queue) && (this->m_num_written > 0)) {
+      queue->mark(index);
+    }
+    profile_fifo<T>::update();
+  }
+};
+
+#endif /* READY_FIFO_HPP_ */
@@ -0,0 +1,277 @@
+/*******************************************************************************
+ * Copyright (C) 2023 by Salvador Z                                            *
+ *                                                                             *
+ * This file is part of SYSTEM_MODELS                                          *
+ *                                                                             *
+ *   Permission is hereby granted, free of charge, to any person obtaining a   *
+ *   copy of this software and associated documentation files (the Software)   *
+ *   to deal in the Software without restriction including without limitation  *
+ *   the rights to use, copy, modify, merge, publish, distribute, sublicense,  *
+ *   and/or sell copies ot the Software, and to permit persons to whom the     *
+ *   Software is furnished to do so, subject to the following conditions:      *
+ *                                                                             *
+ *   The above copyright notice and this permission notice shall be included   *
+ *   in all copies or substantial portions of the Software.                    *
+ *                                                                             *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS   *
+ *   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARANTIES OF MERCHANTABILITY *
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL   *
+ *   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR      *
+ *   OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,     *
+ *   ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE        *
+ *   OR OTHER DEALINGS IN THE SOFTWARE.                                        *
+ ******************************************************************************/
+
+
+/**
+ * @file telemetry.hpp
+ * @author Salvador Z
+ * @version 1.0
+ * @brief File for the binary columnar telemetry recorder of conveyor status packets
+ *
+ * File layout, every part is 8 byte aligned so the file can be mmap'ed:
+ *   telemetry_file_header
+ *   telemetry_column_desc x num_columns
+ *   blocks: telemetry_block_header, then each column as rows values (padded to 8 bytes)
+ */
+
+#ifndef TELEMETRY_HPP_
+#define TELEMETRY_HPP_
+
+// Includes
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#define TELEMETRY_MAGIC         "CNVTLM\0"
+#define TELEMETRY_VERSION       1
+#define TELEMETRY_BLOCK_MAGIC   0x4B4C4254 // "TBLK"
+#define TELEMETRY_BLOCK_ROWS    65536      // rows per column buffer
+#define TELEMETRY_NUM_BLOCKS    4          // buffers shared by the recorder and the writer thread
+#define TELEMETRY_NUM_COLUMNS   5
+#define TELEMETRY_NAME_LEN      24
+
+// column value types
+#define TELEMETRY_TYPE_U64 0
+#define TELEMETRY_TYPE_U32 1
+#define TELEMETRY_TYPE_I32 2
+#define TELEMETRY_TYPE_I16 3
+
+struct telemetry_file_header {
+  char     magic[8];
+  uint32_t version;
+  uint32_t num_columns;
+  uint64_t time_resolution_fs; // one timestamp tick in femtoseconds
+};
+
+struct telemetry_column_desc {
+  char     name[TELEMETRY_NAME_LEN];
+  uint32_t type;
+  uint32_t width; // bytes per value
+};
+
+struct telemetry_block_header {
+  uint32_t magic;
+  uint32_t rows;
+};
+
+static_assert(sizeof(telemetry_file_header) % 8 == 0, "telemetry header must keep 8 byte alignment");
+static_assert(sizeof(telemetry_column_desc) % 8 == 0, "telemetry column must keep 8 byte alignment");
+static_assert(sizeof(telemetry_block_header) % 8 == 0, "telemetry block must keep 8 byte alignment");
+
+// schema of the conveyor status telemetry, in column order
+static const telemetry_column_desc telemetry_columns[TELEMETRY_NUM_COLUMNS] = {
+    {"timestamp", TELEMETRY_TYPE_U64, 8},   {"segment_id", TELEMETRY_TYPE_I32, 4},
+    {"encoder_count", TELEMETRY_TYPE_U32, 4}, {"temperature", TELEMETRY_TYPE_I16, 2},
+    {"vibration", TELEMETRY_TYPE_I16, 2},
+};
+
+// bytes of a column of rows values, padded to 8 bytes
+inline size_t telemetry_column_bytes(uint32_t width, uint32_t rows) {
+  return ((size_t)width * rows + 7) & ~(size_t)7;
+}
+
+/**
+ * @brief Class telemetry_recorder
+ * Appends conveyor status values to preallocated column buffers. Full buffers are
+ * handed to a writer thread that appends them to the file, so the simulation only
+ * waits when every buffer is waiting to be written.
+ */
+class telemetry_recorder {
+private:
+  struct block {
+    uint32_t rows;
+    uint64_t timestamp[TELEMETRY_BLOCK_ROWS];
+    int32_t  segment_id[TELEMETRY_BLOCK_ROWS];
+    uint32_t encoder_count[TELEMETRY_BLOCK_ROWS];
+    int16_t  temperature[TELEMETRY_BLOCK_ROWS];
+    int16_t  vibration[TELEMETRY_BLOCK_ROWS];
+  };
+
+  FILE                               *file;
+  std::vector<std::unique_ptr<block>> blocks;
+  block                              *active;
+  std::deque<block *>                 free_blocks;
+  std::deque<block *>                 full_blocks;
+  std::mutex                          lock;
+  std::condition_variable             cond;
+  std::thread                         writer;
+  bool                                closing;
+  uint64_t                            rows_written;
+  uint64_t                            stalls; // times the recorder waited for the writer
+
+  void write_column(const void *data, uint32_t width, uint32_t rows) {
+    static const char pad[8] = {0};
+    size_t            bytes  = (size_t)width * rows;
+
+    fwrite(data, 1, bytes, file);
+    fwrite(pad, 1, telemetry_column_bytes(width, rows) - bytes, file);
+  }
+
+  void write_block(const block *blk) {
+    telemetry_block_header header = {TELEMETRY_BLOCK_MAGIC, blk->rows};
+
+    fwrite(&header, sizeof(header), 1, file);
+    write_column(blk->timestamp, 8, blk->rows);
+    write_column(blk->segment_id, 4, blk->rows);
+    write_column(blk->encoder_count, 4, blk->rows);
+    write_column(blk->temperature, 2, blk->rows);
+    write_column(blk->vibration, 2, blk->rows);
+  }
+
+  void writer_thread() {
+    block *blk;
+
+    while (true) {
+      {
+        std::unique_lock<std::mutex> guard(lock);
+        cond.wait(guard, [this] { return closing || !full_blocks.empty(); });
+        if (full_blocks.empty()) break; // closing and nothing left to write
+        blk = full_blocks.front();
+        full_blocks.pop_front();
+      }
+
+      write_block(blk);
+
+      {
+        std::lock_guard<std::mutex> guard(lock);
+        rows_written += blk->rows;
+        blk->rows = 0;
+        free_blocks.push_back(blk);
+      }
+      cond.notify_all();
+    }
+  }
+
+  // hand the active block to the writer and take a free one
+  void flush_active() {
+    std::unique_lock<std::mutex> guard(lock);
+
+    full_blocks.push_back(active);
+    cond.notify_all();
+
+    if (free_blocks.empty()) ++stalls;
+    cond.wait(guard, [this] { return !free_blocks.empty(); });
+    active = free_blocks.front();
+    free_blocks.pop_front();
+  }
+
+public:
+  telemetry_recorder() : file(nullptr), active(nullptr), closing(false), rows_written(0), stalls(0) {}
+
+  ~telemetry_recorder() {
+    close();
+  }
+
+  /**
+   * @brief create the file, write the header and start the writer thread
+   *
+   * @param path file name
+   * @param time_resolution_fs duration of one timestamp tick in femtoseconds
+   * @return true on success
+   */
+  bool open(const char *path, uint64_t time_resolution_fs) {
+    telemetry_file_header header;
+
+    file = fopen(path, "wb");
+    if (nullptr == file) return false;
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, TELEMETRY_MAGIC, sizeof(header.magic));
+    header.version            = TELEMETRY_VERSION;
+    header.num_columns        = TELEMETRY_NUM_COLUMNS;
+    header.time_resolution_fs = time_resolution_fs;
+
+    fwrite(&header, sizeof(header), 1, file);
+    fwrite(telemetry_columns, sizeof(telemetry_columns), 1, file);
+
+    // all the buffers are allocated up front
+    for (int i = 0; i < TELEMETRY_NUM_BLOCKS; i++) {
+      blocks.emplace_back(new block);
+      blocks.back()->rows = 0;
+      free_blocks.push_back(blocks.back().get());
+    }
+    active = free_blocks.front();
+    free_blocks.pop_front();
+
+    closing = false;
+    writer  = std::thread(&telemetry_recorder::writer_thread, this);
+    return true;
+  }
+
+  bool is_open() const {
+    return nullptr != file;
+  }
+
+  /**
+   * @brief append one conveyor status row
+   *
+   */
+  void record(uint64_t timestamp, int32_t segment_id, uint32_t encoder_count, int16_t temperature,
+              int16_t vibration) {
+    uint32_t row = active->rows;
+
+    active->timestamp[row]     = timestamp;
+    active->segment_id[row]    = segment_id;
+    active->encoder_count[row] = encoder_count;
+    active->temperature[row]   = temperature;
+    active->vibration[row]     = vibration;
+
+    if (++active->rows == TELEMETRY_BLOCK_ROWS) flush_active();
+  }
+
+  /**
+   * @brief write the partially filled block, stop the writer thread and close the file
+   *
+   */
+  void close() {
+    if (nullptr == file) return;
+
+    {
+      std::lock_guard<std::mutex> guard(lock);
+      if (active->rows != 0) full_blocks.push_back(active);
+      closing = true;
+    }
+    cond.notify_all();
+    writer.join();
+
+    fclose(file);
+    file = nullptr;
+  }
+
+  uint64_t get_rows_written() const {
+    return rows_written;
+  }
+
+  uint64_t get_stalls() const {
+    return stalls;
+  }
+};
+
+#endif /* TELEMETRY_HPP_ */
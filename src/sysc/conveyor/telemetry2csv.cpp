@@ -0,0 +1,210 @@
+/*******************************************************************************
+ * Copyright (C) 2023 by Salvador Z                                            *
+ *                                                                             *
+ * This file is part of SYSTEM_MODELS                                          *
+ *                                                                             *
+ *   Permission is hereby granted, free of charge, to any person obtaining a   *
+ *   copy of this software and associated documentation files (the Software)   *
+ *   to deal in the Software without restriction including without limitation  *
+ *   the rights to use, copy, modify, merge, publish, distribute, sublicense,  *
+ *   and/or sell copies ot the Software, and to permit persons to whom the     *
+ *   Software is furnished to do so, subject to the following conditions:      *
+ *                                                                             *
+ *   The above copyright notice and this permission notice shall be included   *
+ *   in all copies or substantial portions of the Software.                    *
+ *                                                                             *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS   *
+ *   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARANTIES OF MERCHANTABILITY *
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL   *
+ *   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR      *
+ *   OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,     *
+ *   ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE        *
+ *   OR OTHER DEALINGS IN THE SOFTWARE.                                        *
+ ******************************************************************************/
+
+
+/**
+ * @file telemetry2csv.cpp
+ * @author Salvador Z
+ * @version 1.0
+ * @brief Converts a conveyor telemetry file to CSV
+ *
+ * usage: telemetry2csv telemetry_file [csv_file]
+ */
+
+#include "telemetry.hpp"
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+/**
+ * @brief bytes of a value of a column type, 0 for an unknown type
+ *
+ */
+static uint32_t type_width(uint32_t type) {
+  switch (type) {
+  case TELEMETRY_TYPE_U64:
+    return 8;
+  case TELEMETRY_TYPE_U32:
+  case TELEMETRY_TYPE_I32:
+    return 4;
+  case TELEMETRY_TYPE_I16:
+    return 2;
+  default:
+    return 0;
+  }
+}
+
+/**
+ * @brief print one value of a column
+ *
+ */
+static void print_value(FILE *out, const telemetry_column_desc &col, const uint8_t *column, uint32_t row) {
+  const uint8_t *value = column + (size_t)row * col.width;
+
+  switch (col.type) {
+  case TELEMETRY_TYPE_U64: {
+    uint64_t v;
+    memcpy(&v, value, sizeof(v));
+    fprintf(out, "%" PRIu64, v);
+    break;
+  }
+  case TELEMETRY_TYPE_U32: {
+    uint32_t v;
+    memcpy(&v, value, sizeof(v));
+    fprintf(out, "%" PRIu32, v);
+    break;
+  }
+  case TELEMETRY_TYPE_I32: {
+    int32_t v;
+    memcpy(&v, value, sizeof(v));
+    fprintf(out, "%" PRId32, v);
+    break;
+  }
+  case TELEMETRY_TYPE_I16: {
+    int16_t v;
+    memcpy(&v, value, sizeof(v));
+    fprintf(out, "%d", v);
+    break;
+  }
+  default:
+    fprintf(out, "?");
+    break;
+  }
+}
+
+int main(int argc, char *argv[]) {
+  FILE                              *in;
+  FILE                              *out = stdout;
+  telemetry_file_header              header;
+  std::vector<telemetry_column_desc> columns;
+  telemetry_block_header             block;
+  std::vector<std::vector<uint8_t> > data;
+  uint64_t                           total_rows = 0;
+  size_t                             got;
+  int                                status = 0;
+
+  if (argc < 2) {
+    fprintf(stderr, "usage: %s telemetry_file [csv_file]\n", argv[0]);
+    return 1;
+  }
+
+  in = fopen(argv[1], "rb");
+  if (nullptr == in) {
+    perror(argv[1]);
+    return 1;
+  }
+
+  if ((1 != fread(&header, sizeof(header), 1, in)) || (0 != memcmp(header.magic, TELEMETRY_MAGIC, 8)) ||
+      (TELEMETRY_VERSION != header.version)) {
+    fprintf(stderr, "%s: not a telemetry file\n", argv[1]);
+    fclose(in);
+    return 1;
+  }
+
+  // column 0 is the timestamp, the reader prints at most the columns the recorder writes
+  if ((0 == header.num_columns) || (header.num_columns > TELEMETRY_NUM_COLUMNS)) {
+    fprintf(stderr, "%s: %" PRIu32 " columns, expected 1 to %d\n", argv[1], header.num_columns,
+            TELEMETRY_NUM_COLUMNS);
+    fclose(in);
+    return 1;
+  }
+
+  columns.resize(header.num_columns);
+  if (header.num_columns != fread(columns.data(), sizeof(telemetry_column_desc), header.num_columns, in)) {
+    fprintf(stderr, "%s: truncated header\n", argv[1]);
+    fclose(in);
+    return 1;
+  }
+  for (uint32_t c = 0; c < header.num_columns; c++) {
+    if ((0 == c) ? ((TELEMETRY_TYPE_U64 != columns[c].type) || (8 != columns[c].width))
+                 : (type_width(columns[c].type) != columns[c].width)) {
+      fprintf(stderr, "%s: column %" PRIu32 " has type %" PRIu32 " and width %" PRIu32 "\n", argv[1], c,
+              columns[c].type, columns[c].width);
+      fclose(in);
+      return 1;
+    }
+  }
+  data.resize(header.num_columns);
+
+  if (argc > 2) {
+    out = fopen(argv[2], "w");
+    if (nullptr == out) {
+      perror(argv[2]);
+      fclose(in);
+      return 1;
+    }
+  }
+
+  // header line, the timestamp ticks are converted to seconds
+  fprintf(out, "time_s");
+  for (const telemetry_column_desc &col : columns) fprintf(out, ",%.*s", TELEMETRY_NAME_LEN, col.name);
+  fprintf(out, "\n");
+
+  // a clean end of file falls between two blocks
+  while (0 != (got = fread(&block, 1, sizeof(block), in))) {
+    if (sizeof(block) != got) {
+      fprintf(stderr, "%s: truncated block after %" PRIu64 " rows\n", argv[1], total_rows);
+      status = 1;
+      break;
+    }
+    // the recorder writes blocks of 1 to TELEMETRY_BLOCK_ROWS rows
+    if ((TELEMETRY_BLOCK_MAGIC != block.magic) || (0 == block.rows) || (block.rows > TELEMETRY_BLOCK_ROWS)) {
+      fprintf(stderr, "%s: corrupted block after %" PRIu64 " rows\n", argv[1], total_rows);
+      status = 1;
+      break;
+    }
+
+    for (uint32_t c = 0; c < header.num_columns; c++) {
+      data[c].resize(telemetry_column_bytes(columns[c].width, block.rows));
+      if (1 != fread(data[c].data(), data[c].size(), 1, in)) {
+        fprintf(stderr, "%s: truncated block after %" PRIu64 " rows\n", argv[1], total_rows);
+        status = 1;
+        break;
+      }
+    }
+    if (0 != status) break;
+
+    for (uint32_t row = 0; row < block.rows; row++) {
+      uint64_t ticks;
+
+      // column 0 is the timestamp
+      memcpy(&ticks, data[0].data() + (size_t)row * 8, sizeof(ticks));
+      fprintf(out, "%.9f", (double)ticks * header.time_resolution_fs * 1e-15);
+
+      for (uint32_t c = 0; c < header.num_columns; c++) {
+        fputc(',', out);
+        print_value(out, columns[c], data[c].data(), row);
+      }
+      fputc('\n', out);
+    }
+    total_rows += block.rows;
+  }
+
+  fprintf(stderr, "%" PRIu64 " rows\n", total_rows);
+
+  fclose(in);
+  if (stdout != out) fclose(out);
+  return status;
+}
@@ -0,0 +1,194 @@
+/*******************************************************************************
+ * Copyright (C) 2023 by Salvador Z                                            *
+ *                                                                             *
+ * This file is part of SYSTEM_MODELS                                          *
+ *                                                                             *
+ *   Permission is hereby granted, free of charge, to any person obtaining a   *
+ *   copy of this software and associated documentation files (the Software)   *
+ *   to deal in the Software without restriction including without limitation  *
+ *   the rights to use, copy, modify, merge, publish, distribute, sublicense,  *
+ *   and/or sell copies ot the Software, and to permit persons to whom the     *
+ *   Software is furnished to do so, subject to the following conditions:      *
+ *                                                                             *
+ *   The above copyright notice and this permission notice shall be included   *
+ *   in all copies or substantial portions of the Software.                    *
+ *                                                                             *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS   *
+ *   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARANTIES OF MERCHANTABILITY *
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL   *
+ *   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR      *
+ *   OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,     *
+ *   ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE        *
+ *   OR OTHER DEALINGS IN THE SOFTWARE.                                        *
+ ******************************************************************************/
+
+
+/**
+ * @file wire_format.hpp
+ * @author Salvador Z
+ * @version 1.0
+ * @brief Packed forms of the packets, for the fifo transport and for recording
+ *
+ * The timestamp is kept in time resolution ticks (sc_time::value()), so the
+ * packed forms are only meaningful within runs of the same time resolution.
+ */
+
+#ifndef WIRE_FORMAT_HPP_
+#define WIRE_FORMAT_HPP_
+
+// Includes
+#include "conveyor.hpp"
+#include <cstdint>
+#include <limits>
+#include <systemc.h>
+#include <type_traits>
+
+/**
+ * @brief conveyor_sts_packet on the wire, 16 bytes
+ *
+ */
+struct packed_conveyor_sts {
+  uint64_t ticks;       // timestamp in time resolution ticks
+  uint32_t current_cnt; // encoder count
+  uint16_t id;          // segment ID
+  int8_t   temperature; // degrees C
+  uint8_t  vibration;   // in mils
+};
+
+/**
+ * @brief control_packet on the wire, 16 bytes
+ *
+ */
+struct packed_control {
+  uint64_t ticks;
+  int32_t  data;
+  uint8_t  msg;
+  uint8_t  reserved[3];
+};
+
+/**
+ * @brief scanner_sts_packet on the wire, 16 bytes
+ *
+ */
+struct packed_scanner_sts {
+  uint64_t ticks;
+  int32_t  bag_id;
+  uint32_t reserved;
+};
+
+static_assert(sizeof(packed_conveyor_sts) == 16, "packed conveyor status must be 16 bytes");
+static_assert(sizeof(packed_control) == 16, "packed control packet must be 16 bytes");
+static_assert(sizeof(packed_scanner_sts) == 16, "packed scanner status must be 16 bytes");
+static_assert(std::is_trivially_copyable<packed_conveyor_sts>::value &&
+                  std::is_trivially_copyable<packed_control>::value &&
+                  std::is_trivially_copyable<packed_scanner_sts>::value,
+              "packed packets are copied as raw bytes");
+
+// the narrowed fields hold every value the model produces
+static_assert((TEMPERATURE_MEAN - TEMPERATURE_VARIANCE / 2 >= std::numeric_limits<int8_t>::min()) &&
+                  (TEMPERATURE_MEAN + TEMPERATURE_VARIANCE / 2 <= std::numeric_limits<int8_t>::max()),
+              "temperature does not fit the packed field");
+static_assert((VIBRATION_MEAN - VIBRATION_VARIANCE / 2 >= 0) &&
+                  (VIBRATION_MEAN + VIBRATION_VARIANCE / 2 <= std::numeric_limits<uint8_t>::max()),
+              "vibration does not fit the packed field");
+static_assert((CONTROL_PKT_MSG_TURN_OFF >= 0) &&
+                  (CONTROL_PKT_MSG_TURN_ON <= std::numeric_limits<uint8_t>::max()),
+              "control message does not fit the packed field");
+static_assert(CONVEYOR_SEGMENT_BASE_ID <= std::numeric_limits<uint16_t>::max(),
+              "segment ID does not fit the packed field");
+
+// segments with an ID that fits the packed field
+#define WIRE_MAX_SEGMENTS (std::numeric_limits<uint16_t>::max() - CONVEYOR_SEGMENT_BASE_ID + 1)
+
+/**
+ * @brief encode/decode between a packet class and its packed form
+ * Specialized for every packet type carried by the fifos.
+ */
+template <typename T>
+struct wire_traits;
+
+template <>
+struct wire_traits<conveyor_sts_packet> {
+  typedef packed_conveyor_sts packed_type;
+
+  static packed_type encode(const conveyor_sts_packet &pkt) {
+    packed_type wire;
+
+    wire.ticks       = pkt.get_timestamp().value();
+    wire.current_cnt = (uint32_t)pkt.get_current_cnt();
+    wire.id          = (uint16_t)pkt.get_id();
+    wire.temperature = (int8_t)pkt.get_temperature();
+    wire.vibration   = (uint8_t)pkt.get_vibration();
+    return wire;
+  }
+
+  static void decode(const packed_type &wire, conveyor_sts_packet &pkt) {
+    pkt.set_timestamp(sc_time::from_value(wire.ticks));
+    pkt.set_current_cnt(wire.current_cnt);
+    pkt.set_id(wire.id);
+    pkt.set_temperature(wire.temperature);
+    pkt.set_vibration(wire.vibration);
+  }
+};
+
+template <>
+struct wire_traits<control_packet> {
+  typedef packed_control packed_type;
+
+  static packed_type encode(const control_packet &pkt) {
+    packed_type wire = {};
+
+    wire.ticks = pkt.get_timestamp().value();
+    wire.data  = (int32_t)pkt.get_data();
+    wire.msg   = (uint8_t)pkt.get_msg();
+    return wire;
+  }
+
+  static void decode(const packed_type &wire, control_packet &pkt) {
+    pkt.set_timestamp(sc_time::from_value(wire.ticks));
+    pkt.set_data(wire.data);
+    pkt.set_msg(wire.msg);
+  }
+};
+
+template <>
+struct wire_traits<scanner_sts_packet> {
+  typedef packed_scanner_sts packed_type;
+
+  static packed_type encode(const scanner_sts_packet &pkt) {
+    packed_type wire = {};
+
+    wire.ticks  = pkt.get_timestamp().value();
+    wire.bag_id = (int32_t)pkt.get_bag_id();
+    return wire;
+  }
+
+  static void decode(const packed_type &wire, scanner_sts_packet &pkt) {
+    pkt.set_timestamp(sc_time::from_value(wire.ticks));
+    pkt.set_bag_id(wire.bag_id);
+  }
+};
+
+// sc_fifo prints the values it holds
+inline ostream &operator<<(ostream &os, const packed_conveyor_sts &wire) {
+  conveyor_sts_packet pkt;
+
+  wire_traits<conveyor_sts_packet>::decode(wire, pkt);
+  return os << pkt;
+}
+
+inline ostream &operator<<(ostream &os, const packed_control &wire) {
+  control_packet pkt;
+
+  wire_traits<control_packet>::decode(wire, pkt);
+  return os << pkt;
+}
+
+inline ostream &operator<<(ostream &os, const packed_scanner_sts &wire) {
+  scanner_sts_packet pkt;
+
+  wire_traits<scanner_sts_packet>::decode(wire, pkt);
+  return os << pkt;
+}
+
+#endif /* WIRE_FORMAT_HPP_ */
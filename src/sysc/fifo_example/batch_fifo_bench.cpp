@@ -0,0 +1,277 @@
+/*******************************************************************************
+ * Copyright (C) 2023 by Salvador Z                                            *
+ *                                                                             *
+ * This file is part of SYS_MODELS                                             *
+ *                                                                             *
+ *   Permission is hereby granted, free of charge, to any person obtaining a   *
+ *   copy of this software and associated documentation files (the Software)   *
+ *   to deal in the Software without restriction including without limitation  *
+ *   the rights to use, copy, modify, merge, publish, distribute, sublicense,  *
+ *   and/or sell copies ot the Software, and to permit persons to whom the     *
+ *   Software is furnished to do so, subject to the following conditions:      *
+ *                                                                             *
+ *   The above copyright notice and this permission notice shall be included   *
+ *   in all copies or substantial portions of the Software.                    *
+ *                                                                             *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS   *
+ *   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARANTIES OF MERCHANTABILITY *
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL   *
+ *   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR      *
+ *   OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,     *
+ *   ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE        *
+ *   OR OTHER DEALINGS IN THE SOFTWARE.                                        *
+ ******************************************************************************/
+
+/**
+ * @file batch_fifo_bench.cpp
+ * @author Salvador Z
+ * @version 1.0
+ * @brief Microbenchmark of batch_fifo against sc_fifo
+ *
+ * Moves the same number of values from a producer thread to a consumer thread
+ * for every batch size, through:
+ *   sc_fifo     one value per write()/read() call
+ *   batch_fifo  one value per write()/read() call, through the sc_fifo interfaces
+ *   batch_fifo  one block per write_n()/read_n() call
+ * The fifo depth is twice the batch size (at least 16). All the transfers happen
+ * at simulated time 0, the wall time is measured around each run.
+ *
+ * usage: batch_fifo_bench [-n values] [max batch]
+ */
+
+#include "batch_fifo.hpp"
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <systemc.h>
+#include <vector>
+
+#define BENCH_DEFAULT_VALUES    (1 << 22) // values moved per run
+#define BENCH_DEFAULT_MAX_BATCH 1024
+#define BENCH_MIN_DEPTH         16
+
+typedef uint64_t bench_value;
+
+/**
+ * @brief Class bench_run
+ * One producer/consumer pair, started by the driver and timed in wall time.
+ */
+class bench_run : public sc_module {
+protected:
+  long     values;
+  int      batch;
+  uint64_t checksum; // sum of the values read, checked against the values written
+
+  sc_event start_event;
+
+public:
+  const char *label;
+  sc_event    done_event;
+  double      wall_s;
+
+  bench_run(sc_module_name name, const char *run_label, long count, int batch_size)
+      : sc_module(name), values(count), batch(batch_size), checksum(0), label(run_label), wall_s(0.0) {}
+
+  void start() {
+    start_event.notify(SC_ZERO_TIME);
+  }
+
+  int get_batch() const {
+    return batch;
+  }
+
+  bool check() const {
+    return checksum == (uint64_t)values * (values - 1) / 2;
+  }
+};
+
+/**
+ * @brief Class element_run
+ * One value per call through the sc_fifo interfaces, bound to an sc_fifo or a batch_fifo.
+ */
+class element_run : public bench_run {
+public:
+  sc_port<sc_fifo_out_if<bench_value> > out;
+  sc_port<sc_fifo_in_if<bench_value> >  in;
+
+  SC_HAS_PROCESS(element_run);
+
+  element_run(sc_module_name name, const char *run_label, long count, int batch_size)
+      : bench_run(name, run_label, count, batch_size) {
+    SC_THREAD(producer);
+    SC_THREAD(consumer);
+  }
+
+  void producer() {
+    wait(start_event);
+    for (long i = 0; i < values; i++) out->write((bench_value)i);
+  }
+
+  void consumer() {
+    std::chrono::steady_clock::time_point wall_start;
+    bench_value                           value;
+
+    wait(start_event);
+    wall_start = std::chrono::steady_clock::now();
+    for (long i = 0; i < values; i++) {
+      in->read(value);
+      checksum += value;
+    }
+    wall_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall_start).count();
+    done_event.notify(SC_ZERO_TIME);
+  }
+};
+
+/**
+ * @brief Class block_run
+ * One block of batch values per call through the batch_fifo interfaces.
+ */
+class block_run : public bench_run {
+public:
+  sc_port<batch_fifo_out_if<bench_value> > out;
+  sc_port<batch_fifo_in_if<bench_value> >  in;
+
+  SC_HAS_PROCESS(block_run);
+
+  block_run(sc_module_name name, const char *run_label, long count, int batch_size)
+      : bench_run(name, run_label, count, batch_size) {
+    SC_THREAD(producer);
+    SC_THREAD(consumer);
+  }
+
+  void producer() {
+    std::vector<bench_value> block(batch);
+    long                     sent = 0;
+
+    wait(start_event);
+    while (sent < values) {
+      std::size_t count = (std::size_t)std::min<long>(batch, values - sent);
+
+      for (std::size_t i = 0; i < count; i++) block[i] = (bench_value)(sent + i);
+      out->write_n(fifo_span<const bench_value>(block.data(), count));
+      sent += count;
+    }
+  }
+
+  void consumer() {
+    std::chrono::steady_clock::time_point wall_start;
+    std::vector<bench_value>              block(batch);
+    long                                  received = 0;
+
+    wait(start_event);
+    wall_start = std::chrono::steady_clock::now();
+    while (received < values) {
+      std::size_t count = (std::size_t)std::min<long>(batch, values - received);
+
+      in->read_n(fifo_span<bench_value>(block.data(), count));
+      for (std::size_t i = 0; i < count; i++) checksum += block[i];
+      received += count;
+    }
+    wall_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall_start).count();
+    done_event.notify(SC_ZERO_TIME);
+  }
+};
+
+/**
+ * @brief Class bench_driver
+ * Starts the runs one after the other and prints a line per batch size.
+ */
+class bench_driver : public sc_module {
+private:
+  std::vector<bench_run *> runs;
+  int                      runs_per_batch;
+  long                     values;
+
+public:
+  SC_HAS_PROCESS(bench_driver);
+
+  bench_driver(sc_module_name name, int per_batch, long count)
+      : sc_module(name), runs_per_batch(per_batch), values(count) {
+    SC_THREAD(driver_thread);
+  }
+
+  void add(bench_run *run) {
+    runs.push_back(run);
+  }
+
+  void driver_thread() {
+    bool ok = true;
+
+    printf("%8s", "batch");
+    for (int i = 0; i < runs_per_batch; i++) printf(" %24s", runs[i]->label);
+    printf("   [Melements/s]\n");
+
+    for (size_t i = 0; i < runs.size(); i++) {
+      runs[i]->start();
+      wait(runs[i]->done_event);
+      ok = ok && runs[i]->check();
+
+      if (0 == i % runs_per_batch) printf("%8d", runs[i]->get_batch());
+      printf(" %24.2f", values / runs[i]->wall_s / 1e6);
+      if (runs_per_batch - 1 == (int)(i % runs_per_batch)) printf("\n");
+      fflush(stdout);
+    }
+
+    if (!ok) printf("checksum mismatch\n");
+    sc_stop();
+  }
+};
+
+int sc_main(int argc, char *argv[]) {
+  long values    = BENCH_DEFAULT_VALUES;
+  int  max_batch = BENCH_DEFAULT_MAX_BATCH;
+
+  std::vector<sc_fifo<bench_value> *>    sc_fifos;
+  std::vector<batch_fifo<bench_value> *> batch_fifos;
+
+  for (int i = 1; i < argc; ++i) {
+    if ((0 == strcmp(argv[i], "-n")) && (i + 1 < argc)) {
+      values = atol(argv[++i]);
+    } else {
+      max_batch = atoi(argv[i]);
+    }
+  }
+  if (values < 1) values = 1;
+  if (max_batch < 1) max_batch = 1;
+
+  printf("batch_fifo_bench: %ld values per run\n\n", values);
+
+  bench_driver driver("driver", 3, values);
+
+  for (int batch = 1; batch <= max_batch; batch *= 2) {
+    int  depth = std::max(2 * batch, BENCH_MIN_DEPTH);
+    char name[64];
+
+    // sc_fifo, one value per call
+    snprintf(name, sizeof(name), "sc_fifo_%d", batch);
+    sc_fifos.push_back(new sc_fifo<bench_value>(name, depth));
+    snprintf(name, sizeof(name), "sc_fifo_run_%d", batch);
+    element_run *sc_run = new element_run(name, "sc_fifo", values, batch);
+    sc_run->out(*sc_fifos.back());
+    sc_run->in(*sc_fifos.back());
+    driver.add(sc_run);
+
+    // batch_fifo bound to the sc_fifo ports, one value per call
+    snprintf(name, sizeof(name), "batch_fifo_element_%d", batch);
+    batch_fifos.push_back(new batch_fifo<bench_value>(name, depth));
+    snprintf(name, sizeof(name), "element_run_%d", batch);
+    element_run *element = new element_run(name, "batch_fifo read/write", values, batch);
+    element->out(*batch_fifos.back());
+    element->in(*batch_fifos.back());
+    driver.add(element);
+
+    // batch_fifo, one block per call
+    snprintf(name, sizeof(name), "batch_fifo_block_%d", batch);
+    batch_fifos.push_back(new batch_fifo<bench_value>(name, depth));
+    snprintf(name, sizeof(name), "block_run_%d", batch);
+    block_run *block = new block_run(name, "batch_fifo read_n/write_n", values, batch);
+    block->out(*batch_fifos.back());
+    block->in(*batch_fifos.back());
+    driver.add(block);
+  }
+
+  sc_start();
+  return 0;
+}
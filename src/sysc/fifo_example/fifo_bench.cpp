@@ -0,0 +1,275 @@
+/*******************************************************************************
+ * Copyright (C) 2023 by Salvador Z                                            *
+ *                                                                             *
+ * This file is part of SYS_MODELS                                             *
+ *                                                                             *
+ *   Permission is hereby granted, free of charge, to any person obtaining a   *
+ *   copy of this software and associated documentation files (the Software)   *
+ *   to deal in the Software without restriction including without limitation  *
+ *   the rights to use, copy, modify, merge, publish, distribute, sublicense,  *
+ *   and/or sell copies ot the Software, and to permit persons to whom the     *
+ *   Software is furnished to do so, subject to the following conditions:      *
+ *                                                                             *
+ *   The above copyright notice and this permission notice shall be included   *
+ *   in all copies or substantial portions of the Software.                    *
+ *                                                                             *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS   *
+ *   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARANTIES OF MERCHANTABILITY *
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL   *
+ *   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR      *
+ *   OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,     *
+ *   ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE        *
+ *   OR OTHER DEALINGS IN THE SOFTWARE.                                        *
+ ******************************************************************************/
+
+
+/**
+ * @file fifo_bench.cpp
+ * @author Salvador Z
+ * @version 1.0
+ * @brief Microbenchmark of fifo<T, N> against sc_fifo
+ *
+ * Moves the same number of values from a producer thread to a consumer thread
+ * for every depth, through:
+ *   sc_fifo      write()/read(), values readable in the next delta cycle
+ *   fifo         write()/read(), immediate notification
+ *   fifo try     try_write()/try_read(), waiting on the events when full or empty
+ * The depths are powers of two (mask indexing) and their neighbours (compare
+ * indexing). All the transfers happen at simulated time 0, the wall time is
+ * measured around each run.
+ *
+ * usage: fifo_bench [-n values]
+ */
+
+#include "fifo.hpp"
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <systemc.h>
+#include <vector>
+
+#define BENCH_DEFAULT_VALUES (1 << 22) // values moved per run
+#define BENCH_RUNS_PER_DEPTH 3
+
+typedef uint64_t bench_value;
+
+/**
+ * @brief Class bench_run
+ * One producer/consumer pair, started by the driver and timed in wall time.
+ */
+class bench_run : public sc_module {
+protected:
+  long     values;
+  uint64_t checksum; // sum of the values read, checked against the values written
+
+  sc_event start_event;
+
+public:
+  const char  *label;
+  std::size_t  depth;
+  sc_event     done_event;
+  double       wall_s;
+
+  bench_run(sc_module_name name, const char *run_label, long count, std::size_t fifo_depth)
+      : sc_module(name), values(count), checksum(0), label(run_label), depth(fifo_depth), wall_s(0.0) {}
+
+  void start() {
+    start_event.notify(SC_ZERO_TIME);
+  }
+
+  bool check() const {
+    return checksum == (uint64_t)values * (values - 1) / 2;
+  }
+};
+
+/**
+ * @brief Class blocking_run
+ * One value per blocking call, IN and OUT are the ports of an sc_fifo or of a fifo.
+ */
+template <typename IN, typename OUT>
+class blocking_run : public bench_run {
+public:
+  OUT out;
+  IN  in;
+
+  SC_HAS_PROCESS(blocking_run);
+
+  blocking_run(sc_module_name name, const char *run_label, long count, std::size_t fifo_depth)
+      : bench_run(name, run_label, count, fifo_depth) {
+    SC_THREAD(producer);
+    SC_THREAD(consumer);
+  }
+
+  void producer() {
+    wait(start_event);
+    for (long i = 0; i < values; i++) out->write((bench_value)i);
+  }
+
+  void consumer() {
+    std::chrono::steady_clock::time_point wall_start;
+    bench_value                           value;
+
+    wait(start_event);
+    wall_start = std::chrono::steady_clock::now();
+    for (long i = 0; i < values; i++) {
+      in->read(value);
+      checksum += value;
+    }
+    wall_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall_start).count();
+    done_event.notify(SC_ZERO_TIME);
+  }
+};
+
+/**
+ * @brief Class try_run
+ * fifo try_write()/try_read() until full or empty, then a wait on the other side's event.
+ */
+class try_run : public bench_run {
+public:
+  sc_port<write_if<bench_value> > out;
+  sc_port<read_if<bench_value> >  in;
+
+  SC_HAS_PROCESS(try_run);
+
+  try_run(sc_module_name name, const char *run_label, long count, std::size_t fifo_depth)
+      : bench_run(name, run_label, count, fifo_depth) {
+    SC_THREAD(producer);
+    SC_THREAD(consumer);
+  }
+
+  void producer() {
+    long i = 0;
+
+    wait(start_event);
+    while (i < values) {
+      while ((i < values) && out->try_write((bench_value)i)) i++;
+      if (i < values) wait(out->data_read_event());
+    }
+  }
+
+  void consumer() {
+    std::chrono::steady_clock::time_point wall_start;
+    bench_value                           value;
+    long                                  received = 0;
+
+    wait(start_event);
+    wall_start = std::chrono::steady_clock::now();
+    while (received < values) {
+      while (in->try_read(value)) {
+        checksum += value;
+        received++;
+      }
+      if (received < values) wait(in->data_written_event());
+    }
+    wall_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall_start).count();
+    done_event.notify(SC_ZERO_TIME);
+  }
+};
+
+typedef blocking_run<sc_port<sc_fifo_in_if<bench_value> >, sc_port<sc_fifo_out_if<bench_value> > >
+    sc_fifo_run;
+typedef blocking_run<sc_port<read_if<bench_value> >, sc_port<write_if<bench_value> > > fifo_run;
+
+/**
+ * @brief Class bench_driver
+ * Starts the runs one after the other and prints a line per depth.
+ */
+class bench_driver : public sc_module {
+private:
+  std::vector<bench_run *> runs;
+  long                     values;
+
+public:
+  SC_HAS_PROCESS(bench_driver);
+
+  bench_driver(sc_module_name name, long count) : sc_module(name), values(count) {
+    SC_THREAD(driver_thread);
+  }
+
+  void add(bench_run *run) {
+    runs.push_back(run);
+  }
+
+  void driver_thread() {
+    bool ok = true;
+
+    printf("%8s", "depth");
+    for (int i = 0; i < BENCH_RUNS_PER_DEPTH; i++) printf(" %16s", runs[i]->label);
+    printf("   [Melements/s]\n");
+
+    for (size_t i = 0; i < runs.size(); i++) {
+      runs[i]->start();
+      wait(runs[i]->done_event);
+      ok = ok && runs[i]->check();
+
+      if (0 == i % BENCH_RUNS_PER_DEPTH) printf("%8zu", runs[i]->depth);
+      printf(" %16.2f", values / runs[i]->wall_s / 1e6);
+      if (BENCH_RUNS_PER_DEPTH - 1 == (int)(i % BENCH_RUNS_PER_DEPTH)) printf("\n");
+      fflush(stdout);
+    }
+
+    if (!ok) printf("checksum mismatch\n");
+    sc_stop();
+  }
+};
+
+/**
+ * @brief the three runs of depth N
+ *
+ */
+template <std::size_t N>
+static void add_depth(bench_driver &driver, long values) {
+  char name[64];
+
+  snprintf(name, sizeof(name), "sc_fifo_%zu", N);
+  sc_fifo<bench_value> *channel = new sc_fifo<bench_value>(name, (int)N);
+  snprintf(name, sizeof(name), "sc_fifo_run_%zu", N);
+  sc_fifo_run *sc_run = new sc_fifo_run(name, "sc_fifo", values, N);
+  sc_run->out(*channel);
+  sc_run->in(*channel);
+  driver.add(sc_run);
+
+  snprintf(name, sizeof(name), "fifo_%zu", N);
+  fifo<bench_value, N> *ring = new fifo<bench_value, N>(name);
+  snprintf(name, sizeof(name), "fifo_run_%zu", N);
+  fifo_run *blocking = new fifo_run(name, "fifo", values, N);
+  blocking->out(*ring);
+  blocking->in(*ring);
+  driver.add(blocking);
+
+  snprintf(name, sizeof(name), "fifo_try_%zu", N);
+  ring = new fifo<bench_value, N>(name);
+  snprintf(name, sizeof(name), "try_run_%zu", N);
+  try_run *polling = new try_run(name, "fifo try", values, N);
+  polling->out(*ring);
+  polling->in(*ring);
+  driver.add(polling);
+}
+
+int sc_main(int argc, char *argv[]) {
+  long values = BENCH_DEFAULT_VALUES;
+
+  for (int i = 1; i < argc; ++i) {
+    if ((0 == strcmp(argv[i], "-n")) && (i + 1 < argc)) values = atol(argv[++i]);
+  }
+  if (values < 1) values = 1;
+
+  printf("fifo_bench: %ld values per run\n\n", values);
+
+  bench_driver driver("driver", values);
+
+  add_depth<1>(driver, values);
+  add_depth<10>(driver, values);
+  add_depth<16>(driver, values);
+  add_depth<17>(driver, values);
+  add_depth<64>(driver, values);
+  add_depth<100>(driver, values);
+  add_depth<256>(driver, values);
+  add_depth<1000>(driver, values);
+  add_depth<1024>(driver, values);
+
+  sc_start();
+  return 0;
+}
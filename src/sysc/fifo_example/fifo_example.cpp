@@ -28,63 +28,35 @@
  * @date 27 Jun 2023
  * @brief File for fifo_example
  *
+ * usage: fifo_example [--stream MB [--per-char]]
+ *
+ * Without arguments a producer sends a sentence to a consumer through a fifo of
+ * ten characters. --stream moves a payload of MB megabytes instead, in blocks
+ * through the views of a stream_fifo, or one character per call with --per-char,
+ * and reports the bytes per second.
  */
 
+#include "fifo.hpp"
+#include "fifo_monitor.hpp"
+#include "sim_log.hpp"
+#include <chrono>
+#include <cstdint>
+#include <cstring>
 #include <systemc.h> /*System C*/
+#include <vector>
 
-class write_if : virtual public sc_interface {
-public:
-  virtual void write(char) = 0;
-  virtual void reset()     = 0;
-};
-
-class read_if : virtual public sc_interface {
-public:
-  virtual void read(char &) = 0;
-  virtual int  size()       = 0;
-};
-
-class fifo : public sc_channel, public write_if, public read_if {
-private:
-  enum el { max = 10 };
-  char     data[max];
-  int      elements_num, head;
-  sc_event wr_event, rd_event;
+#define FIFO_EXAMPLE_DEPTH 10    // characters
+#define CONSUMER_LINE_LEN  80    // characters per log record
+#define STREAM_DEPTH       65536 // bytes of the stream ring, a power of two
+#define STREAM_MB          (1 << 20)
 
-public:
-  fifo(sc_module_name name) : sc_channel(name), elements_num(0), head(0) {}
-
-  void write(char c) {
-    if (elements_num == max) {
-      wait(rd_event);
-    }
-    data[(head + elements_num) % max] = c;
-    ++elements_num;
-    wr_event.notify();
-  }
-
-  void read(char &c) {
-    if (elements_num == 0) {
-      wait(wr_event);
-    }
-    c = data[head];
-    --elements_num;
-    head = (head + 1) % max;
-    rd_event.notify();
-  }
-
-  void reset() {
-    elements_num = head = 0;
-  }
-
-  int size() {
-    return elements_num;
-  }
-};
+#define EXAMPLE_TEXT                                                                 \
+  "Que estás como quieres de pies a cabeza y no se midió La naturaleza con tanta "   \
+  "belleza que en ti reunió !\n "
 
 class producer : public sc_module {
 public:
-  sc_port<write_if> out;
+  sc_port<write_if<char> > out;
 
   SC_HAS_PROCESS(producer);
 
@@ -94,8 +66,7 @@ public:
 
   void producer_main() {
     out->reset();
-    const char *str = "Que estás como quieres de pies a cabeza y no se midió La naturaleza con tanta belleza "
-                      "que en ti reunió !\n ";
+    const char *str = EXAMPLE_TEXT;
 
     while (*str)
       out->write(*str++);
@@ -103,37 +74,66 @@ public:
 };
 
 class consumer : public sc_module {
+private:
+  sim_log_source &log;
+  char            line[CONSUMER_LINE_LEN + 8]; // room for a fill level mark
+  int             length;
+
+  // the marks and the rest of a UTF-8 sequence can go past CONSUMER_LINE_LEN, not past the buffer
+  void append(const char *text) {
+    while (*text && (length < (int)sizeof(line) - 1)) line[length++] = *text++;
+  }
+
 public:
-  sc_port<read_if> in;
+  sc_port<read_if<char> > in;
 
   SC_HAS_PROCESS(consumer);
 
-  consumer(sc_module_name name) : sc_module(name) {
+  consumer(sc_module_name name)
+      : sc_module(name), log(sim_log::instance().source(this->name())), length(0) {
     SC_THREAD(consumer_main);
   }
 
+  // log the characters received since the last line
+  void flush_line() {
+    if (0 == length) return;
+    line[length] = '\0';
+    SIM_LOG(log, SIM_LOG_INFO, "%s", line);
+    length = 0;
+  }
+
   void consumer_main() {
     char c;
-    cout << endl << endl;
 
+    // one log record per line of text instead of one stdout flush per character
     while (true) {
       in->read(c);
-      cout << c << flush;
 
-      if (in->size() == 1) cout << "<1>" << flush;
-      if (in->size() == 9) cout << "<9>" << flush;
+      if ('\n' == c) {
+        flush_line();
+      } else {
+        // a full line is not split inside a UTF-8 sequence
+        if ((length >= CONSUMER_LINE_LEN) && (0x80 != (c & 0xC0))) flush_line();
+        if (length >= (int)sizeof(line) - 1) flush_line();
+        line[length++] = c;
+      }
+
+      if (in->size() == 1) append("<1>");
+      if (in->size() == FIFO_EXAMPLE_DEPTH - 1) append("<9>");
     }
   }
 };
 
 class top : public sc_module {
 public:
-  fifo     *fifo_inst;
-  producer *producer_inst;
-  consumer *consumer_inst;
+  typedef monitored_fifo<char, fifo<char, FIFO_EXAMPLE_DEPTH> > example_fifo; // see fifo_monitor.hpp
+
+  example_fifo *fifo_inst;
+  producer     *producer_inst;
+  consumer     *consumer_inst;
 
   top(sc_module_name name) : sc_module(name) {
-    fifo_inst = new fifo("FIFO");
+    fifo_inst = new example_fifo("FIFO");
 
     producer_inst = new producer("Producer");
     producer_inst->out(*fifo_inst);
@@ -143,8 +143,200 @@ public:
   }
 };
 
-int sc_main(int, char *[]) {
+/**
+ * @brief Class bulk_producer
+ * Copies the payload straight into the free views of the stream ring, one commit per view.
+ */
+class bulk_producer : public sc_module {
+private:
+  const std::vector<char> &payload;
+
+public:
+  sc_port<stream_write_if<char> > out;
+
+  SC_HAS_PROCESS(bulk_producer);
+
+  bulk_producer(sc_module_name name, const std::vector<char> &data) : sc_module(name), payload(data) {
+    SC_THREAD(producer_main);
+  }
+
+  void producer_main() {
+    std::size_t sent = 0;
+
+    while (sent < payload.size()) {
+      fifo_span<char> view  = out->acquire_write();
+      std::size_t     count = std::min(view.size(), payload.size() - sent);
+
+      memcpy(view.data(), payload.data() + sent, count);
+      out->commit_write(count);
+      sent += count;
+    }
+  }
+};
+
+/**
+ * @brief Class stream_sink
+ * Checksum and wall time of the bytes received, shared by the two stream consumers.
+ */
+class stream_sink : public sc_module {
+protected:
+  std::size_t                           expected;
+  std::chrono::steady_clock::time_point wall_start;
+
+public:
+  std::size_t received;
+  std::size_t chunks; // read calls
+  uint64_t    checksum; // position dependent, a reordered or repeated chunk changes it
+  double      wall_s;
+
+  stream_sink(sc_module_name name, std::size_t bytes)
+      : sc_module(name), expected(bytes), received(0), chunks(0), checksum(0), wall_s(0.0) {}
+
+  void add(const char *data, std::size_t count) {
+    for (std::size_t i = 0; i < count; i++) checksum = checksum * 31 + (unsigned char)data[i];
+    received += count;
+    ++chunks;
+  }
+};
+
+/**
+ * @brief Class bulk_consumer
+ * Sums the bytes in place in the filled views of the stream ring, nothing is copied out.
+ */
+class bulk_consumer : public stream_sink {
+public:
+  sc_port<stream_read_if<char> > in;
+
+  SC_HAS_PROCESS(bulk_consumer);
+
+  bulk_consumer(sc_module_name name, std::size_t bytes) : stream_sink(name, bytes) {
+    SC_THREAD(consumer_main);
+  }
+
+  void consumer_main() {
+    wall_start = std::chrono::steady_clock::now();
+    while (received < expected) {
+      fifo_span<const char> view = in->acquire_read();
+
+      add(view.data(), view.size());
+      in->release_read(view.size());
+    }
+    wall_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall_start).count();
+  }
+};
+
+/**
+ * @brief Class char_producer
+ * The payload one character per write(), the baseline of the stream.
+ */
+class char_producer : public sc_module {
+private:
+  const std::vector<char> &payload;
+
+public:
+  sc_port<write_if<char> > out;
+
+  SC_HAS_PROCESS(char_producer);
+
+  char_producer(sc_module_name name, const std::vector<char> &data) : sc_module(name), payload(data) {
+    SC_THREAD(producer_main);
+  }
+
+  void producer_main() {
+    for (char c : payload) out->write(c);
+  }
+};
+
+/**
+ * @brief Class char_consumer
+ * One character per read().
+ */
+class char_consumer : public stream_sink {
+public:
+  sc_port<read_if<char> > in;
+
+  SC_HAS_PROCESS(char_consumer);
+
+  char_consumer(sc_module_name name, std::size_t bytes) : stream_sink(name, bytes) {
+    SC_THREAD(consumer_main);
+  }
+
+  void consumer_main() {
+    char c;
+
+    wall_start = std::chrono::steady_clock::now();
+    while (received < expected) {
+      in->read(c);
+      add(&c, 1);
+    }
+    wall_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall_start).count();
+  }
+};
+
+/**
+ * @brief stream a payload of the example text repeated to the given size
+ *
+ * @param bytes payload size
+ * @param per_char one character per call through a fifo instead of the stream views
+ */
+static int run_stream(std::size_t bytes, bool per_char) {
+  const char       *text = EXAMPLE_TEXT;
+  std::vector<char> payload(bytes);
+  uint64_t          checksum = 0;
+  stream_sink      *sink;
+
+  for (std::size_t i = 0; i < bytes; i++) {
+    payload[i] = text[i % strlen(EXAMPLE_TEXT)];
+    checksum   = checksum * 31 + (unsigned char)payload[i];
+  }
+
+  if (per_char) {
+    fifo<char, STREAM_DEPTH> *channel  = new fifo<char, STREAM_DEPTH>("stream_fifo");
+    char_producer            *producer = new char_producer("producer", payload);
+    char_consumer            *consumer = new char_consumer("consumer", bytes);
+
+    producer->out(*channel);
+    consumer->in(*channel);
+    sink = consumer;
+  } else {
+    stream_fifo<char, STREAM_DEPTH> *channel  = new stream_fifo<char, STREAM_DEPTH>("stream_fifo");
+    bulk_producer                   *producer = new bulk_producer("producer", payload);
+    bulk_consumer                   *consumer = new bulk_consumer("consumer", bytes);
+
+    producer->out(*channel);
+    consumer->in(*channel);
+    sink = consumer;
+  }
+
+  sc_start();
+
+  printf("stream: %zu bytes in %zu reads (%s, %d byte ring), %.3f s wall, %.1f MB/s, checksum %s\n",
+         sink->received, sink->chunks, per_char ? "one character per call" : "zero copy views", STREAM_DEPTH,
+         sink->wall_s, sink->received / std::max(sink->wall_s, 1e-9) / STREAM_MB,
+         ((sink->received == bytes) && (sink->checksum == checksum)) ? "ok" : "mismatch");
+  return (sink->checksum == checksum) ? 0 : 1;
+}
+
+int sc_main(int argc, char *argv[]) {
+  long stream_mb = 0;
+  bool per_char  = false;
+
+  for (int i = 1; i < argc; ++i) {
+    if ((0 == strcmp(argv[i], "--stream")) && (i + 1 < argc)) {
+      stream_mb = atol(argv[++i]);
+    } else if (0 == strcmp(argv[i], "--per-char")) {
+      per_char = true;
+    } else {
+      fprintf(stderr, "usage: %s [--stream MB [--per-char]]\n", argv[0]);
+      return 1;
+    }
+  }
+  if (stream_mb > 0) return run_stream((std::size_t)stream_mb * STREAM_MB, per_char);
+
   top top_inst("Top_instance");
   sc_start();
+  top_inst.consumer_inst->flush_line();
+  sim_log::instance().flush();
+  FIFO_MONITOR_REPORT("fifo_example_fifos");
   return 0;
 }
\ No newline at end of file
@@ -0,0 +1,282 @@
+/*******************************************************************************
+ * Copyright (C) 2023 by Salvador Z                                            *
+ *                                                                             *
+ * This file is part of SYS_MODELS                                             *
+ *                                                                             *
+ *   Permission is hereby granted, free of charge, to any person obtaining a   *
+ *   copy of this software and associated documentation files (the Software)   *
+ *   to deal in the Software without restriction including without limitation  *
+ *   the rights to use, copy, modify, merge, publish, distribute, sublicense,  *
+ *   and/or sell copies ot the Software, and to permit persons to whom the     *
+ *   Software is furnished to do so, subject to the following conditions:      *
+ *                                                                             *
+ *   The above copyright notice and this permission notice shall be included   *
+ *   in all copies or substantial portions of the Software.                    *
+ *                                                                             *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS   *
+ *   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARANTIES OF MERCHANTABILITY *
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL   *
+ *   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR      *
+ *   OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,     *
+ *   ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE        *
+ *   OR OTHER DEALINGS IN THE SOFTWARE.                                        *
+ ******************************************************************************/
+
+
+/**
+ * @file mpmc_bench.cpp
+ * @author Salvador Z
+ * @version 1.0
+ * @brief Stress benchmark of mpmc_fifo<T, N> against fifo<T, N> shared by many processes
+ *
+ * P producer and P consumer threads, P from 1 to 1000, move the same number of
+ * values through a fifo of BENCH_DEPTH values:
+ *   fifo        try_write()/try_read(), waiting on the data_read/written events
+ *               when full or empty, the loop of the blocking fifo calls; every
+ *               transfer wakes all the processes blocked on the other side
+ *   mpmc_fifo   blocking write()/read(), a transfer wakes one blocked process
+ * A wakeup is a blocked thread resumed. With the broadcast the wakeups per value
+ * grow with P, with mpmc_fifo they stay under one.
+ *
+ * usage: mpmc_bench [-n values]
+ */
+
+#include "fifo.hpp"
+#include "mpmc_fifo.hpp"
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <systemc.h>
+#include <vector>
+
+#define BENCH_DEFAULT_VALUES (1 << 16) // values moved per run
+#define BENCH_DEPTH          16
+#define BENCH_STACK_SIZE     0x8000 // bytes per thread, there are up to 2000 per run
+
+typedef uint64_t bench_value;
+
+/**
+ * @brief Struct run_state
+ * Shared by the threads of one run.
+ */
+struct run_state {
+  sc_event start_event;
+  sc_event done_event;
+  long     per_process;    // values written by each producer and read by each consumer
+  bool     blocking;       // write()/read() rather than the try calls and the events
+  int      consumers_left;
+  uint64_t checksum;       // sum of the values read, checked against the values written
+  uint64_t wakeups;        // counted by the threads when not blocking
+};
+
+/**
+ * @brief Class bench_producer
+ * Writes per_process values from first on.
+ */
+class bench_producer : public sc_module {
+private:
+  run_state &state;
+  long       first;
+
+public:
+  sc_port<write_if<bench_value> > out;
+
+  SC_HAS_PROCESS(bench_producer);
+
+  bench_producer(sc_module_name name, run_state &run, long first_value)
+      : sc_module(name), state(run), first(first_value) {
+    SC_THREAD(producer);
+    set_stack_size(BENCH_STACK_SIZE);
+  }
+
+  void producer() {
+    wait(state.start_event);
+    for (long i = first; i < first + state.per_process; i++) {
+      if (state.blocking) {
+        out->write((bench_value)i);
+        continue;
+      }
+      while (!out->try_write((bench_value)i)) {
+        wait(out->data_read_event());
+        state.wakeups++;
+      }
+    }
+  }
+};
+
+/**
+ * @brief Class bench_consumer
+ * Reads per_process values, the last consumer to finish ends the run.
+ */
+class bench_consumer : public sc_module {
+private:
+  run_state &state;
+
+public:
+  sc_port<read_if<bench_value> > in;
+
+  SC_HAS_PROCESS(bench_consumer);
+
+  bench_consumer(sc_module_name name, run_state &run) : sc_module(name), state(run) {
+    SC_THREAD(consumer);
+    set_stack_size(BENCH_STACK_SIZE);
+  }
+
+  void consumer() {
+    bench_value value;
+
+    wait(state.start_event);
+    for (long i = 0; i < state.per_process; i++) {
+      if (state.blocking) {
+        in->read(value);
+      } else {
+        while (!in->try_read(value)) {
+          wait(in->data_written_event());
+          state.wakeups++;
+        }
+      }
+      state.checksum += value;
+    }
+    if (0 == --state.consumers_left) state.done_event.notify(SC_ZERO_TIME);
+  }
+};
+
+// wakeups counted by the channel
+inline uint64_t channel_wakeups(const sc_interface &) {
+  return 0;
+}
+
+template <std::size_t N>
+inline uint64_t channel_wakeups(const mpmc_fifo<bench_value, N> &channel) {
+  return channel.get_wakeups();
+}
+
+/**
+ * @brief Class bench_run
+ * P producers and P consumers, started by the driver.
+ */
+class bench_run : public sc_module {
+public:
+  const char *label;
+  int         processes;
+  run_state   state;
+  double      wall_s;
+
+  bench_run(sc_module_name name, const char *run_label, int count, long values, bool blocking)
+      : sc_module(name), label(run_label), processes(count), wall_s(0.0) {
+    state.per_process    = values / count;
+    state.blocking       = blocking;
+    state.consumers_left = count;
+    state.checksum       = 0;
+    state.wakeups        = 0;
+  }
+
+  long get_values() const {
+    return state.per_process * processes;
+  }
+
+  bool check() const {
+    return state.checksum == (uint64_t)get_values() * (get_values() - 1) / 2;
+  }
+
+  virtual uint64_t get_wakeups() const = 0;
+};
+
+/**
+ * @brief Class channel_run
+ * A run over a CHANNEL of bench_value, fifo or mpmc_fifo.
+ */
+template <typename CHANNEL>
+class channel_run : public bench_run {
+public:
+  CHANNEL                   channel;
+  sc_vector<bench_producer> producers;
+  sc_vector<bench_consumer> consumers;
+
+  channel_run(sc_module_name name, const char *run_label, int count, long values, bool blocking)
+      : bench_run(name, run_label, count, values, blocking), channel("channel"),
+        producers("producer", count,
+                  [this](const char *producer_name, size_t i) {
+                    return new bench_producer(producer_name, state, (long)i * state.per_process);
+                  }),
+        consumers("consumer", count, [this](const char *consumer_name, size_t) {
+          return new bench_consumer(consumer_name, state);
+        }) {
+    for (bench_producer &producer : producers) producer.out(channel);
+    for (bench_consumer &consumer : consumers) consumer.in(channel);
+  }
+
+  virtual uint64_t get_wakeups() const {
+    return state.wakeups + channel_wakeups(channel);
+  }
+};
+
+/**
+ * @brief Class bench_driver
+ * Starts the runs one after the other and prints a line per run.
+ */
+class bench_driver : public sc_module {
+private:
+  std::vector<bench_run *> runs;
+
+public:
+  SC_HAS_PROCESS(bench_driver);
+
+  bench_driver(sc_module_name name) : sc_module(name) {
+    SC_THREAD(driver_thread);
+  }
+
+  void add(bench_run *run) {
+    runs.push_back(run);
+  }
+
+  void driver_thread() {
+    std::chrono::steady_clock::time_point wall_start;
+    bool                                  ok = true;
+
+    printf("%10s %10s %10s %14s %14s %12s %14s\n", "producers", "consumers", "channel", "wakeups",
+           "wakeups/value", "wall s", "Mvalues/s");
+    for (bench_run *run : runs) {
+      wall_start = std::chrono::steady_clock::now();
+      run->state.start_event.notify(SC_ZERO_TIME);
+      wait(run->state.done_event);
+      run->wall_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall_start).count();
+      ok          = ok && run->check();
+
+      printf("%10d %10d %10s %14llu %14.3f %12.4f %14.3f\n", run->processes, run->processes, run->label,
+             (unsigned long long)run->get_wakeups(), (double)run->get_wakeups() / run->get_values(),
+             run->wall_s, run->get_values() / run->wall_s / 1e6);
+      fflush(stdout);
+    }
+
+    if (!ok) printf("checksum mismatch\n");
+    sc_stop();
+  }
+};
+
+int sc_main(int argc, char *argv[]) {
+  const int processes[] = {1, 10, 100, 1000};
+  long      values      = BENCH_DEFAULT_VALUES;
+  char      name[64];
+
+  for (int i = 1; i < argc; ++i) {
+    if ((0 == strcmp(argv[i], "-n")) && (i + 1 < argc)) values = atol(argv[++i]);
+  }
+  if (values < 1000) values = 1000; // at least one value per process
+
+  printf("mpmc_bench: %ld values per run, depth %d\n\n", values, BENCH_DEPTH);
+
+  bench_driver driver("driver");
+
+  for (int count : processes) {
+    snprintf(name, sizeof(name), "fifo_run_%d", count);
+    driver.add(new channel_run<fifo<bench_value, BENCH_DEPTH> >(name, "fifo", count, values, false));
+    snprintf(name, sizeof(name), "mpmc_run_%d", count);
+    driver.add(new channel_run<mpmc_fifo<bench_value, BENCH_DEPTH> >(name, "mpmc_fifo", count, values, true));
+  }
+
+  sc_start();
+  return 0;
+}
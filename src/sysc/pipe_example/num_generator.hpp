@@ -34,25 +34,36 @@
 #define NUM_GENERATOR_HPP_
 
 // Includes
+#include "counter_rng.hpp"
+#include "sim_profile.hpp"
 #include <systemc.h>
 
+#define NUM_GENERATOR_SEED 1
+
 struct num_generator : sc_module {
   sc_in<bool>    clk;
   sc_out<double> out1;
   sc_out<double> out2;
 
+  counter_rng rng; // keyed by the seed and the instance name
+
+  PROFILE_SLOT(profile_slot);
+
   SC_CTOR(num_generator) {
     SC_METHOD(generate);
     dont_initialize(); // prevent initialization for SC_METHODs and SC_THREADs
     sensitive << clk.pos();
+
+    rng = counter_rng(NUM_GENERATOR_SEED, counter_rng::instance_id(this->name()));
   }
 
   void generate() {
+    PROFILE_ACTIVATION(profile_slot);
     static double a = 200.5;
     static double b = 100.5;
 
-    a -= (rand() % 10);
-    b -= (rand() % 10);
+    a -= rng.uniform(10);
+    b -= rng.uniform(10);
 
     out1.write(a);
     out2.write(b);
@@ -28,52 +28,169 @@
  * @date 27 Jun 2023
  * @brief File for show a pipe processes in SystemC (RTL like)
  *
+ * The pipe runs event driven, the clock written by hand and every rising edge
+ * running the SC_METHODs through sc_signal delta cycles, or with --cycle on the
+ * cycle_sim fast path: the same modules bound to cycle_signals and their processes
+ * called once per cycle. Both print the same records.
+ *
+ * usage: pipe [--cycle] [-n cycles]
  */
+#include "cycle_sim.hpp"
 #include "num_generator.hpp"
+#include "sim_log.hpp"
+#include "sim_profile.hpp"
 #include "stage1.hpp"
 #include "stage2.hpp"
 #include "stage3.hpp"
 #include "test_probe_display.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
 #include <systemc.h>
 
-int sc_main(int, char *[]) {
+#define PIPE_CYCLES          50 // default number of clock cycles
+#define PIPE_CLOCK_PERIOD_NS 20
 
+/**
+ * @brief Struct pipe_model
+ * The generator, the three stages and the display, connected through SIGNALs of
+ * double: sc_signal<double> for the event driven run, cycle_signal<double> for
+ * the cycle based one.
+ */
+template <typename SIGNAL>
+struct pipe_model {
   // Signals
-  sc_signal<double> s_in1;
-  sc_signal<double> s_in2;
-  sc_signal<double> s_sum;
-  sc_signal<double> s_diff;
-  sc_signal<double> s_prod;
-  sc_signal<double> s_quot;
-  sc_signal<double> s_powr;
+  SIGNAL s_in1;
+  SIGNAL s_in2;
+  SIGNAL s_sum;
+  SIGNAL s_diff;
+  SIGNAL s_prod;
+  SIGNAL s_quot;
+  SIGNAL s_powr;
   // Clock
   sc_signal<bool> s_clk;
 
-  num_generator tst_generator("tst_generator"); // Instance of generator
-  tst_generator(s_clk, s_in1, s_in2);           // Binding ports
+  num_generator      tst_generator;
+  stage1             stg1;
+  stage2             stg2;
+  stage3             stg3;
+  test_probe_display disp;
+
+  pipe_model()
+      : s_in1("s_in1"), s_in2("s_in2"), s_sum("s_sum"), s_diff("s_diff"), s_prod("s_prod"), s_quot("s_quot"),
+        s_powr("s_powr"), s_clk("s_clk"), tst_generator("tst_generator"), stg1("stage1"), stg2("stage2"),
+        stg3("stage3"), disp("display") {
+    tst_generator(s_clk, s_in1, s_in2); // Binding ports
 
-  stage1 stg1("stage1");
-  stg1.in1(s_in1);
-  stg1.in2(s_in2);
-  stg1.sum(s_sum);
-  stg1.diff(s_diff);
-  stg1.clk(s_clk);
+    stg1.in1(s_in1);
+    stg1.in2(s_in2);
+    stg1.sum(s_sum);
+    stg1.diff(s_diff);
+    stg1.clk(s_clk);
 
-  stage2 stg2("stage2");
-  stg2(s_sum, s_diff, s_prod, s_quot, s_clk);
+    stg2(s_sum, s_diff, s_prod, s_quot, s_clk);
 
-  stage3 stg3("stage3");               // instance of `stage3' module
-  stg3(s_prod, s_quot, s_powr, s_clk); // Positional port binding
+    stg3(s_prod, s_quot, s_powr, s_clk); // Positional port binding
 
-  test_probe_display disp("display"); // instance of `display' module
-  disp(s_powr, s_clk);                // Positional port binding
+    disp(s_powr, s_clk); // Positional port binding
+  }
+};
+
+/**
+ * @brief event driven run, the clock written by hand
+ *
+ * @return wall time of the cycles in seconds
+ */
+static double run_event(int cycles) {
+  pipe_model<sc_signal<double> >        top;
+  std::chrono::steady_clock::time_point wall_start;
 
   sc_start(0, SC_NS); // Initialize simulation
-  for (int i = 0; i < 50; i++) {
-    s_clk.write(1);
-    sc_start(10, SC_NS);
-    s_clk.write(0);
-    sc_start(10, SC_NS);
+  wall_start = std::chrono::steady_clock::now();
+  for (int i = 0; i < cycles; i++) {
+    top.s_clk.write(1);
+    sc_start(PIPE_CLOCK_PERIOD_NS / 2, SC_NS);
+    top.s_clk.write(0);
+    sc_start(PIPE_CLOCK_PERIOD_NS / 2, SC_NS);
   }
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - wall_start).count();
+}
+
+/**
+ * @brief cycle based run, the processes called directly
+ *
+ * @return wall time of the cycles in seconds
+ */
+static double run_cycle(int cycles) {
+  pipe_model<cycle_signal<double> >     top;
+  cycle_sim                             sim(sc_time(PIPE_CLOCK_PERIOD_NS, SC_NS));
+  std::chrono::steady_clock::time_point wall_start;
+  double                                wall_s;
+
+  // any order, every signal is a register
+  sim.add<&test_probe_display::print_test>(top.disp);
+  sim.add<&stage3::power>(top.stg3);
+  sim.add<&stage2::multdiv>(top.stg2);
+  sim.add<&stage1::addsub>(top.stg1);
+  sim.add<&num_generator::generate>(top.tst_generator);
+
+  sc_start(0, SC_NS); // elaborate, binds the ports
+  sim.bind();
+  PROFILE_ENABLE(false); // no kernel process to charge the activations to
+  sim_log::instance().set_time_source(sim.get_time_source());
+
+  wall_start = std::chrono::steady_clock::now();
+  sim.run(cycles);
+  wall_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall_start).count();
+
+  sim_log::instance().flush();
+  sim_log::instance().set_time_source(nullptr);
+  sim.print_schedule();
+  return wall_s;
+}
+
+/**
+ * @brief parse the -n argument, a whole number of cycles not below zero
+ *
+ * @return true when text is a valid count
+ */
+static bool parse_cycles(const char *text, int &cycles) {
+  char *end;
+  long  value;
+
+  errno = 0;
+  value = strtol(text, &end, 10);
+  if (('\0' == *text) || ('\0' != *end) || (ERANGE == errno) || (value < 0) || (value > INT_MAX)) {
+    return false;
+  }
+  cycles = (int)value;
+  return true;
+}
+
+int sc_main(int argc, char *argv[]) {
+  bool   cycle  = false;
+  int    cycles = PIPE_CYCLES;
+  double wall_s;
+
+  for (int i = 1; i < argc; ++i) {
+    if (0 == strcmp(argv[i], "--cycle")) {
+      cycle = true;
+    } else if ((0 == strcmp(argv[i], "-n")) && (i + 1 < argc) && parse_cycles(argv[i + 1], cycles)) {
+      ++i;
+    } else {
+      fprintf(stderr, "usage: %s [--cycle] [-n cycles]\n", argv[0]);
+      return 1;
+    }
+  }
+
+  wall_s = cycle ? run_cycle(cycles) : run_event(cycles);
+
+  sim_log::instance().flush();
+  if (!cycle) PROFILE_REPORT("pipe_profile");
+  printf("%s: %d cycles, %.6f s wall, %.0f cycles/s\n", cycle ? "cycle" : "event", cycles, wall_s,
+         cycles / std::max(wall_s, 1e-9));
   return 0;
 }
@@ -34,6 +34,7 @@
 #define STAGE1_HPP_
 
 // Includes
+#include "sim_profile.hpp"
 #include <systemc.h>
 
 // Inheritance from sc_module
@@ -45,7 +46,10 @@ struct stage1 : sc_module {
 
   sc_in<bool> clk; // clock
 
+  PROFILE_SLOT(profile_slot);
+
   void addsub() { // Process
+    PROFILE_ACTIVATION(profile_slot);
     double a;
     double b;
 
@@ -34,6 +34,7 @@
 #define STAGE2_HPP_
 
 // Includes
+#include "sim_profile.hpp"
 #include <systemc.h>
 
 // Inheritance from sc_module
@@ -45,7 +46,10 @@ struct stage2 : sc_module {
 
   sc_in<bool> clk; // clock
 
+  PROFILE_SLOT(profile_slot);
+
   void multdiv() { // Process
+    PROFILE_ACTIVATION(profile_slot);
     double a;
     double b;
 
@@ -34,6 +34,7 @@
 #define STAGE3_HPP_
 
 // Includes
+#include "sim_profile.hpp"
 #include <systemc.h>
 
 // Inheritance from sc_module
@@ -44,7 +45,10 @@ struct stage3 : sc_module {
 
   sc_in<bool> clk; // clock
 
+  PROFILE_SLOT(profile_slot);
+
   void power() { // Process
+    PROFILE_ACTIVATION(profile_slot);
     double a;
     double b;
 
@@ -34,17 +34,24 @@
 #define TEST_PROBE_DISPLAY_HPP_
 
 // Includes
+#include "sim_log.hpp"
+#include "sim_profile.hpp"
 #include <systemc.h>
 
 struct test_probe_display : sc_module {
   sc_in<double> in;
   sc_in<bool>   clk;
 
+  sim_log_source &log;
+
+  PROFILE_SLOT(profile_slot);
+
   void print_test() {
-    cout << "test_probe_display: " << in.read() << endl;
+    PROFILE_ACTIVATION(profile_slot);
+    SIM_LOG(log, SIM_LOG_INFO, "%g", in.read());
   }
 
-  SC_CTOR(test_probe_display) {
+  SC_CTOR(test_probe_display) : log(sim_log::instance().source(name())) {
     SC_METHOD(print_test);
     dont_initialize(); // prevent initialization for SC_METHODs and SC_THREADs
     sensitive << clk.pos();